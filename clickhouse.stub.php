@@ -11,6 +11,8 @@ enum CompressionMethod: int {
     case None = -1;
     case LZ4 = 1;
     case ZSTD = 2;
+    /** Results use LZ4 or ZSTD per query, picked from measured bandwidth and ratios */
+    case Adaptive = 3;
 }
 
 enum Type: int {
@@ -80,20 +82,46 @@ final class ClientOptions {
         int $tcpKeepAliveIntervalSeconds = 5,
         int $tcpKeepAliveCount = 3,
         int $maxCompressionChunkSize = 65535,
+        /** Connect attempts raced in parallel across resolved addresses and endpoints */
+        int $connectParallelism = 1,
+        int $connectStaggerMs = 250,
+        /** Process-wide DNS cache TTL for endpoint host names (0 = resolve on every connect) */
+        int $dnsCacheTtlSeconds = 0,
+        int $dnsNegativeTtlSeconds = 5,
+        /** Defer connecting until the first query, ping or server info request */
+        bool $lazyConnect = false,
+        /** Selects re-send the query to another endpoint after this many ms without rows (0 = off) */
+        int $hedgeDelayMs = 0,
+        /** Blocks a background thread receives and decompresses ahead of the PHP thread in selects (0 = off) */
+        int $readAheadBlocks = 0,
+        /** Send and receive plain TCP traffic through io_uring where available (Linux) */
+        bool $ioUring = false,
+        /** Uncompressed connections gather writes into one sendmsg() and use MSG_ZEROCOPY from this many bytes (0 = off) */
+        int $zeroCopyThreshold = 0,
+        /** PHP memory one select block may take once converted; sizes max_block_size and preferred_block_size_bytes (0 = server default) */
+        int $blockMemoryBudget = 0,
+        /** Cancel a select with MemoryLimitException before it fills this share of memory_limit (0 = off) */
+        float $memoryLimitFraction = 0.0,
     ) {}
 }
 
 final class Client {
     public function __construct(ClientOptions $options) {}
 
-    public function execute(string $query, ?array $params = null, ?array $settings = null, ?string $queryId = null): void {}
+    /**
+     * @param int|null $timeoutMs Deadline for the whole call. On expiry the query is
+     *                            cancelled and QueryTimeoutException is thrown.
+     */
+    public function execute(string $query, ?array $params = null, ?array $settings = null, ?string $queryId = null, ?int $timeoutMs = null): void {}
 
-    public function select(string $query, ?array $params = null, ?array $settings = null, ?string $queryId = null): array {}
+    public function select(string $query, ?array $params = null, ?array $settings = null, ?string $queryId = null, ?int $timeoutMs = null): array {}
 
     /**
      * @param callable $callback Called per data block. Return false to cancel.
      * @param callable|null $onProgress Called with progress counters.
      * @param callable|null $onProfile Called with profile counters.
+     * @param int $minRows Merge consecutive blocks until they hold this many rows (0 = off).
+     * @param int $maxRows Split blocks larger than this many rows (0 = off).
      */
     public function selectByBlock(
         string $query,
@@ -103,15 +131,62 @@ final class Client {
         ?string $queryId = null,
         ?callable $onProgress = null,
         ?callable $onProfile = null,
+        ?int $timeoutMs = null,
+        int $minRows = 0,
+        int $maxRows = 0,
     ): void {}
 
+    /**
+     * The result as a JSON array of row objects, or with $columnar an object
+     * of column arrays, encoded straight from the received columns.
+     */
+    public function selectJson(string $query, ?array $params = null, ?array $settings = null, ?string $queryId = null, ?int $timeoutMs = null, bool $columnar = false): string {}
+
+    /**
+     * The result in ClickHouse's Native format, optionally LZ4 or ZSTD
+     * compressed; Block::fromNative() reads it back as one block.
+     */
+    public function selectNative(string $query, ?array $params = null, ?array $settings = null, ?string $queryId = null, ?int $timeoutMs = null, ?CompressionMethod $compression = null): string {}
+
+    /**
+     * The result as an Apache Arrow IPC stream (schema, one record batch per
+     * non-empty block, end-of-stream marker), readable by pyarrow, Polars,
+     * DuckDB and other Arrow consumers.
+     */
+    public function selectArrowIpc(string $query, ?array $params = null, ?array $settings = null, ?string $queryId = null, ?int $timeoutMs = null): string {}
+
+    /**
+     * select() through the shared result cache (clickhouse.result_cache_size):
+     * a live entry for the same query, params, settings, servers, database and
+     * user is returned without contacting the server, otherwise the result is
+     * stored for $ttlSeconds.
+     */
+    public function selectCached(string $query, int $ttlSeconds, ?array $params = null, ?array $settings = null, ?string $queryId = null, ?int $timeoutMs = null): array {}
+
+    /**
+     * Format the result in C++ and write it to a stream as it arrives.
+     * @param resource $stream Any writable PHP stream.
+     * @param string $format CSV, CSVWithNames, TSV, TSVWithNames or JSONEachRow.
+     * @return int Rows written.
+     */
+    public function selectToStream(string $query, $stream, string $format, ?array $params = null, ?array $settings = null, ?string $queryId = null, ?int $timeoutMs = null): int {}
+
     public function insert(string $tableName, Block $block, ?string $queryId = null): void {}
 
     /**
      * Execute SELECT with external temporary tables.
      * @param array $externalTables Entries contain a table name and Block data.
      */
-    public function selectWithExternalData(string $query, array $externalTables, ?array $params = null, ?array $settings = null, ?string $queryId = null): array {}
+    public function selectWithExternalData(string $query, array $externalTables, ?array $params = null, ?array $settings = null, ?string $queryId = null, ?int $timeoutMs = null): array {}
+
+    /**
+     * Run the same query on every shard concurrently and return all rows.
+     * @param array $endpoints Shards as ['host' => string, 'port' => int].
+     * @param array|null $orderBy Columns the query is sorted by ('col' or 'col DESC');
+     *                            shard results are k-way merged on them. Without it
+     *                            blocks are concatenated in arrival order.
+     */
+    public function selectFanOut(array $endpoints, string $query, ?array $params = null, ?array $settings = null, ?array $orderBy = null, ?int $timeoutMs = null): array {}
 
     public function ping(): void {}
 
@@ -123,6 +198,14 @@ final class Client {
     /** Get the currently connected endpoint as ['host' => string, 'port' => int], or null */
     public function getCurrentEndpoint(): ?array {}
 
+    /**
+     * Wire byte counters and the result codecs chosen by CompressionMethod::Adaptive:
+     * ['adaptive' => bool, 'last' => ?string, 'bytes_received' => ?int,
+     *  'bytes_sent' => ?int, 'bandwidth' => float, 'lz4' => array, 'zstd' => array],
+     * each codec with 'queries', 'ratio' and 'decode'
+     */
+    public function getCompressionStats(): array {}
+
     public function getServerInfo(): ServerInfo {}
 }
 
@@ -144,6 +227,27 @@ final class Block {
     public function getColumnTypeName(int $index): string {}
 
     public function toArray(): array {}
+
+    /** Rows as a JSON array of objects, or with $columnar an object of column arrays */
+    public function toJson(bool $columnar = false): string {}
+
+    /** The block in ClickHouse's Native format, as written by FORMAT Native */
+    public function toNative(?CompressionMethod $compression = null): string {}
+
+    /** Parse Native data, compressed or not; consecutive blocks are concatenated */
+    public static function fromNative(string $data): Block {}
+
+    /** The block as an Apache Arrow IPC stream: schema, one record batch, end marker */
+    public function toArrowIpc(): string {}
+
+    /** Rows $offset to $offset + $length (or the end) of every column */
+    public function slice(int $offset, ?int $length = null): Block {}
+
+    /** The rows at $indices, in that order; an index may repeat */
+    public function take(array $indices): Block {}
+
+    /** The rows where $mask, a UInt8 column such as Column::compare() returns, is not 0 */
+    public function filter(Column $mask): Block {}
 }
 
 final class Column {
@@ -158,6 +262,76 @@ final class Column {
     public function at(int $index): mixed {}
 
     public function toArray(): array {}
+
+    /**
+     * Values as one packed little-endian buffer, the column's Native body:
+     * Int*, UInt*, Float*, Date, Date32, DateTime, DateTime64, Decimal, UUID
+     * and FixedString columns only.
+     */
+    public function toBinary(): string {}
+
+    /** A column of $typeName from a buffer as toBinary() returns it, e.g. pack('e*', ...$floats) */
+    public static function fromBinary(string $typeName, string $bytes): Column {}
+
+    /**
+     * The values of an Int*, UInt* or Float* column in place, for FFI code.
+     * For Nullable columns the slots of NULLs hold zero.
+     */
+    public function bufferView(): ColumnBuffer {}
+
+    /** The null map of a Nullable column in place, one uint8_t per row, 1 for NULL */
+    public function nullMapView(): ColumnBuffer {}
+
+    /**
+     * Sum of the non-NULL values of an Int*, UInt*, Float* or Decimal column:
+     * int (a numeric string past PHP_INT_MAX), float, or a string for Decimal
+     */
+    public function sum(): mixed {}
+
+    /** Smallest non-NULL value in the form at() returns it, null if there is none */
+    public function min(): mixed {}
+
+    /** Largest non-NULL value in the form at() returns it, null if there is none */
+    public function max(): mixed {}
+
+    public function mean(): ?float {}
+
+    /** Rows that are not NULL; works for every column type */
+    public function countNonNull(): int {}
+
+    /**
+     * Exact quantiles like quantilesExact(): the value at floor(level * n) of
+     * the sorted non-NULL values for each level from 0 to 1
+     */
+    public function quantiles(array $levels): array {}
+
+    /** Rows $offset to $offset + $length (or the end) as a new column */
+    public function slice(int $offset, ?int $length = null): Column {}
+
+    /**
+     * A UInt8 mask with 1 where the value compares true with $value by $op
+     * (=, !=, <>, <, <=, >, >=), for Block::filter(). Numeric and DateTime
+     * columns take an int or float, String and FixedString a string; NULLs
+     * give 0.
+     */
+    public function compare(string $op, mixed $value): Column {}
+}
+
+/**
+ * A view of a column's native memory. The view keeps the column alive, so
+ * it must outlive any FFI pointer made from getAddress(). Treat the memory
+ * as read-only: the column may be shared with blocks and other views.
+ */
+final class ColumnBuffer {
+    public function getAddress(): int {}
+
+    /** Number of values */
+    public function getCount(): int {}
+
+    public function getByteLength(): int {}
+
+    /** The C type of one value for FFI::cast(), e.g. "double" or "int32_t" */
+    public function getCType(): string {}
 }
 
 readonly class ServerInfo {
@@ -182,4 +356,10 @@ class ServerException extends ClickHouseException {
 
 class ProtocolException extends ClickHouseException {}
 
+/** A per-call timeoutMs deadline expired; the query was cancelled on the server */
+class QueryTimeoutException extends ClickHouseException {}
+
+/** A result would have taken PHP past memoryLimitFraction of memory_limit; the query was cancelled */
+class MemoryLimitException extends ClickHouseException {}
+
 class ValidationException extends \InvalidArgumentException {}
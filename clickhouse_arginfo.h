@@ -29,6 +29,17 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_class_ClickHouse_Driver_ClientOptions___construct
     ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, tcpKeepAliveIntervalSeconds, IS_LONG, 0, "5")
     ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, tcpKeepAliveCount, IS_LONG, 0, "3")
     ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, maxCompressionChunkSize, IS_LONG, 0, "65535")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, connectParallelism, IS_LONG, 0, "1")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, connectStaggerMs, IS_LONG, 0, "250")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, dnsCacheTtlSeconds, IS_LONG, 0, "0")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, dnsNegativeTtlSeconds, IS_LONG, 0, "5")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, lazyConnect, _IS_BOOL, 0, "false")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, hedgeDelayMs, IS_LONG, 0, "0")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, readAheadBlocks, IS_LONG, 0, "0")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, ioUring, _IS_BOOL, 0, "false")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, zeroCopyThreshold, IS_LONG, 0, "0")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, blockMemoryBudget, IS_LONG, 0, "0")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, memoryLimitFraction, IS_DOUBLE, 0, "0.0")
 ZEND_END_ARG_INFO()
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_class_ClickHouse_Driver_Client___construct, 0, 0, 1)
@@ -40,6 +51,7 @@ ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_class_ClickHouse_Driver_Client_e
     ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, params, IS_ARRAY, 1, "null")
     ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, settings, IS_ARRAY, 1, "null")
     ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, queryId, IS_STRING, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, timeoutMs, IS_LONG, 1, "null")
 ZEND_END_ARG_INFO()
 
 ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_class_ClickHouse_Driver_Client_select, 0, 1, IS_ARRAY, 0)
@@ -47,6 +59,7 @@ ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_class_ClickHouse_Driver_Client_s
     ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, params, IS_ARRAY, 1, "null")
     ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, settings, IS_ARRAY, 1, "null")
     ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, queryId, IS_STRING, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, timeoutMs, IS_LONG, 1, "null")
 ZEND_END_ARG_INFO()
 
 ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_class_ClickHouse_Driver_Client_selectByBlock, 0, 2, IS_VOID, 0)
@@ -57,6 +70,58 @@ ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_class_ClickHouse_Driver_Client_s
     ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, queryId, IS_STRING, 1, "null")
     ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, onProgress, IS_CALLABLE, 1, "null")
     ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, onProfile, IS_CALLABLE, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, timeoutMs, IS_LONG, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, minRows, IS_LONG, 0, "0")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, maxRows, IS_LONG, 0, "0")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_class_ClickHouse_Driver_Client_selectJson, 0, 1, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, query, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, params, IS_ARRAY, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, settings, IS_ARRAY, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, queryId, IS_STRING, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, timeoutMs, IS_LONG, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, columnar, _IS_BOOL, 0, "false")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_class_ClickHouse_Driver_Client_selectNative, 0, 1, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, query, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, params, IS_ARRAY, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, settings, IS_ARRAY, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, queryId, IS_STRING, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, timeoutMs, IS_LONG, 1, "null")
+#if PHP_VERSION_ID >= 80100
+    ZEND_ARG_OBJ_INFO_WITH_DEFAULT_VALUE(0, compression, ClickHouse\\Driver\\CompressionMethod, 1, "null")
+#else
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, compression, IS_LONG, 1, "null")
+#endif
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_class_ClickHouse_Driver_Client_selectCached, 0, 2, IS_ARRAY, 0)
+    ZEND_ARG_TYPE_INFO(0, query, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, ttlSeconds, IS_LONG, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, params, IS_ARRAY, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, settings, IS_ARRAY, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, queryId, IS_STRING, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, timeoutMs, IS_LONG, 1, "null")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_class_ClickHouse_Driver_Client_selectArrowIpc, 0, 1, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, query, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, params, IS_ARRAY, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, settings, IS_ARRAY, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, queryId, IS_STRING, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, timeoutMs, IS_LONG, 1, "null")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_class_ClickHouse_Driver_Client_selectToStream, 0, 3, IS_LONG, 0)
+    ZEND_ARG_TYPE_INFO(0, query, IS_STRING, 0)
+    ZEND_ARG_INFO(0, stream)
+    ZEND_ARG_TYPE_INFO(0, format, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, params, IS_ARRAY, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, settings, IS_ARRAY, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, queryId, IS_STRING, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, timeoutMs, IS_LONG, 1, "null")
 ZEND_END_ARG_INFO()
 
 ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_class_ClickHouse_Driver_Client_insert, 0, 2, IS_VOID, 0)
@@ -71,6 +136,16 @@ ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_class_ClickHouse_Driver_Client_s
     ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, params, IS_ARRAY, 1, "null")
     ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, settings, IS_ARRAY, 1, "null")
     ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, queryId, IS_STRING, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, timeoutMs, IS_LONG, 1, "null")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_class_ClickHouse_Driver_Client_selectFanOut, 0, 2, IS_ARRAY, 0)
+    ZEND_ARG_TYPE_INFO(0, endpoints, IS_ARRAY, 0)
+    ZEND_ARG_TYPE_INFO(0, query, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, params, IS_ARRAY, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, settings, IS_ARRAY, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, orderBy, IS_ARRAY, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, timeoutMs, IS_LONG, 1, "null")
 ZEND_END_ARG_INFO()
 
 ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_class_ClickHouse_Driver_Client_ping, 0, 0, IS_VOID, 0)
@@ -82,6 +157,9 @@ ZEND_END_ARG_INFO()
 ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_class_ClickHouse_Driver_Client_getCurrentEndpoint, 0, 0, IS_ARRAY, 1)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_class_ClickHouse_Driver_Client_getCompressionStats, 0, 0, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_class_ClickHouse_Driver_Client_getServerInfo, 0, 0, ClickHouse\\Driver\\ServerInfo, 0)
 ZEND_END_ARG_INFO()
 
@@ -121,6 +199,38 @@ ZEND_END_ARG_INFO()
 ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_class_ClickHouse_Driver_Block_toArray, 0, 0, IS_ARRAY, 0)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_class_ClickHouse_Driver_Block_toJson, 0, 0, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, columnar, _IS_BOOL, 0, "false")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_class_ClickHouse_Driver_Block_toNative, 0, 0, IS_STRING, 0)
+#if PHP_VERSION_ID >= 80100
+    ZEND_ARG_OBJ_INFO_WITH_DEFAULT_VALUE(0, compression, ClickHouse\\Driver\\CompressionMethod, 1, "null")
+#else
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, compression, IS_LONG, 1, "null")
+#endif
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_class_ClickHouse_Driver_Block_toArrowIpc, 0, 0, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_class_ClickHouse_Driver_Block_fromNative, 0, 1, ClickHouse\\Driver\\Block, 0)
+    ZEND_ARG_TYPE_INFO(0, data, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_class_ClickHouse_Driver_Block_slice, 0, 1, ClickHouse\\Driver\\Block, 0)
+    ZEND_ARG_TYPE_INFO(0, offset, IS_LONG, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, length, IS_LONG, 1, "null")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_class_ClickHouse_Driver_Block_take, 0, 1, ClickHouse\\Driver\\Block, 0)
+    ZEND_ARG_TYPE_INFO(0, indices, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_class_ClickHouse_Driver_Block_filter, 0, 1, ClickHouse\\Driver\\Block, 0)
+    ZEND_ARG_OBJ_INFO(0, mask, ClickHouse\\Driver\\Column, 0)
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_class_ClickHouse_Driver_Column_create, 0, 2, ClickHouse\\Driver\\Column, 0)
     ZEND_ARG_TYPE_INFO(0, typeName, IS_STRING, 0)
     ZEND_ARG_TYPE_INFO(0, values, IS_ARRAY, 0)
@@ -145,5 +255,51 @@ ZEND_END_ARG_INFO()
 
 #define arginfo_class_ClickHouse_Driver_Column_toArray arginfo_class_ClickHouse_Driver_Block_toArray
 
+#define arginfo_class_ClickHouse_Driver_Column_toBinary arginfo_class_ClickHouse_Driver_Block_toArrowIpc
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_class_ClickHouse_Driver_Column_fromBinary, 0, 2, ClickHouse\\Driver\\Column, 0)
+    ZEND_ARG_TYPE_INFO(0, typeName, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, bytes, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_class_ClickHouse_Driver_Column_bufferView, 0, 0, ClickHouse\\Driver\\ColumnBuffer, 0)
+ZEND_END_ARG_INFO()
+
+#define arginfo_class_ClickHouse_Driver_Column_nullMapView arginfo_class_ClickHouse_Driver_Column_bufferView
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_class_ClickHouse_Driver_Column_sum, 0, 0, IS_MIXED, 0)
+ZEND_END_ARG_INFO()
+
+#define arginfo_class_ClickHouse_Driver_Column_min arginfo_class_ClickHouse_Driver_Column_sum
+
+#define arginfo_class_ClickHouse_Driver_Column_max arginfo_class_ClickHouse_Driver_Column_sum
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_class_ClickHouse_Driver_Column_mean, 0, 0, IS_DOUBLE, 1)
+ZEND_END_ARG_INFO()
+
+#define arginfo_class_ClickHouse_Driver_Column_countNonNull arginfo_class_ClickHouse_Driver_Column_size
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_class_ClickHouse_Driver_Column_quantiles, 0, 1, IS_ARRAY, 0)
+    ZEND_ARG_TYPE_INFO(0, levels, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_class_ClickHouse_Driver_Column_slice, 0, 1, ClickHouse\\Driver\\Column, 0)
+    ZEND_ARG_TYPE_INFO(0, offset, IS_LONG, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, length, IS_LONG, 1, "null")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_class_ClickHouse_Driver_Column_compare, 0, 2, ClickHouse\\Driver\\Column, 0)
+    ZEND_ARG_TYPE_INFO(0, op, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, value, IS_MIXED, 0)
+ZEND_END_ARG_INFO()
+
+#define arginfo_class_ClickHouse_Driver_ColumnBuffer_getAddress arginfo_class_ClickHouse_Driver_Column_size
+
+#define arginfo_class_ClickHouse_Driver_ColumnBuffer_getCount arginfo_class_ClickHouse_Driver_Column_size
+
+#define arginfo_class_ClickHouse_Driver_ColumnBuffer_getByteLength arginfo_class_ClickHouse_Driver_Column_size
+
+#define arginfo_class_ClickHouse_Driver_ColumnBuffer_getCType arginfo_class_ClickHouse_Driver_Column_getTypeName
+
 ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_class_ClickHouse_Driver_Exception_ServerException_getClickHouseCode, 0, 0, IS_LONG, 0)
 ZEND_END_ARG_INFO()
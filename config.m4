@@ -35,9 +35,21 @@ if test "$PHP_CLICKHOUSE" != "no"; then
     src/exceptions.cpp \
     src/client_options.cpp \
     src/client.cpp \
+    src/socket_factory.cpp \
+    src/dns_cache.cpp \
+    src/query_runner.cpp \
+    src/tls.cpp \
+    src/uring_socket.cpp \
+    src/gather_output.cpp \
     src/block.cpp \
     src/column.cpp \
     src/column_convert.cpp \
+    src/column_aggregate.cpp \
+    src/column_filter.cpp \
+    src/text_format.cpp \
+    src/native_format.cpp \
+    src/arrow_ipc.cpp \
+    src/result_cache.cpp \
     src/column_write.cpp \
     src/error_codes.cpp"
 
@@ -51,7 +63,17 @@ if test "$PHP_CLICKHOUSE" != "no"; then
     CLICKHOUSE_OPENSSL_FLAGS=""
   ])
 
-  CLICKHOUSE_COMMON_FLAGS="-DZEND_ENABLE_STATIC_TSRMLS_CACHE=1 $CLICKHOUSE_OPENSSL_FLAGS"
+  dnl liburing >= 2.4 (buffer rings) for the optional io_uring transport on Linux
+  PKG_CHECK_MODULES([LIBURING], [liburing >= 2.4], [
+    PHP_EVAL_INCLINE($LIBURING_CFLAGS)
+    PHP_EVAL_LIBLINE($LIBURING_LIBS, CLICKHOUSE_SHARED_LIBADD)
+    CLICKHOUSE_LIBURING_FLAGS="-DHAVE_LIBURING=1"
+  ], [
+    AC_MSG_NOTICE([liburing not found — ioUring connections use plain sockets])
+    CLICKHOUSE_LIBURING_FLAGS=""
+  ])
+
+  CLICKHOUSE_COMMON_FLAGS="-DZEND_ENABLE_STATIC_TSRMLS_CACHE=1 $CLICKHOUSE_OPENSSL_FLAGS $CLICKHOUSE_LIBURING_FLAGS"
 
   PHP_NEW_EXTENSION([clickhouse],
     [$PHP_CLICKHOUSE_SOURCES],
@@ -1,10 +1,20 @@
 #include "php_clickhouse.h"
 #include "clickhouse/client.h"
+#include "src/dns_cache.h"
+#include "src/result_cache.h"
+#include "src/tls.h"
+#include "src/uring_socket.h"
 
 #include <cstdio>
 
+PHP_INI_BEGIN()
+PHP_INI_ENTRY("clickhouse.result_cache_size", "0", PHP_INI_SYSTEM, NULL)
+PHP_INI_END()
+
 static PHP_MINIT_FUNCTION(clickhouse)
 {
+    REGISTER_INI_ENTRIES();
+
     php_clickhouse_register_exceptions(module_number);
     php_clickhouse_register_enums(module_number);
     php_clickhouse_register_server_info(module_number);
@@ -14,11 +24,18 @@ static PHP_MINIT_FUNCTION(clickhouse)
     php_clickhouse_register_column(module_number);
     php_clickhouse_register_error_codes(module_number);
 
+    /* Mapped before FPM forks, so that every worker shares it */
+    php_clickhouse_result_cache_startup(INI_STR("clickhouse.result_cache_size"));
+
     return SUCCESS;
 }
 
 static PHP_MSHUTDOWN_FUNCTION(clickhouse)
 {
+    php_clickhouse_dns_cache_shutdown();
+    php_clickhouse_tls_shutdown();
+    php_clickhouse_result_cache_shutdown();
+    UNREGISTER_INI_ENTRIES();
     return SUCCESS;
 }
 
@@ -34,7 +51,29 @@ static PHP_MINFO_FUNCTION(clickhouse)
     php_info_print_table_row(2, "clickhouse-cpp Version", cpp_version);
     php_info_print_table_row(2, "Protocol", "Native TCP (port 9000)");
     php_info_print_table_row(2, "Compression", "LZ4, ZSTD");
+    php_info_print_table_row(2, "io_uring Transport",
+                             php_clickhouse_uring_compiled() ? "available" : "not compiled");
+    php_clickhouse_dns_stats dns;
+    php_clickhouse_dns_cache_get_stats(dns);
+    char dns_info[128];
+    snprintf(dns_info, sizeof(dns_info), "%zu entries, %llu lookups, %llu hits", dns.entries,
+             static_cast<unsigned long long>(dns.lookups),
+             static_cast<unsigned long long>(dns.hits));
+    php_info_print_table_row(2, "DNS Cache", dns_info);
+    php_clickhouse_result_cache_stats cache;
+    if (php_clickhouse_result_cache_get_stats(cache)) {
+        char cache_info[160];
+        snprintf(cache_info, sizeof(cache_info),
+                 "%zu entries, %zu of %zu bytes, %llu hits, %llu misses", cache.entries,
+                 cache.used, cache.size, static_cast<unsigned long long>(cache.hits),
+                 static_cast<unsigned long long>(cache.misses));
+        php_info_print_table_row(2, "Result Cache", cache_info);
+    } else {
+        php_info_print_table_row(2, "Result Cache", "disabled");
+    }
     php_info_print_table_end();
+
+    DISPLAY_INI_ENTRIES();
 }
 
 extern "C" {
@@ -33,6 +33,10 @@ extern "C" {
 #define Z_PARAM_STR_OR_NULL(dest) Z_PARAM_STR_EX(dest, 1, 0)
 #endif
 
+#ifndef Z_PARAM_LONG_OR_NULL
+#define Z_PARAM_LONG_OR_NULL(dest, is_null) Z_PARAM_LONG_EX(dest, is_null, 1, 0)
+#endif
+
 #ifndef Z_PARAM_FUNC_OR_NULL
 #define Z_PARAM_FUNC_OR_NULL(dest_fci, dest_fcc) Z_PARAM_FUNC_EX(dest_fci, dest_fcc, 1, 0)
 #endif
@@ -63,6 +67,7 @@ extern zend_class_entry *clickhouse_ce_ClientOptions;
 extern zend_class_entry *clickhouse_ce_Client;
 extern zend_class_entry *clickhouse_ce_Block;
 extern zend_class_entry *clickhouse_ce_Column;
+extern zend_class_entry *clickhouse_ce_ColumnBuffer;
 extern zend_class_entry *clickhouse_ce_ServerInfo;
 extern zend_class_entry *clickhouse_ce_CompressionMethod;
 extern zend_class_entry *clickhouse_ce_Type;
@@ -73,6 +78,8 @@ extern zend_class_entry *clickhouse_ce_ConnectionException;
 extern zend_class_entry *clickhouse_ce_ServerException;
 extern zend_class_entry *clickhouse_ce_ProtocolException;
 extern zend_class_entry *clickhouse_ce_ValidationException;
+extern zend_class_entry *clickhouse_ce_QueryTimeoutException;
+extern zend_class_entry *clickhouse_ce_MemoryLimitException;
 
 /* Error code class */
 extern zend_class_entry *clickhouse_ce_ErrorCode;
@@ -0,0 +1,689 @@
+#include "src/arrow_ipc.h"
+#include "src/column_convert.h"
+
+#include "clickhouse/columns/array.h"
+#include "clickhouse/columns/factory.h"
+#include "clickhouse/columns/nullable.h"
+#include "clickhouse/columns/numeric.h"
+#include "clickhouse/columns/tuple.h"
+#include "clickhouse/exceptions.h"
+#include "clickhouse/types/types.h"
+
+#include "absl/numeric/int128.h"
+
+#include <array>
+#include <climits>
+#include <cstring>
+#include <functional>
+#include <utility>
+#include <vector>
+
+using namespace clickhouse;
+
+/* MetadataVersion::V5 */
+#define ARROW_METADATA_VERSION 4
+/* MessageHeader union members */
+#define ARROW_HEADER_SCHEMA 1
+#define ARROW_HEADER_RECORD_BATCH 3
+#define ARROW_CONTINUATION 0xFFFFFFFFu
+
+namespace
+{
+
+class fb_builder;
+
+/* One vtable slot of a flatbuffer table: absent, an inline scalar, or an
+ * offset to an object written after the table by `child` */
+struct fb_field
+{
+    size_t size = 0;
+    uint64_t bits = 0;
+    std::function<size_t(fb_builder &)> child;
+};
+
+/* Scalars are stored in host order; Arrow IPC is written little-endian */
+template <typename T> fb_field fb_scalar(T value)
+{
+    fb_field field;
+    field.size = sizeof(T);
+    memcpy(&field.bits, &value, sizeof(T));
+    return field;
+}
+
+fb_field fb_offset(std::function<size_t(fb_builder &)> child)
+{
+    fb_field field;
+    field.size = sizeof(uint32_t);
+    field.child = std::move(child);
+    return field;
+}
+
+/**
+ * Minimal FlatBuffers writer for Arrow's Message, Schema and RecordBatch
+ * tables. Unlike the reference builder it writes front to back: a table
+ * first, then the objects it points to, so every offset is forward as the
+ * format requires.
+ */
+class fb_builder
+{
+  public:
+    /* Room for the root offset */
+    fb_builder() : buf_(sizeof(uint32_t), '\0')
+    {
+    }
+
+    size_t table(const std::vector<fb_field> &fields)
+    {
+        /* Widest fields first keeps every scalar naturally aligned */
+        std::vector<uint16_t> slots(fields.size(), 0);
+        size_t inline_size = sizeof(int32_t);
+        for (size_t width : {8, 4, 2, 1}) {
+            for (size_t i = 0; i < fields.size(); ++i) {
+                if (fields[i].size != width) {
+                    continue;
+                }
+                inline_size = (inline_size + width - 1) / width * width;
+                slots[i] = static_cast<uint16_t>(inline_size);
+                inline_size += width;
+            }
+        }
+
+        pad(2);
+        size_t vtable = buf_.size();
+        uint16_t header[2] = {static_cast<uint16_t>(4 + 2 * fields.size()),
+                              static_cast<uint16_t>(inline_size)};
+        put(header, sizeof(header));
+        put(slots.data(), slots.size() * sizeof(uint16_t));
+
+        pad(8);
+        size_t table = buf_.size();
+        buf_.append(inline_size, '\0');
+        int32_t to_vtable = static_cast<int32_t>(table - vtable);
+        memcpy(&buf_[table], &to_vtable, sizeof(to_vtable));
+        for (size_t i = 0; i < fields.size(); ++i) {
+            if (fields[i].size && !fields[i].child) {
+                memcpy(&buf_[table + slots[i]], &fields[i].bits, fields[i].size);
+            }
+        }
+        for (size_t i = 0; i < fields.size(); ++i) {
+            if (fields[i].child) {
+                size_t at = table + slots[i];
+                link(at, fields[i].child(*this));
+            }
+        }
+        return table;
+    }
+
+    size_t string(const std::string &value)
+    {
+        pad(4);
+        size_t start = buf_.size();
+        uint32_t len = static_cast<uint32_t>(value.size());
+        put(&len, sizeof(len));
+        buf_ += value;
+        buf_ += '\0';
+        return start;
+    }
+
+    size_t tables(const std::vector<std::function<size_t(fb_builder &)>> &items)
+    {
+        pad(4);
+        size_t start = buf_.size();
+        uint32_t len = static_cast<uint32_t>(items.size());
+        put(&len, sizeof(len));
+        buf_.append(items.size() * sizeof(uint32_t), '\0');
+        for (size_t i = 0; i < items.size(); ++i) {
+            size_t at = start + sizeof(uint32_t) * (i + 1);
+            link(at, items[i](*this));
+        }
+        return start;
+    }
+
+    /* Vector of FieldNode or Buffer structs, two longs each */
+    size_t pairs(const std::vector<std::array<int64_t, 2>> &items)
+    {
+        pad(4);
+        if ((buf_.size() + sizeof(uint32_t)) % 8) {
+            buf_.append(sizeof(uint32_t), '\0');
+        }
+        size_t start = buf_.size();
+        uint32_t len = static_cast<uint32_t>(items.size());
+        put(&len, sizeof(len));
+        put(items.data(), items.size() * sizeof(items[0]));
+        return start;
+    }
+
+    /* The finished buffer, padded to 8 bytes as IPC metadata must be */
+    std::string finish(size_t root)
+    {
+        link(0, root);
+        pad(8);
+        return std::move(buf_);
+    }
+
+  private:
+    void pad(size_t align)
+    {
+        buf_.append((align - buf_.size() % align) % align, '\0');
+    }
+
+    void put(const void *data, size_t len)
+    {
+        buf_.append(static_cast<const char *>(data), len);
+    }
+
+    void link(size_t at, size_t target)
+    {
+        uint32_t offset = static_cast<uint32_t>(target - at);
+        memcpy(&buf_[at], &offset, sizeof(offset));
+    }
+
+    std::string buf_;
+};
+
+enum class arrow_kind
+{
+    integer,
+    floating,
+    boolean,
+    utf8,
+    fixed_binary,
+    date,
+    timestamp,
+    decimal,
+    list,
+    structure,
+};
+
+struct arrow_type
+{
+    arrow_kind kind;
+    /* The ClickHouse type with Nullable and LowCardinality removed */
+    TypeRef value;
+    bool nullable = false;
+    /* Integer, float and fixed binary width in bytes */
+    size_t width = 0;
+    bool is_signed = false;
+    /* Timestamp TimeUnit, and the factor from DateTime64 ticks to it */
+    int16_t unit = 0;
+    int64_t ticks_to_unit = 1;
+    std::string timezone;
+    int32_t precision = 0;
+    int32_t scale = 0;
+};
+
+arrow_type arrow_type_of(TypeRef type, const std::string &column)
+{
+    arrow_type t;
+    if (type->GetCode() == Type::LowCardinality) {
+        type = type->As<LowCardinalityType>()->GetNestedType();
+    }
+    if (type->GetCode() == Type::Nullable) {
+        t.nullable = true;
+        type = type->As<NullableType>()->GetNestedType();
+    }
+    t.value = type;
+
+    switch (type->GetCode()) {
+    case Type::Int8:
+    case Type::Int16:
+    case Type::Int32:
+    case Type::Int64:
+        t.is_signed = true;
+        /* fallthrough */
+    case Type::UInt8:
+    case Type::UInt16:
+    case Type::UInt32:
+    case Type::UInt64:
+        t.kind = arrow_kind::integer;
+        break;
+    case Type::Float32:
+    case Type::Float64:
+        t.kind = arrow_kind::floating;
+        break;
+    case Type::Bool:
+        t.kind = arrow_kind::boolean;
+        return t;
+    case Type::String:
+    case Type::JSON:
+    case Type::Enum8:
+    case Type::Enum16:
+        t.kind = arrow_kind::utf8;
+        return t;
+    case Type::FixedString:
+        t.kind = arrow_kind::fixed_binary;
+        t.width = type->As<FixedStringType>()->GetSize();
+        return t;
+    case Type::Date:
+    case Type::Date32:
+        t.kind = arrow_kind::date;
+        return t;
+    case Type::DateTime:
+        t.kind = arrow_kind::timestamp;
+        t.timezone = type->As<DateTimeType>()->Timezone();
+        break;
+    case Type::DateTime64: {
+        t.kind = arrow_kind::timestamp;
+        t.timezone = type->As<DateTime64Type>()->Timezone();
+        /* SECOND, MILLISECOND, MICROSECOND or NANOSECOND: the first that
+         * holds the precision exactly */
+        size_t precision = type->As<DateTime64Type>()->GetPrecision();
+        t.unit = static_cast<int16_t>((precision + 2) / 3);
+        for (size_t p = precision; p < static_cast<size_t>(t.unit) * 3; ++p) {
+            t.ticks_to_unit *= 10;
+        }
+        break;
+    }
+    case Type::Decimal:
+    case Type::Decimal32:
+    case Type::Decimal64:
+    case Type::Decimal128:
+        t.kind = arrow_kind::decimal;
+        t.precision = static_cast<int32_t>(type->As<DecimalType>()->GetPrecision());
+        t.scale = static_cast<int32_t>(type->As<DecimalType>()->GetScale());
+        return t;
+    case Type::Array:
+        t.kind = arrow_kind::list;
+        return t;
+    case Type::Tuple:
+        t.kind = arrow_kind::structure;
+        return t;
+    default:
+        throw ValidationError("Column " + column + " of type " + type->GetName() +
+                              " cannot be written as Arrow");
+    }
+
+    if (t.kind == arrow_kind::timestamp && t.timezone.empty()) {
+        /* Values are Unix time whatever the server's zone */
+        t.timezone = "UTC";
+    }
+    if (t.kind == arrow_kind::integer || t.kind == arrow_kind::floating) {
+        switch (type->GetCode()) {
+        case Type::Int8:
+        case Type::UInt8:
+            t.width = 1;
+            break;
+        case Type::Int16:
+        case Type::UInt16:
+            t.width = 2;
+            break;
+        case Type::Int32:
+        case Type::UInt32:
+        case Type::Float32:
+            t.width = 4;
+            break;
+        default:
+            t.width = 8;
+            break;
+        }
+    }
+    return t;
+}
+
+/* Type union member of Field */
+uint8_t arrow_type_id(arrow_kind kind)
+{
+    switch (kind) {
+    case arrow_kind::integer:
+        return 2;
+    case arrow_kind::floating:
+        return 3;
+    case arrow_kind::utf8:
+        return 5;
+    case arrow_kind::boolean:
+        return 6;
+    case arrow_kind::decimal:
+        return 7;
+    case arrow_kind::date:
+        return 8;
+    case arrow_kind::timestamp:
+        return 10;
+    case arrow_kind::list:
+        return 12;
+    case arrow_kind::structure:
+        return 13;
+    case arrow_kind::fixed_binary:
+        return 15;
+    }
+    return 0;
+}
+
+size_t write_type(fb_builder &fb, const arrow_type &t)
+{
+    switch (t.kind) {
+    case arrow_kind::integer:
+        return fb.table({fb_scalar<int32_t>(static_cast<int32_t>(t.width * 8)),
+                         fb_scalar<uint8_t>(t.is_signed)});
+    case arrow_kind::floating:
+        /* Precision::SINGLE or DOUBLE */
+        return fb.table({fb_scalar<int16_t>(t.width == 4 ? 1 : 2)});
+    case arrow_kind::fixed_binary:
+        return fb.table({fb_scalar<int32_t>(static_cast<int32_t>(t.width))});
+    case arrow_kind::date:
+        /* DateUnit::DAY, spelled out because MILLISECOND is the default */
+        return fb.table({fb_scalar<int16_t>(0)});
+    case arrow_kind::timestamp:
+        return fb.table({fb_scalar<int16_t>(t.unit),
+                         fb_offset([&](fb_builder &b) { return b.string(t.timezone); })});
+    case arrow_kind::decimal:
+        return fb.table({fb_scalar<int32_t>(t.precision), fb_scalar<int32_t>(t.scale),
+                         fb_scalar<int32_t>(128)});
+    default:
+        /* Bool, Utf8, List and Struct_ have no fields */
+        return fb.table({});
+    }
+}
+
+size_t write_field(fb_builder &fb, const std::string &name, const TypeRef &type,
+                   const std::string &column)
+{
+    arrow_type t = arrow_type_of(type, column);
+
+    std::vector<std::pair<std::string, TypeRef>> children;
+    if (t.kind == arrow_kind::list) {
+        children.emplace_back("item", t.value->As<ArrayType>()->GetItemType());
+    } else if (t.kind == arrow_kind::structure) {
+        auto items = t.value->As<TupleType>()->GetTupleType();
+        for (size_t i = 0; i < items.size(); ++i) {
+            children.emplace_back(std::to_string(i + 1), items[i]);
+        }
+    }
+    std::vector<std::function<size_t(fb_builder &)>> child_fields;
+    for (const auto &child : children) {
+        child_fields.push_back(
+            [&](fb_builder &b) { return write_field(b, child.first, child.second, column); });
+    }
+
+    /* name, nullable, type_type, type, dictionary, children */
+    return fb.table({fb_offset([&](fb_builder &b) { return b.string(name); }),
+                     fb_scalar<uint8_t>(t.nullable), fb_scalar<uint8_t>(arrow_type_id(t.kind)),
+                     fb_offset([&](fb_builder &b) { return write_type(b, t); }), fb_field(),
+                     fb_offset([&](fb_builder &b) { return b.tables(child_fields); })});
+}
+
+void write_message(std::string &out, uint8_t header_type,
+                   const std::function<size_t(fb_builder &)> &header, size_t body_len)
+{
+    fb_builder fb;
+    std::string meta = fb.finish(
+        fb.table({fb_scalar<int16_t>(ARROW_METADATA_VERSION), fb_scalar<uint8_t>(header_type),
+                  fb_offset(header), fb_scalar<int64_t>(static_cast<int64_t>(body_len))}));
+    uint32_t prefix[2] = {ARROW_CONTINUATION, static_cast<uint32_t>(meta.size())};
+    out.append(reinterpret_cast<const char *>(prefix), sizeof(prefix));
+    out += meta;
+}
+
+void write_schema(std::string &out, const Block &block)
+{
+    std::vector<std::function<size_t(fb_builder &)>> fields;
+    for (size_t c = 0; c < block.GetColumnCount(); ++c) {
+        fields.push_back([&block, c](fb_builder &b) {
+            return write_field(b, block.GetColumnName(c), block[c]->Type(),
+                               block.GetColumnName(c));
+        });
+    }
+    /* endianness Little, fields */
+    write_message(
+        out, ARROW_HEADER_SCHEMA,
+        [&](fb_builder &b) {
+            return b.table({fb_scalar<int16_t>(0),
+                            fb_offset([&](fb_builder &v) { return v.tables(fields); })});
+        },
+        0);
+}
+
+/* Field nodes, buffer locations and body of one RecordBatch */
+struct arrow_batch
+{
+    std::vector<std::array<int64_t, 2>> nodes;
+    std::vector<std::array<int64_t, 2>> buffers;
+    std::string body;
+
+    /* Append a zeroed buffer at the next 8-byte boundary; valid until the next call */
+    char *buffer(size_t len)
+    {
+        body.append((8 - body.size() % 8) % 8, '\0');
+        buffers.push_back({static_cast<int64_t>(body.size()), static_cast<int64_t>(len)});
+        body.append(len, '\0');
+        return &body[body.size() - len];
+    }
+
+    template <typename T> void buffer(const std::vector<T> &values)
+    {
+        size_t len = values.size() * sizeof(T);
+        if (len) {
+            memcpy(buffer(len), values.data(), len);
+        } else {
+            buffer(0);
+        }
+    }
+};
+
+template <typename T> bool copy_vector(arrow_batch &b, const ColumnRef &col, size_t rows)
+{
+    auto typed = col->As<ColumnVector<T>>();
+    if (!typed) {
+        return false;
+    }
+    memcpy(b.buffer(rows * sizeof(T)), typed->GetWritableData().data(), rows * sizeof(T));
+    return true;
+}
+
+/* Fixed-width values straight from a ColumnVector buffer */
+bool copy_numeric(arrow_batch &b, const ColumnRef &col, const arrow_type &t, size_t rows)
+{
+    switch (t.value->GetCode()) {
+    case Type::Int8:
+        return copy_vector<int8_t>(b, col, rows);
+    case Type::Int16:
+        return copy_vector<int16_t>(b, col, rows);
+    case Type::Int32:
+        return copy_vector<int32_t>(b, col, rows);
+    case Type::Int64:
+        return copy_vector<int64_t>(b, col, rows);
+    case Type::UInt8:
+        return copy_vector<uint8_t>(b, col, rows);
+    case Type::UInt16:
+        return copy_vector<uint16_t>(b, col, rows);
+    case Type::UInt32:
+        return copy_vector<uint32_t>(b, col, rows);
+    case Type::UInt64:
+        return copy_vector<uint64_t>(b, col, rows);
+    case Type::Float32:
+        return copy_vector<float>(b, col, rows);
+    case Type::Float64:
+        return copy_vector<double>(b, col, rows);
+    default:
+        return false;
+    }
+}
+
+void append_offset(std::vector<int32_t> &offsets, size_t end)
+{
+    if (end > static_cast<size_t>(INT32_MAX)) {
+        throw ValidationError("A block holds more than 2 GiB of strings or array items, "
+                              "which Arrow's 32-bit offsets cannot address");
+    }
+    offsets.push_back(static_cast<int32_t>(end));
+}
+
+void write_array(arrow_batch &b, const ColumnRef &col, size_t rows)
+{
+    arrow_type t = arrow_type_of(col->Type(), std::string());
+
+    /* `values` yields the values; nulls of LowCardinality(Nullable) read as Void */
+    ColumnRef values = col;
+    auto nullable = col->As<ColumnNullable>();
+    if (nullable) {
+        values = nullable->Nested();
+    }
+    std::string validity;
+    size_t null_count = 0;
+    if (t.nullable) {
+        validity.assign((rows + 7) / 8, '\0');
+        for (size_t i = 0; i < rows; ++i) {
+            bool is_null = nullable ? nullable->IsNull(i) : col->GetItem(i).type == Type::Void;
+            if (is_null) {
+                ++null_count;
+            } else {
+                validity[i / 8] |= static_cast<char>(1 << (i % 8));
+            }
+        }
+    }
+    b.nodes.push_back({static_cast<int64_t>(rows), static_cast<int64_t>(null_count)});
+    if (null_count) {
+        memcpy(b.buffer(validity.size()), validity.data(), validity.size());
+    } else {
+        b.buffer(0);
+    }
+
+    switch (t.kind) {
+    case arrow_kind::integer:
+    case arrow_kind::floating:
+    case arrow_kind::fixed_binary: {
+        if (t.kind != arrow_kind::fixed_binary && copy_numeric(b, values, t, rows)) {
+            break;
+        }
+        char *out = b.buffer(rows * t.width);
+        for (size_t i = 0; i < rows; ++i) {
+            ItemView item = values->GetItem(i);
+            if (item.type != Type::Void && item.data.size() == t.width) {
+                memcpy(out + i * t.width, item.data.data(), t.width);
+            }
+        }
+        break;
+    }
+    case arrow_kind::boolean: {
+        char *out = b.buffer((rows + 7) / 8);
+        for (size_t i = 0; i < rows; ++i) {
+            ItemView item = values->GetItem(i);
+            if (item.type != Type::Void && item.get<uint8_t>()) {
+                out[i / 8] |= static_cast<char>(1 << (i % 8));
+            }
+        }
+        break;
+    }
+    case arrow_kind::utf8: {
+        std::vector<int32_t> offsets{0};
+        offsets.reserve(rows + 1);
+        std::string data;
+        for (size_t i = 0; i < rows; ++i) {
+            ItemView item = values->GetItem(i);
+            if (item.type == Type::Void) {
+                /* null: no bytes */
+            } else if (t.value->GetCode() == Type::Enum8) {
+                data += t.value->As<EnumType>()->GetEnumName(item.get<int8_t>());
+            } else if (t.value->GetCode() == Type::Enum16) {
+                data += t.value->As<EnumType>()->GetEnumName(item.get<int16_t>());
+            } else {
+                data += item.data;
+            }
+            append_offset(offsets, data.size());
+        }
+        b.buffer(offsets);
+        memcpy(b.buffer(data.size()), data.data(), data.size());
+        break;
+    }
+    case arrow_kind::date: {
+        std::vector<int32_t> days(rows, 0);
+        for (size_t i = 0; i < rows; ++i) {
+            ItemView item = values->GetItem(i);
+            if (item.type != Type::Void) {
+                days[i] = static_cast<int32_t>(php_clickhouse_date_item(item) / 86400);
+            }
+        }
+        b.buffer(days);
+        break;
+    }
+    case arrow_kind::timestamp: {
+        std::vector<int64_t> stamps(rows, 0);
+        bool ticks = t.value->GetCode() == Type::DateTime64;
+        for (size_t i = 0; i < rows; ++i) {
+            ItemView item = values->GetItem(i);
+            if (item.type == Type::Void) {
+                continue;
+            }
+            stamps[i] = ticks ? item.get<int64_t>() * t.ticks_to_unit : item.get<uint32_t>();
+        }
+        b.buffer(stamps);
+        break;
+    }
+    case arrow_kind::decimal: {
+        /* 128-bit little-endian two's complement, low word first */
+        std::vector<uint64_t> words(rows * 2, 0);
+        for (size_t i = 0; i < rows; ++i) {
+            ItemView item = values->GetItem(i);
+            if (item.type == Type::Void) {
+                continue;
+            }
+            Int128 raw = php_clickhouse_decimal_item(item);
+            words[i * 2] = absl::Int128Low64(raw);
+            words[i * 2 + 1] = static_cast<uint64_t>(absl::Int128High64(raw));
+        }
+        b.buffer(words);
+        break;
+    }
+    case arrow_kind::list: {
+        auto array = values->As<ColumnArray>();
+        ColumnRef items = CreateColumnByType(t.value->As<ArrayType>()->GetItemType()->GetName());
+        std::vector<int32_t> offsets{0};
+        offsets.reserve(rows + 1);
+        for (size_t i = 0; i < rows; ++i) {
+            items->Append(array->GetAsColumn(i));
+            append_offset(offsets, items->Size());
+        }
+        b.buffer(offsets);
+        write_array(b, items, items->Size());
+        break;
+    }
+    case arrow_kind::structure: {
+        auto tuple = values->As<ColumnTuple>();
+        for (size_t k = 0; k < tuple->TupleSize(); ++k) {
+            write_array(b, (*tuple)[k], rows);
+        }
+        break;
+    }
+    }
+}
+
+} // namespace
+
+void php_clickhouse_arrow_writer::append(const Block &block)
+{
+    if (!schema_written_) {
+        write_schema(out_, block);
+        schema_written_ = true;
+    }
+    size_t rows = block.GetRowCount();
+    if (rows == 0) {
+        return;
+    }
+
+    arrow_batch batch;
+    for (size_t c = 0; c < block.GetColumnCount(); ++c) {
+        write_array(batch, block[c], rows);
+    }
+    batch.body.append((8 - batch.body.size() % 8) % 8, '\0');
+
+    /* length, nodes, buffers */
+    write_message(
+        out_, ARROW_HEADER_RECORD_BATCH,
+        [&](fb_builder &b) {
+            return b.table({fb_scalar<int64_t>(static_cast<int64_t>(rows)),
+                            fb_offset([&](fb_builder &v) { return v.pairs(batch.nodes); }),
+                            fb_offset([&](fb_builder &v) { return v.pairs(batch.buffers); })});
+        },
+        batch.body.size());
+    out_ += batch.body;
+}
+
+std::string php_clickhouse_arrow_writer::finish()
+{
+    if (!schema_written_) {
+        write_schema(out_, Block());
+        schema_written_ = true;
+    }
+    uint32_t end_of_stream[2] = {ARROW_CONTINUATION, 0};
+    out_.append(reinterpret_cast<const char *>(end_of_stream), sizeof(end_of_stream));
+    return std::move(out_);
+}
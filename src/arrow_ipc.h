@@ -0,0 +1,37 @@
+#ifndef PHP_CLICKHOUSE_ARROW_IPC_H
+#define PHP_CLICKHOUSE_ARROW_IPC_H
+
+#include "clickhouse/block.h"
+
+#include <string>
+
+/**
+ * Writes blocks as an Apache Arrow IPC stream (format version 5) without
+ * libarrow: a Schema message from the first block, one RecordBatch per
+ * non-empty block and the end-of-stream marker. Integer and float columns
+ * are copied from the column buffers as they are; Nullable becomes a
+ * validity bitmap and String and Array become 32-bit offset buffers.
+ *
+ *   Int8..Int64, UInt8..UInt64  Int          Float32, Float64  FloatingPoint
+ *   Bool                        Bool         Date, Date32      Date (days)
+ *   DateTime, DateTime64        Timestamp    Decimal           Decimal128
+ *   String, JSON, Enum          Utf8         FixedString       FixedSizeBinary
+ *   Array                       List         Tuple             Struct
+ *
+ * LowCardinality columns are written as their dictionary type. Other types
+ * throw clickhouse::ValidationError.
+ */
+class php_clickhouse_arrow_writer
+{
+  public:
+    void append(const clickhouse::Block &block);
+
+    /* The finished stream; the writer is spent afterwards */
+    std::string finish();
+
+  private:
+    std::string out_;
+    bool schema_written_ = false;
+};
+
+#endif
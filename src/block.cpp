@@ -1,8 +1,13 @@
 #include "src/block.h"
+#include "src/arrow_ipc.h"
 #include "src/column.h"
 #include "src/column_convert.h"
+#include "src/column_filter.h"
 #include "src/common.h"
+#include "src/native_format.h"
+#include "src/text_format.h"
 #include "clickhouse_arginfo.h"
+#include "clickhouse/columns/numeric.h"
 
 zend_class_entry *clickhouse_ce_Block = nullptr;
 static zend_object_handlers clickhouse_block_handlers;
@@ -207,6 +212,174 @@ ZEND_METHOD(ClickHouse_Driver_Block, toArray)
     }
 }
 
+ZEND_METHOD(ClickHouse_Driver_Block, toJson)
+{
+    zend_bool columnar = 0;
+
+    ZEND_PARSE_PARAMETERS_START(0, 1)
+    Z_PARAM_OPTIONAL
+    Z_PARAM_BOOL(columnar)
+    ZEND_PARSE_PARAMETERS_END();
+
+    auto *intern = Z_CLICKHOUSE_BLOCK_P(ZEND_THIS);
+    php_clickhouse_json_writer writer(columnar);
+
+    CLICKHOUSE_TRY
+    if (intern->block) {
+        writer.append(*intern->block);
+    }
+    std::string json = writer.finish();
+    RETVAL_STRINGL(json.data(), json.size());
+    CLICKHOUSE_CATCH
+}
+
+ZEND_METHOD(ClickHouse_Driver_Block, toNative)
+{
+    zval *compression = nullptr;
+
+    ZEND_PARSE_PARAMETERS_START(0, 1)
+    Z_PARAM_OPTIONAL
+    Z_PARAM_ZVAL(compression)
+    ZEND_PARSE_PARAMETERS_END();
+
+    clickhouse::CompressionMethod method;
+    if (!php_clickhouse_native_compression(compression, method)) {
+        return;
+    }
+
+    auto *intern = Z_CLICKHOUSE_BLOCK_P(ZEND_THIS);
+
+    CLICKHOUSE_TRY
+    php_clickhouse_native_writer writer(method);
+    writer.append(intern->block ? *intern->block : clickhouse::Block());
+    const clickhouse::Buffer &out = writer.finish();
+    RETVAL_STRINGL(reinterpret_cast<const char *>(out.data()), out.size());
+    CLICKHOUSE_CATCH
+}
+
+ZEND_METHOD(ClickHouse_Driver_Block, fromNative)
+{
+    zend_string *data;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+    Z_PARAM_STR(data)
+    ZEND_PARSE_PARAMETERS_END();
+
+    CLICKHOUSE_TRY
+    clickhouse::Block block = php_clickhouse_native_read(ZSTR_VAL(data), ZSTR_LEN(data));
+    php_clickhouse_create_block_from_cpp(return_value, block);
+    CLICKHOUSE_CATCH
+}
+
+ZEND_METHOD(ClickHouse_Driver_Block, toArrowIpc)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+
+    auto *intern = Z_CLICKHOUSE_BLOCK_P(ZEND_THIS);
+
+    CLICKHOUSE_TRY
+    php_clickhouse_arrow_writer writer;
+    writer.append(intern->block ? *intern->block : clickhouse::Block());
+    std::string out = writer.finish();
+    RETVAL_STRINGL(out.data(), out.size());
+    CLICKHOUSE_CATCH
+}
+
+ZEND_METHOD(ClickHouse_Driver_Block, slice)
+{
+    zend_long offset = 0;
+    zend_long length = 0;
+    zend_bool length_is_null = 1;
+
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+    Z_PARAM_LONG(offset)
+    Z_PARAM_OPTIONAL
+    Z_PARAM_LONG_OR_NULL(length, length_is_null)
+    ZEND_PARSE_PARAMETERS_END();
+
+    auto *intern = Z_CLICKHOUSE_BLOCK_P(ZEND_THIS);
+    size_t rows = intern->block ? intern->block->GetRowCount() : 0;
+    size_t begin = 0;
+    size_t len = 0;
+    if (!php_clickhouse_slice_range(offset, length, length_is_null, rows, begin, len)) {
+        zend_throw_exception(clickhouse_ce_ValidationException, "Slice out of range", 0);
+        return;
+    }
+
+    CLICKHOUSE_TRY
+    php_clickhouse_create_block_from_cpp(
+        return_value, intern->block ? php_clickhouse_block_slice(*intern->block, begin, len)
+                                    : clickhouse::Block());
+    CLICKHOUSE_CATCH
+}
+
+ZEND_METHOD(ClickHouse_Driver_Block, take)
+{
+    zval *indices = nullptr;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+    Z_PARAM_ARRAY(indices)
+    ZEND_PARSE_PARAMETERS_END();
+
+    auto *intern = Z_CLICKHOUSE_BLOCK_P(ZEND_THIS);
+    size_t row_count = intern->block ? intern->block->GetRowCount() : 0;
+
+    std::vector<size_t> rows;
+    rows.reserve(zend_hash_num_elements(Z_ARRVAL_P(indices)));
+    zval *entry;
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(indices), entry)
+    {
+        if (Z_TYPE_P(entry) != IS_LONG || Z_LVAL_P(entry) < 0 ||
+            static_cast<size_t>(Z_LVAL_P(entry)) >= row_count) {
+            zend_throw_exception(clickhouse_ce_ValidationException, "Row index out of range", 0);
+            return;
+        }
+        rows.push_back(static_cast<size_t>(Z_LVAL_P(entry)));
+    }
+    ZEND_HASH_FOREACH_END();
+
+    CLICKHOUSE_TRY
+    clickhouse::Block empty;
+    php_clickhouse_create_block_from_cpp(
+        return_value, php_clickhouse_block_take(intern->block ? *intern->block : empty, rows));
+    CLICKHOUSE_CATCH
+}
+
+ZEND_METHOD(ClickHouse_Driver_Block, filter)
+{
+    zval *mask_zv = nullptr;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+    Z_PARAM_OBJECT_OF_CLASS(mask_zv, clickhouse_ce_Column)
+    ZEND_PARSE_PARAMETERS_END();
+
+    auto *intern = Z_CLICKHOUSE_BLOCK_P(ZEND_THIS);
+    size_t row_count = intern->block ? intern->block->GetRowCount() : 0;
+    clickhouse::ColumnRef mask = Z_CLICKHOUSE_COLUMN_P(mask_zv)->column;
+    auto bits = mask && mask->Type()->GetCode() == clickhouse::Type::UInt8
+                    ? mask->As<clickhouse::ColumnUInt8>()
+                    : nullptr;
+    if (!bits || bits->Size() != row_count) {
+        zend_throw_exception_ex(clickhouse_ce_ValidationException, 0,
+                                "Filter mask must be a UInt8 column of %zu rows", row_count);
+        return;
+    }
+
+    CLICKHOUSE_TRY
+    const auto &data = bits->GetWritableData();
+    std::vector<size_t> rows;
+    rows.reserve(row_count);
+    for (size_t i = 0; i < row_count; ++i) {
+        if (data[i]) {
+            rows.push_back(i);
+        }
+    }
+    clickhouse::Block empty;
+    php_clickhouse_create_block_from_cpp(
+        return_value, php_clickhouse_block_take(intern->block ? *intern->block : empty, rows));
+    CLICKHOUSE_CATCH
+}
+
 void php_clickhouse_create_block_from_cpp(zval *return_value, const clickhouse::Block &cpp_block)
 {
     object_init_ex(return_value, clickhouse_ce_Block);
@@ -240,6 +413,22 @@ static const zend_function_entry class_ClickHouse_Driver_Block_methods[] = {
                                 ZEND_ACC_PUBLIC)
                             ZEND_ME(ClickHouse_Driver_Block, toArray,
                                     arginfo_class_ClickHouse_Driver_Block_toArray, ZEND_ACC_PUBLIC)
+                            ZEND_ME(ClickHouse_Driver_Block, toJson,
+                                    arginfo_class_ClickHouse_Driver_Block_toJson, ZEND_ACC_PUBLIC)
+                            ZEND_ME(ClickHouse_Driver_Block, toNative,
+                                    arginfo_class_ClickHouse_Driver_Block_toNative, ZEND_ACC_PUBLIC)
+                            ZEND_ME(ClickHouse_Driver_Block, fromNative,
+                                    arginfo_class_ClickHouse_Driver_Block_fromNative,
+                                    ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+                            ZEND_ME(ClickHouse_Driver_Block, toArrowIpc,
+                                    arginfo_class_ClickHouse_Driver_Block_toArrowIpc,
+                                    ZEND_ACC_PUBLIC)
+                            ZEND_ME(ClickHouse_Driver_Block, slice,
+                                    arginfo_class_ClickHouse_Driver_Block_slice, ZEND_ACC_PUBLIC)
+                            ZEND_ME(ClickHouse_Driver_Block, take,
+                                    arginfo_class_ClickHouse_Driver_Block_take, ZEND_ACC_PUBLIC)
+                            ZEND_ME(ClickHouse_Driver_Block, filter,
+                                    arginfo_class_ClickHouse_Driver_Block_filter, ZEND_ACC_PUBLIC)
                                 ZEND_FE_END};
 
 void php_clickhouse_register_block(int module_number)
@@ -1,12 +1,25 @@
 #include "src/client.h"
+#include "src/arrow_ipc.h"
 #include "src/client_options.h"
 #include "src/block.h"
 #include "src/column.h"
 #include "src/column_convert.h"
+#include "src/column_filter.h"
 #include "src/common.h"
+#include "src/native_format.h"
+#include "src/result_cache.h"
+#include "src/text_format.h"
 #include "clickhouse_arginfo.h"
 #include "clickhouse/query.h"
 
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <thread>
+
 zend_class_entry *clickhouse_ce_Client = nullptr;
 static zend_object_handlers clickhouse_client_handlers;
 
@@ -16,6 +29,16 @@ static zend_object *php_clickhouse_client_create(zend_class_entry *ce)
         static_cast<php_clickhouse_client *>(zend_object_alloc(sizeof(php_clickhouse_client), ce));
 
     new (&intern->client) std::unique_ptr<clickhouse::Client>();
+    new (&intern->connect_state) std::shared_ptr<php_clickhouse_connect_state>();
+    new (&intern->pending) std::unique_ptr<php_clickhouse_pending_connect>();
+    intern->in_query = false;
+    new (&intern->hedge) std::unique_ptr<php_clickhouse_hedge>();
+    new (&intern->fan_out) std::unique_ptr<php_clickhouse_fan_out>();
+    intern->read_ahead_blocks = 0;
+    new (&intern->compression) php_clickhouse_adaptive_compression();
+    new (&intern->memory) php_clickhouse_memory_budget();
+    new (&intern->cache_scope) std::string();
+    new (&intern->background) std::vector<php_clickhouse_background_query>();
 
     zend_object_std_init(&intern->std, ce);
     object_properties_init(&intern->std, ce);
@@ -27,10 +50,145 @@ static zend_object *php_clickhouse_client_create(zend_class_entry *ce)
 static void php_clickhouse_client_free(zend_object *object)
 {
     auto *intern = php_clickhouse_client_from_obj(object);
+    if (intern->in_query) {
+        /* A fatal error or timeout left a query running: drop the connection
+         * without draining it, the server cancels once the socket closes */
+        for (auto &query : intern->background) {
+            query.runner->cancel();
+            if (query.connect_state) {
+                php_clickhouse_connect_abort(*query.connect_state);
+            }
+        }
+        intern->background.clear();
+        intern->client.reset();
+    }
+    intern->background.~vector();
+    intern->memory.~php_clickhouse_memory_budget();
+    intern->cache_scope.std::string::~string();
+    if (intern->hedge && intern->hedge->straggler && intern->hedge->connect_state) {
+        /* Do not wait for a losing query to finish on the server */
+        php_clickhouse_connect_abort(*intern->hedge->connect_state);
+    }
+    intern->hedge.~unique_ptr();
+    intern->fan_out.~unique_ptr();
     intern->client.~unique_ptr();
+    intern->connect_state.~shared_ptr();
+    intern->pending.~unique_ptr();
     zend_object_std_dtor(object);
 }
 
+/* Connect with the driver's socket factory, which tracks the socket in
+ * `state` so another thread can abort a query running on it */
+static std::unique_ptr<clickhouse::Client>
+php_clickhouse_client_new(const clickhouse::ClientOptions &options,
+                          const php_clickhouse_connect_options &connect,
+                          std::shared_ptr<php_clickhouse_connect_state> &state)
+{
+    state = std::make_shared<php_clickhouse_connect_state>();
+    auto factory = std::make_unique<php_clickhouse_socket_factory>(connect, state);
+    return std::make_unique<clickhouse::Client>(options, std::move(factory));
+}
+
+static void php_clickhouse_client_open(php_clickhouse_client *intern,
+                                       const clickhouse::ClientOptions &options,
+                                       const php_clickhouse_extra_options &extra)
+{
+    const php_clickhouse_connect_options &connect = extra.connect;
+    bool hedged = extra.hedge_delay.count() > 0;
+    if (hedged) {
+        intern->hedge.reset(new php_clickhouse_hedge{options, connect, extra.hedge_delay, nullptr,
+                                                     nullptr, nullptr});
+    }
+
+    /* TLS always goes through our factory so handshakes share the cached
+     * SSL_CTX and resume the previous session of the endpoint; hedging and
+     * read-ahead need it to abort a query running on another thread, and
+     * adaptive compression to count wire bytes */
+    bool custom_connect = connect.parallelism > 1 || connect.dns.ttl.count() > 0 ||
+                          connect.tls || connect.io_uring || connect.zero_copy_threshold > 0 ||
+                          hedged || extra.read_ahead_blocks > 0 || extra.adaptive_compression;
+    if (custom_connect) {
+        intern->client = php_clickhouse_client_new(options, connect, intern->connect_state);
+    } else {
+        intern->client = std::make_unique<clickhouse::Client>(options);
+    }
+}
+
+static void php_clickhouse_client_open_pending(php_clickhouse_client *intern)
+{
+    CLICKHOUSE_TRY
+    php_clickhouse_client_open(intern, intern->pending->options, intern->pending->extra);
+    /* Kept on failure so the next call retries the connect */
+    intern->pending.reset();
+    CLICKHOUSE_CATCH
+}
+
+/* The connection was shut down under a running query (lost hedge race) */
+static void php_clickhouse_client_reconnect(php_clickhouse_client *intern)
+{
+    CLICKHOUSE_TRY
+    intern->client->ResetConnection();
+    CLICKHOUSE_CATCH
+}
+
+static std::optional<clickhouse::Endpoint>
+php_clickhouse_client_endpoint(php_clickhouse_client *intern)
+{
+    std::optional<clickhouse::Endpoint> ep = intern->client->GetCurrentEndpoint();
+    if (intern->connect_state) {
+        /* A connect race may have settled on another failover endpoint */
+        std::lock_guard<std::mutex> guard(intern->connect_state->lock);
+        if (intern->connect_state->endpoint) {
+            ep = intern->connect_state->endpoint;
+        }
+    }
+    return ep;
+}
+
+/* Returns false with an exception pending when called from a callback of a
+ * running query on the same client */
+static bool php_clickhouse_client_idle(php_clickhouse_client *intern)
+{
+    if (intern->in_query) {
+        zend_throw_exception(clickhouse_ce_ClickHouseException,
+                             "Client is busy with another query", 0);
+        return false;
+    }
+    return true;
+}
+
+/* Returns false with an exception pending when no connection can be used.
+ * lazyConnect clients connect here on their first call. */
+static bool php_clickhouse_client_connected(php_clickhouse_client *intern)
+{
+    if (!php_clickhouse_client_idle(intern)) {
+        return false;
+    }
+    if (!intern->client && intern->pending) {
+        php_clickhouse_client_open_pending(intern);
+    }
+    if (intern->client && intern->connect_state && intern->connect_state->aborted) {
+        php_clickhouse_client_reconnect(intern);
+    }
+    if (intern->client && !EG(exception)) {
+        return true;
+    }
+    if (!EG(exception)) {
+        zend_throw_exception(clickhouse_ce_ClickHouseException, "Client not connected", 0);
+    }
+    return false;
+}
+
+static std::string php_clickhouse_client_cache_scope(const clickhouse::ClientOptions &options)
+{
+    std::string scope = options.host + ":" + std::to_string(options.port);
+    for (const auto &endpoint : options.endpoints) {
+        scope += "," + endpoint.host + ":" + std::to_string(endpoint.port);
+    }
+    scope += "/" + options.default_database + "/" + options.user;
+    return scope;
+}
+
 ZEND_METHOD(ClickHouse_Driver_Client, __construct)
 {
     zval *options_zv = nullptr;
@@ -49,7 +207,20 @@ ZEND_METHOD(ClickHouse_Driver_Client, __construct)
     auto *intern = Z_CLICKHOUSE_CLIENT_P(ZEND_THIS);
 
     CLICKHOUSE_TRY
-    intern->client = std::make_unique<clickhouse::Client>(*opts_intern->options);
+    intern->fan_out.reset(
+        new php_clickhouse_fan_out{*opts_intern->options, opts_intern->extra.connect, {}});
+    intern->read_ahead_blocks = opts_intern->extra.read_ahead_blocks;
+    intern->compression.enabled = opts_intern->extra.adaptive_compression;
+    intern->memory.block_bytes = opts_intern->extra.block_memory_budget;
+    intern->memory.limit_fraction = opts_intern->extra.memory_limit_fraction;
+    intern->cache_scope = php_clickhouse_client_cache_scope(*opts_intern->options);
+    if (opts_intern->extra.lazy_connect) {
+        /* Copied so later changes to the ClientOptions object cannot leak in */
+        intern->pending.reset(
+            new php_clickhouse_pending_connect{*opts_intern->options, opts_intern->extra});
+    } else {
+        php_clickhouse_client_open(intern, *opts_intern->options, opts_intern->extra);
+    }
     CLICKHOUSE_CATCH
 }
 
@@ -109,51 +280,1380 @@ static clickhouse::Query build_query(zend_string *query_str, zval *params, zval
     return q;
 }
 
-ZEND_METHOD(ClickHouse_Driver_Client, execute)
+/* True once the request that runs the query is going away: the HTTP client
+ * disconnected (unless ignore_user_abort is set), max_execution_time fired or
+ * the engine is shutting down. PHP only notices a disconnect when output is
+ * flushed, so streaming scripts benefit most. */
+static bool php_clickhouse_request_aborted()
 {
-    zend_string *query = nullptr;
-    zval *params = nullptr;
-    zval *settings = nullptr;
-    zend_string *query_id = nullptr;
+    if ((PG(connection_status) & PHP_CONNECTION_ABORTED) && !PG(ignore_user_abort)) {
+        return true;
+    }
+#if PHP_VERSION_ID >= 80200
+    if (zend_atomic_bool_load_ex(&EG(timed_out))) {
+        return true;
+    }
+#else
+    if (EG(timed_out)) {
+        return true;
+    }
+#endif
+    return (EG(flags) & EG_FLAGS_IN_SHUTDOWN) != 0;
+}
 
-    ZEND_PARSE_PARAMETERS_START(1, 4)
-    Z_PARAM_STR(query)
-    Z_PARAM_OPTIONAL
-    Z_PARAM_ARRAY_EX(params, 1, 0)
-    Z_PARAM_ARRAY_EX(settings, 1, 0)
-    Z_PARAM_STR_OR_NULL(query_id)
-    ZEND_PARSE_PARAMETERS_END();
+/* How often a wait on background queries with nothing to deliver wakes up
+ * to check the deadline and the request */
+#define PHP_CLICKHOUSE_WATCH_POLL std::chrono::milliseconds(100)
 
-    auto *intern = Z_CLICKHOUSE_CLIENT_P(ZEND_THIS);
-    if (!intern->client) {
-        zend_throw_exception(clickhouse_ce_ClickHouseException, "Client not connected", 0);
+/* Reasons to cancel a running query, checked whenever a data block arrives.
+ * timeoutMs is additionally enforced by the server through max_execution_time,
+ * so it also holds while nothing arrives. */
+struct php_clickhouse_query_watch
+{
+    std::chrono::milliseconds timeout{0};
+    std::chrono::steady_clock::time_point at;
+    /* Latched once a callback asked for a cancel */
+    bool expired = false;
+    bool aborted = false;
+    /* Set when the next block would have crossed memoryLimitFraction */
+    std::string memory_error;
+
+    bool enabled() const
+    {
+        return timeout.count() > 0;
+    }
+
+    bool cancel_requested()
+    {
+        if (enabled() && !expired && std::chrono::steady_clock::now() >= at) {
+            expired = true;
+        }
+        if (!aborted && php_clickhouse_request_aborted()) {
+            aborted = true;
+        }
+        return expired || aborted;
+    }
+
+    /* When a wait on background queries should give up to call cancel_requested() */
+    std::chrono::steady_clock::time_point next_check() const
+    {
+        auto poll = std::chrono::steady_clock::now() + PHP_CLICKHOUSE_WATCH_POLL;
+        return enabled() && at < poll ? at : poll;
+    }
+};
+
+/* Arm the deadline from a nullable timeoutMs. Returns false with an exception pending. */
+static bool php_clickhouse_watch_init(php_clickhouse_query_watch &watch, zend_long timeout_ms,
+                                      zend_bool timeout_is_null)
+{
+    if (timeout_is_null) {
+        return true;
+    }
+    if (timeout_ms <= 0) {
+        zend_throw_exception(clickhouse_ce_ValidationException, "timeoutMs must be greater than 0",
+                             0);
+        return false;
+    }
+    watch.timeout = std::chrono::milliseconds(timeout_ms);
+    watch.at = std::chrono::steady_clock::now() + watch.timeout;
+    return true;
+}
+
+/* Have the server stop the query at the deadline too. A max_execution_time the
+ * caller set is kept when it is the tighter limit; 0 (no limit) or a longer one
+ * is replaced by the deadline. */
+static void apply_deadline(clickhouse::Query &q, zval *settings,
+                           const php_clickhouse_query_watch &watch)
+{
+    if (!watch.enabled()) {
+        return;
+    }
+    double limit = watch.timeout.count() / 1000.0;
+    zval *own = nullptr;
+    if (settings && Z_TYPE_P(settings) == IS_ARRAY) {
+        own = zend_hash_str_find(Z_ARRVAL_P(settings), "max_execution_time",
+                                 sizeof("max_execution_time") - 1);
+    }
+    if (own) {
+        /* Sent as a string like every setting, so read it the way the server will */
+        zend_string *str = zval_get_string(own);
+        char *end = nullptr;
+        double value = strtod(ZSTR_VAL(str), &end);
+        bool numeric = ZSTR_LEN(str) > 0 && end == ZSTR_VAL(str) + ZSTR_LEN(str);
+        zend_string_release(str);
+        /* Leave values the server has to judge, and limits tighter than ours */
+        if (!numeric || (value > 0 && value <= limit)) {
+            return;
+        }
+    }
+
+    char seconds[32];
+    snprintf(seconds, sizeof(seconds), "%.3f", limit);
+    clickhouse::QuerySettingsField field;
+    field.value = seconds;
+    field.flags = clickhouse::QuerySettingsField::IMPORTANT;
+    q.SetSetting("max_execution_time", field);
+}
+
+static std::string deadline_message(const php_clickhouse_query_watch &watch)
+{
+    return "Query exceeded timeoutMs of " + std::to_string(watch.timeout.count()) + " ms";
+}
+
+/* CompressionMethod::Adaptive: results smaller than this on the wire, or
+ * arriving in fewer bytes after their first block, say too little about the link */
+#define PHP_CLICKHOUSE_ADAPTIVE_MIN_SAMPLE (64 * 1024)
+/* Every so many adaptive selects use the codec that was not picked, so its
+ * figures follow changes in the data */
+#define PHP_CLICKHOUSE_ADAPTIVE_EXPLORE_EVERY 64
+
+/* An adaptive query in flight */
+struct php_clickhouse_adaptive_query
+{
+    using clock = std::chrono::steady_clock;
+
+    std::shared_ptr<php_clickhouse_connect_state> state;
+    /* Stats of the codec the result is sent with; null when not adaptive */
+    php_clickhouse_codec_stats *codec = nullptr;
+    uint64_t wire_start = 0;
+    /* Wire bytes and socket wait at the first and the last block with rows */
+    php_clickhouse_connect_state *window = nullptr;
+    uint64_t wire_first = 0;
+    uint64_t wire_last = 0;
+    uint64_t read_first = 0;
+    uint64_t read_last = 0;
+    /* Decoding is timed when the result is received on the PHP thread: the
+     * time clickhouse-cpp spends between two callbacks, less the socket wait */
+    bool timed = false;
+    clock::time_point left;
+    uint64_t read_left = 0;
+    double decode_seconds = 0;
+    /* Uncompressed size of the result, from the server's profile packet */
+    uint64_t result_bytes = 0;
+
+    void on_profile(const clickhouse::Profile &profile)
+    {
+        result_bytes = profile.bytes;
+    }
+
+    /* `current` is the connection the block came from, which a won hedge
+     * race may have swapped in since the query started */
+    void on_block(php_clickhouse_connect_state *current, const clickhouse::Block &block)
+    {
+        if (!codec || !current) {
+            return;
+        }
+        if (timed) {
+            double busy = std::chrono::duration<double>(clock::now() - left).count() -
+                          static_cast<double>(current->read_ns - read_left) / 1e9;
+            decode_seconds += std::max(0.0, busy);
+        }
+        if (block.GetRowCount() == 0) {
+            return;
+        }
+        if (!window) {
+            window = current;
+            wire_first = current->bytes_received;
+            read_first = current->read_ns;
+        }
+        if (window == current) {
+            wire_last = current->bytes_received;
+            read_last = current->read_ns;
+        }
+    }
+
+    /* After the caller's callback returned */
+    void block_done()
+    {
+        if (timed) {
+            left = clock::now();
+            read_left = state->read_ns;
+        }
+    }
+};
+
+static double php_clickhouse_adaptive_average(double current, double sample, bool first)
+{
+    return first ? sample : current * 0.7 + sample * 0.3;
+}
+
+/* Seconds to receive and decode one uncompressed byte of a result */
+static double php_clickhouse_adaptive_cost(const php_clickhouse_adaptive_compression &ac,
+                                           const php_clickhouse_codec_stats &codec)
+{
+    return 1.0 / (codec.ratio * ac.bandwidth) + codec.decode;
+}
+
+/* Pick how the server compresses this result, LZ4 or ZSTD: whichever costs
+ * least to receive at the measured bandwidth and to decode at the measured
+ * speed. Each codec is tried first until a result has measured it, and the
+ * one not picked again every so often. The codec is a per-query setting, so
+ * the connection and its session stay as they are. Skipped when the caller
+ * sets network_compression_method. */
+static void php_clickhouse_adaptive_begin(php_clickhouse_client *intern, clickhouse::Query &q,
+                                          zval *settings, php_clickhouse_adaptive_query &aq)
+{
+    php_clickhouse_adaptive_compression &ac = intern->compression;
+    if (!ac.enabled || !intern->connect_state) {
+        return;
+    }
+    if (settings && Z_TYPE_P(settings) == IS_ARRAY &&
+        zend_hash_str_exists(Z_ARRVAL_P(settings), "network_compression_method",
+                             sizeof("network_compression_method") - 1)) {
+        return;
+    }
+
+    bool zstd;
+    if (ac.lz4.queries == 0 || ac.zstd.queries == 0 || ac.bandwidth == 0) {
+        zstd = ac.lz4.queries > 0 && ac.zstd.queries == 0;
+    } else {
+        zstd = php_clickhouse_adaptive_cost(ac, ac.zstd) < php_clickhouse_adaptive_cost(ac, ac.lz4);
+        if (++ac.since_explore >= PHP_CLICKHOUSE_ADAPTIVE_EXPLORE_EVERY) {
+            ac.since_explore = 0;
+            zstd = !zstd;
+        }
+    }
+    /* Higher levels only pay off on slow links; decoding speed barely changes */
+    ac.zstd_level = ac.bandwidth > 0 && ac.bandwidth < 16e6 ? 3 : 1;
+
+    clickhouse::QuerySettingsField field;
+    field.flags = clickhouse::QuerySettingsField::IMPORTANT;
+    field.value = zstd ? "ZSTD" : "LZ4";
+    q.SetSetting("network_compression_method", field);
+    if (zstd) {
+        field.value = std::to_string(ac.zstd_level);
+        q.SetSetting("network_zstd_compression_level", field);
+    }
+    ac.last = zstd ? "ZSTD" : "LZ4";
+    aq.codec = zstd ? &ac.zstd : &ac.lz4;
+
+    aq.state = intern->connect_state;
+    aq.wire_start = aq.state->bytes_received;
+    aq.timed = !intern->hedge && intern->read_ahead_blocks == 0;
+    aq.block_done();
+}
+
+/* Fold a finished adaptive query into the averages: the bandwidth from the
+ * bytes received between its first and last block and the time spent
+ * waiting for them, and the ratio and decode speed of the codec it used */
+static void php_clickhouse_adaptive_end(php_clickhouse_client *intern,
+                                        const php_clickhouse_adaptive_query &aq)
+{
+    if (!aq.codec) {
+        return;
+    }
+    php_clickhouse_adaptive_compression &ac = intern->compression;
+    uint64_t window = aq.wire_last - aq.wire_first;
+    if (window >= PHP_CLICKHOUSE_ADAPTIVE_MIN_SAMPLE && aq.read_last > aq.read_first) {
+        double seconds = static_cast<double>(aq.read_last - aq.read_first) / 1e9;
+        ac.bandwidth = php_clickhouse_adaptive_average(ac.bandwidth, window / seconds,
+                                                       ac.bandwidth == 0);
+    }
+
+    /* After a won hedge race the result came over the other connection */
+    if (intern->connect_state != aq.state) {
+        return;
+    }
+    uint64_t wire = aq.state->bytes_received - aq.wire_start;
+    if (wire < PHP_CLICKHOUSE_ADAPTIVE_MIN_SAMPLE || aq.result_bytes == 0) {
+        return;
+    }
+    php_clickhouse_codec_stats &codec = *aq.codec;
+    bool first = codec.queries == 0;
+    codec.ratio = php_clickhouse_adaptive_average(
+        codec.ratio, static_cast<double>(aq.result_bytes) / wire, first);
+    if (aq.timed) {
+        codec.decode = php_clickhouse_adaptive_average(
+            codec.decode, aq.decode_seconds / static_cast<double>(aq.result_bytes),
+            codec.decode == 0);
+    }
+    codec.queries++;
+}
+
+/* blockMemoryBudget never asks for blocks outside this many rows */
+#define PHP_CLICKHOUSE_BUDGET_MIN_ROWS 64
+#define PHP_CLICKHOUSE_BUDGET_MAX_ROWS (1024 * 1024)
+
+/* blockMemoryBudget and memoryLimitFraction for one select */
+struct php_clickhouse_memory_plan
+{
+    bool active = false;
+    std::string query;
+    /* PHP bytes per converted row; zero until the header block arrives */
+    size_t row_cost = 0;
+    /* zend_memory_usage() the result may not push past; zero for no limit */
+    size_t limit = 0;
+};
+
+/* PHP heap one row takes once converted to an associative array and added to a result */
+static size_t php_clickhouse_row_cost(const clickhouse::Block &block)
+{
+    size_t cols = block.GetColumnCount();
+    size_t slots = 8;
+    while (slots < cols) {
+        slots <<= 1;
+    }
+    /* The row's zend_array, its Buckets and hash, and its slot in the result */
+    size_t cost = sizeof(zend_array) + slots * (sizeof(Bucket) + 2 * sizeof(uint32_t)) +
+                  sizeof(Bucket);
+    for (size_t c = 0; c < cols; ++c) {
+        /* Each row gets its own copy of the key */
+        cost += _ZSTR_HEADER_SIZE + block.GetColumnName(c).size() + 1;
+        cost += php_clickhouse_value_cost(block[c]->Type());
+    }
+    return cost;
+}
+
+static bool php_clickhouse_setting_given(zval *settings, const char *name, size_t len)
+{
+    return settings && Z_TYPE_P(settings) == IS_ARRAY &&
+           zend_hash_str_exists(Z_ARRVAL_P(settings), name, len);
+}
+
+/* The memoryLimitFraction part of a plan, and the row cost if known */
+static void php_clickhouse_memory_plan_init(php_clickhouse_client *intern, zend_string *query,
+                                            php_clickhouse_memory_plan &plan)
+{
+    const php_clickhouse_memory_budget &mb = intern->memory;
+    if (mb.limit_fraction > 0 && PG(memory_limit) > 0) {
+        plan.limit = static_cast<size_t>(mb.limit_fraction * PG(memory_limit));
+    }
+    if (mb.block_bytes == 0 && plan.limit == 0) {
+        return;
+    }
+    plan.active = true;
+    plan.query.assign(ZSTR_VAL(query), ZSTR_LEN(query));
+    auto known = mb.row_costs.find(plan.query);
+    if (known != mb.row_costs.end()) {
+        plan.row_cost = known->second;
+    }
+}
+
+static void php_clickhouse_remember_row_cost(php_clickhouse_client *intern,
+                                             php_clickhouse_memory_plan &plan,
+                                             const clickhouse::Block &header)
+{
+    plan.row_cost = php_clickhouse_row_cost(header);
+    auto &costs = intern->memory.row_costs;
+    if (costs.size() >= PHP_CLICKHOUSE_ROW_COST_CACHE) {
+        costs.clear();
+    }
+    costs[plan.query] = plan.row_cost;
+}
+
+/* Size the server's blocks so one converted block fits blockMemoryBudget:
+ * max_block_size = budget / row cost. The row cost comes from the header
+ * block the server sends before any data, too late to size that query's
+ * blocks, so it is remembered per query text. Until it is known only
+ * preferred_block_size_bytes is capped, at a quarter of the budget. Settings
+ * given by the caller are left alone. */
+static void php_clickhouse_memory_begin(php_clickhouse_client *intern, clickhouse::Query &q,
+                                        zend_string *query, zval *settings,
+                                        php_clickhouse_memory_plan &plan)
+{
+    const php_clickhouse_memory_budget &mb = intern->memory;
+    php_clickhouse_memory_plan_init(intern, query, plan);
+    if (mb.block_bytes == 0) {
+        return;
+    }
+
+    clickhouse::QuerySettingsField field;
+    field.flags = clickhouse::QuerySettingsField::IMPORTANT;
+    if (!php_clickhouse_setting_given(settings, "max_block_size",
+                                      sizeof("max_block_size") - 1)) {
+        if (plan.row_cost) {
+            size_t rows = std::clamp<size_t>(mb.block_bytes / plan.row_cost,
+                                             PHP_CLICKHOUSE_BUDGET_MIN_ROWS,
+                                             PHP_CLICKHOUSE_BUDGET_MAX_ROWS);
+            field.value = std::to_string(rows);
+            q.SetSetting("max_block_size", field);
+        }
+    }
+    if (!php_clickhouse_setting_given(settings, "preferred_block_size_bytes",
+                                      sizeof("preferred_block_size_bytes") - 1)) {
+        /* Native column bytes, which converted rows always exceed */
+        field.value = std::to_string(plan.row_cost ? mb.block_bytes : mb.block_bytes / 4);
+        q.SetSetting("preferred_block_size_bytes", field);
+    }
+}
+
+/* Called before a block is converted. Learns the row cost from the header
+ * block when it is not known yet; returns false, with the reason in `watch`,
+ * when converting this block would push PHP past memoryLimitFraction. */
+static bool php_clickhouse_memory_check(php_clickhouse_client *intern,
+                                        php_clickhouse_memory_plan &plan,
+                                        const clickhouse::Block &block,
+                                        php_clickhouse_query_watch &watch)
+{
+    if (!plan.active) {
+        return true;
+    }
+    if (plan.row_cost == 0 && block.GetColumnCount() > 0) {
+        php_clickhouse_remember_row_cost(intern, plan, block);
+    }
+
+    size_t rows = block.GetRowCount();
+    if (plan.limit == 0 || rows == 0) {
+        return true;
+    }
+    size_t needed = zend_memory_usage(0) + rows * plan.row_cost;
+    if (needed <= plan.limit) {
+        return true;
+    }
+    watch.memory_error = "Query cancelled: a block of " + std::to_string(rows) +
+                         " rows would take PHP memory to about " + std::to_string(needed) +
+                         " bytes, over memoryLimitFraction of memory_limit (" +
+                         std::to_string(plan.limit) + " bytes)";
+    return false;
+}
+
+/* selectByBlock minRows/maxRows: merges consecutive small blocks from the
+ * server until they hold minRows rows, and cuts blocks of more than maxRows
+ * rows into slices, before the callback sees them */
+class php_clickhouse_block_regroup
+{
+  public:
+    php_clickhouse_block_regroup(size_t min_rows, size_t max_rows)
+        : min_rows_(min_rows), max_rows_(max_rows)
+    {
+    }
+
+    /* Returns false once `emit` asked to stop */
+    template <typename Emit> bool push(const clickhouse::Block &block, Emit &&emit)
+    {
+        if (pending_rows_ == 0 && block.GetRowCount() >= min_rows_) {
+            return emit_sliced(block, emit);
+        }
+        append(block);
+        return pending_rows_ < min_rows_ || flush(emit);
+    }
+
+    /* Hand over what is left at the end of the result */
+    template <typename Emit> bool flush(Emit &&emit)
+    {
+        if (pending_rows_ == 0) {
+            return true;
+        }
+        clickhouse::Block merged;
+        for (auto &column : pending_) {
+            merged.AppendColumn(column.first, column.second);
+        }
+        pending_.clear();
+        pending_rows_ = 0;
+        return emit_sliced(merged, emit);
+    }
+
+  private:
+    void append(const clickhouse::Block &block)
+    {
+        size_t cols = block.GetColumnCount();
+        if (pending_rows_ == 0) {
+            /* Appending copies, so the blocks received stay untouched */
+            pending_.clear();
+            for (size_t c = 0; c < cols; ++c) {
+                auto column = block[c]->CloneEmpty();
+                column->Append(block[c]);
+                pending_.emplace_back(block.GetColumnName(c), column);
+            }
+        } else {
+            for (size_t c = 0; c < cols; ++c) {
+                pending_[c].second->Append(block[c]);
+            }
+        }
+        pending_rows_ += block.GetRowCount();
+    }
+
+    template <typename Emit> bool emit_sliced(const clickhouse::Block &block, Emit &emit)
+    {
+        size_t rows = block.GetRowCount();
+        if (max_rows_ == 0 || rows <= max_rows_) {
+            return emit(block);
+        }
+        for (size_t offset = 0; offset < rows; offset += max_rows_) {
+            size_t len = std::min(max_rows_, rows - offset);
+            if (!emit(php_clickhouse_block_slice(block, offset, len))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t min_rows_;
+    size_t max_rows_;
+    std::vector<std::pair<std::string, clickhouse::ColumnRef>> pending_;
+    size_t pending_rows_ = 0;
+};
+
+/* Clears in_query on normal return and on C++ exceptions. A PHP bailout from
+ * inside a callback skips it, which is how free_obj spots an abandoned query. */
+struct php_clickhouse_in_query_scope
+{
+    explicit php_clickhouse_in_query_scope(php_clickhouse_client *intern) : intern_(intern)
+    {
+        intern_->in_query = true;
+    }
+    ~php_clickhouse_in_query_scope()
+    {
+        intern_->in_query = false;
+    }
+
+    php_clickhouse_in_query_scope(const php_clickhouse_in_query_scope &) = delete;
+    php_clickhouse_in_query_scope &operator=(const php_clickhouse_in_query_scope &) = delete;
+
+  private:
+    php_clickhouse_client *intern_;
+};
+
+/* Cancels and joins the background queries of a call when it returns or
+ * throws; runners still queued to the server are drained first */
+struct php_clickhouse_background_scope
+{
+    explicit php_clickhouse_background_scope(php_clickhouse_client *intern) : intern_(intern)
+    {
+    }
+    ~php_clickhouse_background_scope()
+    {
+        intern_->background.clear();
+    }
+
+    php_clickhouse_background_scope(const php_clickhouse_background_scope &) = delete;
+    php_clickhouse_background_scope &operator=(const php_clickhouse_background_scope &) = delete;
+
+  private:
+    php_clickhouse_client *intern_;
+};
+
+/* Run a query and report why callbacks cancelled it. After a cancel
+ * clickhouse-cpp drains the stream, so the connection stays usable. */
+template <typename Run>
+static void run_watched(php_clickhouse_client *intern, const php_clickhouse_query_watch &watch,
+                        Run &&run)
+{
+    php_clickhouse_in_query_scope scope(intern);
+
+    try {
+        run();
+    } catch (const clickhouse::ServerException &e) {
+        /* TIMEOUT_EXCEEDED from max_execution_time, or the answer to our Cancel */
+        if (watch.enabled() && (e.GetCode() == 159 || (watch.expired && e.GetCode() == 394))) {
+            throw php_clickhouse_timeout_error(deadline_message(watch) + ": " + e.what());
+        }
+        if (watch.aborted && e.GetCode() == 394) {
+            throw clickhouse::Error("Query cancelled: the request was aborted");
+        }
+        if (!watch.memory_error.empty() && e.GetCode() == 394) {
+            throw php_clickhouse_memory_error(watch.memory_error);
+        }
+        throw;
+    }
+    if (!watch.memory_error.empty()) {
+        throw php_clickhouse_memory_error(watch.memory_error);
+    }
+    if (watch.expired) {
+        throw php_clickhouse_timeout_error(deadline_message(watch));
+    }
+    if (watch.aborted) {
+        throw clickhouse::Error("Query cancelled: the request was aborted");
+    }
+}
+
+/* Options for the hedge connection: every configured endpoint except the one
+ * the primary is on, starting after it, with the primary's as a last resort */
+static bool php_clickhouse_hedge_options(const php_clickhouse_hedge &hedge,
+                                         const std::optional<clickhouse::Endpoint> &current,
+                                         clickhouse::ClientOptions &out)
+{
+    std::vector<clickhouse::Endpoint> all;
+    if (!hedge.options.host.empty()) {
+        all.push_back({hedge.options.host, hedge.options.port});
+    }
+    all.insert(all.end(), hedge.options.endpoints.begin(), hedge.options.endpoints.end());
+
+    auto same = [](const clickhouse::Endpoint &a, const clickhouse::Endpoint &b) {
+        return a.host == b.host && a.port == b.port;
+    };
+    size_t first = 0;
+    for (size_t i = 0; current && i < all.size(); ++i) {
+        if (same(all[i], *current)) {
+            first = i + 1;
+            break;
+        }
+    }
+
+    std::vector<clickhouse::Endpoint> order;
+    for (size_t i = 0; i < all.size(); ++i) {
+        const auto &ep = all[(first + i) % all.size()];
+        if (!current || !same(ep, *current)) {
+            order.push_back(ep);
+        }
+    }
+    if (order.empty()) {
+        return false;
+    }
+    if (current) {
+        order.push_back(*current);
+    }
+
+    out = hedge.options;
+    out.host.clear();
+    out.endpoints = std::move(order);
+    return true;
+}
+
+/* Send the query over the hedge connection, opening it on first use.
+ * Returns null when no second endpoint is reachable. */
+static std::unique_ptr<php_clickhouse_query_runner>
+php_clickhouse_hedge_start(php_clickhouse_client *intern, const clickhouse::Query &q,
+                           const clickhouse::ExternalTables &tables,
+                           std::shared_ptr<php_clickhouse_runner_signal> signal)
+{
+    php_clickhouse_hedge &hedge = *intern->hedge;
+    try {
+        if (!hedge.client) {
+            clickhouse::ClientOptions options;
+            if (!php_clickhouse_hedge_options(hedge, php_clickhouse_client_endpoint(intern),
+                                              options)) {
+                return nullptr;
+            }
+            hedge.client = php_clickhouse_client_new(options, hedge.connect, hedge.connect_state);
+        } else if (hedge.connect_state->aborted) {
+            hedge.client->ResetConnection();
+        }
+    } catch (const std::exception &) {
+        /* Keep waiting on the primary; the next hedge retries the connect */
+        hedge.client.reset();
+        hedge.connect_state.reset();
+        return nullptr;
+    }
+
+    auto runner = std::make_unique<php_clickhouse_query_runner>(
+        *hedge.client, q, PHP_CLICKHOUSE_HEDGE_QUEUE_BLOCKS, std::move(signal), tables);
+    runner->start();
+    return runner;
+}
+
+/* Hedged execution: when the primary connection has produced no rows after
+ * hedgeDelayMs, or failed before that, the same query also goes to another
+ * endpoint. The first to deliver rows (or finish) without an error wins and
+ * becomes the primary connection; the loser is cancelled by shutting its
+ * socket down, so the server drops the query. The error of the primary is
+ * only thrown when the hedge fails too. Waits end at the watch's deadline and
+ * when the request is aborted. */
+template <typename OnBlock, typename OnProgress, typename OnProfile>
+static void php_clickhouse_hedged_execute(php_clickhouse_client *intern,
+                                          const clickhouse::Query &q,
+                                          const clickhouse::ExternalTables &tables,
+                                          php_clickhouse_query_watch &watch, OnBlock &&on_block,
+                                          OnProgress &&on_progress, OnProfile &&on_profile)
+{
+    using runner_t = php_clickhouse_query_runner;
+    php_clickhouse_hedge &hedge = *intern->hedge;
+    if (hedge.straggler) {
+        hedge.straggler->join();
+        hedge.straggler.reset();
+    }
+
+    php_clickhouse_background_scope scope(intern);
+    auto &lanes = intern->background;
+    auto signal = std::make_shared<php_clickhouse_runner_signal>();
+    lanes.push_back({std::make_unique<runner_t>(*intern->client, q,
+                                                PHP_CLICKHOUSE_HEDGE_QUEUE_BLOCKS, signal, tables),
+                     intern->connect_state});
+    lanes[0].runner->start();
+
+    /* Drop every connection without draining it; run_watched reports why */
+    auto stop = [&lanes] {
+        for (auto &lane : lanes) {
+            lane.runner->cancel();
+            php_clickhouse_connect_abort(*lane.connect_state);
+        }
+    };
+    auto delivering = [](runner_t &r) { return r.has_rows_locked() || r.finished_locked(); };
+    auto failed = [](runner_t &r) {
+        std::lock_guard<std::mutex> guard(r.signal().lock);
+        return r.failed_locked();
+    };
+
+    /* Lanes still in the race; one that fails drops out */
+    std::vector<runner_t *> racing{lanes[0].runner.get(), nullptr};
+    bool hedged = false;
+    auto hedge_at = std::chrono::steady_clock::now() + hedge.delay;
+    auto start_hedge = [&] {
+        hedged = true;
+        auto second = php_clickhouse_hedge_start(intern, q, tables, signal);
+        if (second) {
+            lanes.push_back({std::move(second), hedge.connect_state});
+            racing[1] = lanes[1].runner.get();
+        }
+    };
+
+    int winner = -1;
+    while (winner < 0) {
+        auto until = watch.next_check();
+        if (!hedged && hedge_at < until) {
+            until = hedge_at;
+        }
+        int i = php_clickhouse_wait_any(racing, until, delivering);
+        if (i >= 0) {
+            if (!failed(*racing[i])) {
+                winner = i;
+                break;
+            }
+            racing[i] = nullptr;
+            if (!hedged) {
+                start_hedge();
+            }
+            if (!racing[0] && !racing[1]) {
+                /* Nothing left to wait for: the primary's error is thrown */
+                winner = 0;
+            }
+            continue;
+        }
+        if (watch.cancel_requested()) {
+            stop();
+            return;
+        }
+        if (!hedged && std::chrono::steady_clock::now() >= hedge_at) {
+            start_hedge();
+        }
+    }
+
+    if (winner == 1) {
+        std::swap(intern->client, hedge.client);
+        std::swap(intern->connect_state, hedge.connect_state);
+        std::swap(lanes[0], lanes[1]);
+    }
+    if (lanes.size() > 1) {
+        lanes[1].runner->cancel();
+        php_clickhouse_connect_abort(*lanes[1].connect_state);
+        hedge.straggler = std::move(lanes[1].runner);
+        lanes.pop_back();
+    }
+
+    runner_t &runner = *lanes[0].runner;
+    php_clickhouse_query_event event;
+    bool cancelled = false;
+    while (true) {
+        auto got = runner.next(event, watch.next_check());
+        if (got == runner_t::wait_result::finished) {
+            break;
+        }
+        if (got == runner_t::wait_result::timeout) {
+            if (watch.cancel_requested()) {
+                stop();
+                return;
+            }
+            continue;
+        }
+        if (cancelled) {
+            continue;
+        }
+        switch (event.type) {
+        case php_clickhouse_query_event::kind::data:
+            if (!on_block(event.block)) {
+                runner.cancel();
+                cancelled = true;
+            }
+            break;
+        case php_clickhouse_query_event::kind::progress:
+            on_progress(event.progress);
+            break;
+        case php_clickhouse_query_event::kind::profile:
+            on_profile(event.profile);
+            break;
+        }
+    }
+    runner.finish();
+}
+
+/* readAheadBlocks: a background thread receives and decompresses up to
+ * `blocks` blocks ahead while this thread converts the earlier ones. Packets
+ * are handed to the callbacks here in arrival order; on_block returning false
+ * cancels the query. */
+template <typename OnBlock, typename OnProgress, typename OnProfile>
+static void php_clickhouse_read_ahead_execute(php_clickhouse_client *intern,
+                                              const clickhouse::Query &q,
+                                              const clickhouse::ExternalTables &tables,
+                                              size_t blocks, OnBlock &&on_block,
+                                              OnProgress &&on_progress, OnProfile &&on_profile)
+{
+    using runner_t = php_clickhouse_query_runner;
+    php_clickhouse_background_scope scope(intern);
+    intern->background.push_back(
+        {std::make_unique<runner_t>(*intern->client, q, blocks, nullptr, tables),
+         intern->connect_state});
+    runner_t &runner = *intern->background.back().runner;
+    runner.start();
+
+    php_clickhouse_query_event event;
+    bool cancelled = false;
+    while (!cancelled && runner.next(event) == runner_t::wait_result::event) {
+        switch (event.type) {
+        case php_clickhouse_query_event::kind::data:
+            if (!on_block(event.block)) {
+                runner.cancel();
+                cancelled = true;
+            }
+            break;
+        case php_clickhouse_query_event::kind::progress:
+            on_progress(event.progress);
+            break;
+        case php_clickhouse_query_event::kind::profile:
+            on_profile(event.profile);
+            break;
+        }
+    }
+    runner.finish();
+}
+
+/* Run a select and hand its packets to the callbacks: hedged (hedgeDelayMs),
+ * received on a background thread (readAheadBlocks) or on this thread, with
+ * the codec picked by CompressionMethod::Adaptive. Every select entry point
+ * goes through here; `tables` go with the query as external data. on_block
+ * is only called until the watch asks for a cancel, and returning false from
+ * it cancels the query. An exception from on_block cancels it as well and is
+ * rethrown once the connection has read the rest of the answer. */
+template <typename OnBlock, typename OnProgress, typename OnProfile>
+static void php_clickhouse_select_execute(php_clickhouse_client *intern, clickhouse::Query &q,
+                                          zval *settings, php_clickhouse_query_watch &watch,
+                                          OnBlock &&on_block, OnProgress &&on_progress,
+                                          OnProfile &&on_profile,
+                                          const clickhouse::ExternalTables &tables = {})
+{
+    php_clickhouse_adaptive_query adaptive;
+    php_clickhouse_adaptive_begin(intern, q, settings, adaptive);
+    std::exception_ptr failed;
+    auto data = [&](const clickhouse::Block &block) -> bool {
+        if (watch.cancel_requested()) {
+            return false;
+        }
+        adaptive.on_block(intern->connect_state.get(), block);
+        bool more = false;
+        try {
+            more = on_block(block);
+        } catch (const std::exception &) {
+            failed = std::current_exception();
+        }
+        adaptive.block_done();
+        return more;
+    };
+    auto profile = [&](const clickhouse::Profile &p) {
+        adaptive.on_profile(p);
+        on_profile(p);
+    };
+
+    try {
+        if (intern->hedge) {
+            run_watched(intern, watch, [&] {
+                php_clickhouse_hedged_execute(intern, q, tables, watch, data, on_progress,
+                                              profile);
+            });
+        } else if (intern->read_ahead_blocks > 0) {
+            run_watched(intern, watch, [&] {
+                php_clickhouse_read_ahead_execute(intern, q, tables, intern->read_ahead_blocks,
+                                                  data, on_progress, profile);
+            });
+        } else {
+            q.OnDataCancelable(data);
+            q.OnProgress(on_progress);
+            q.OnProfile(profile);
+            run_watched(intern, watch, [&] {
+                if (tables.empty()) {
+                    intern->client->Execute(q);
+                } else {
+                    intern->client->SelectWithExternalData(q, tables);
+                }
+            });
+        }
+    } catch (const clickhouse::ServerException &e) {
+        /* The server's answer to the Cancel sent after on_block threw */
+        if (!failed || e.GetCode() != 394) {
+            throw;
+        }
+    }
+    if (failed) {
+        std::rethrow_exception(failed);
+    }
+    php_clickhouse_adaptive_end(intern, adaptive);
+}
+
+/* The same for callers that only want the data blocks */
+template <typename OnBlock>
+static void php_clickhouse_select_execute(php_clickhouse_client *intern, clickhouse::Query &q,
+                                          zval *settings, php_clickhouse_query_watch &watch,
+                                          OnBlock &&on_block,
+                                          const clickhouse::ExternalTables &tables = {})
+{
+    php_clickhouse_select_execute(
+        intern, q, settings, watch, on_block, [](const clickhouse::Progress &) {},
+        [](const clickhouse::Profile &) {}, tables);
+}
+
+ZEND_METHOD(ClickHouse_Driver_Client, execute)
+{
+    zend_string *query = nullptr;
+    zval *params = nullptr;
+    zval *settings = nullptr;
+    zend_string *query_id = nullptr;
+    zend_long timeout_ms = 0;
+    zend_bool timeout_is_null = 1;
+
+    ZEND_PARSE_PARAMETERS_START(1, 5)
+    Z_PARAM_STR(query)
+    Z_PARAM_OPTIONAL
+    Z_PARAM_ARRAY_EX(params, 1, 0)
+    Z_PARAM_ARRAY_EX(settings, 1, 0)
+    Z_PARAM_STR_OR_NULL(query_id)
+    Z_PARAM_LONG_OR_NULL(timeout_ms, timeout_is_null)
+    ZEND_PARSE_PARAMETERS_END();
+
+    php_clickhouse_query_watch watch;
+    if (!php_clickhouse_watch_init(watch, timeout_ms, timeout_is_null)) {
+        return;
+    }
+
+    auto *intern = Z_CLICKHOUSE_CLIENT_P(ZEND_THIS);
+    if (!php_clickhouse_client_connected(intern)) {
+        return;
+    }
+
+    CLICKHOUSE_TRY
+    auto q = build_query(query, params, settings, query_id);
+    apply_deadline(q, settings, watch);
+    q.OnDataCancelable(
+        [&](const clickhouse::Block &) -> bool { return !watch.cancel_requested(); });
+    run_watched(intern, watch, [&] { intern->client->Execute(q); });
+    CLICKHOUSE_CATCH
+}
+
+/* Append one row of a block to `rows` as a column-name keyed array */
+static void php_clickhouse_row_to_zval(const clickhouse::Block &block, size_t r, zval *row)
+{
+    size_t cols = block.GetColumnCount();
+    array_init_size(row, cols);
+    for (size_t c = 0; c < cols; ++c) {
+        zval val;
+        php_clickhouse_column_to_zval(block[c], r, &val);
+        add_assoc_zval_ex(row, block.GetColumnName(c).c_str(), block.GetColumnName(c).size(),
+                          &val);
+    }
+}
+
+ZEND_METHOD(ClickHouse_Driver_Client, select)
+{
+    zend_string *query = nullptr;
+    zval *params = nullptr;
+    zval *settings = nullptr;
+    zend_string *query_id = nullptr;
+    zend_long timeout_ms = 0;
+    zend_bool timeout_is_null = 1;
+
+    ZEND_PARSE_PARAMETERS_START(1, 5)
+    Z_PARAM_STR(query)
+    Z_PARAM_OPTIONAL
+    Z_PARAM_ARRAY_EX(params, 1, 0)
+    Z_PARAM_ARRAY_EX(settings, 1, 0)
+    Z_PARAM_STR_OR_NULL(query_id)
+    Z_PARAM_LONG_OR_NULL(timeout_ms, timeout_is_null)
+    ZEND_PARSE_PARAMETERS_END();
+
+    php_clickhouse_query_watch watch;
+    if (!php_clickhouse_watch_init(watch, timeout_ms, timeout_is_null)) {
+        return;
+    }
+
+    auto *intern = Z_CLICKHOUSE_CLIENT_P(ZEND_THIS);
+    if (!php_clickhouse_client_connected(intern)) {
+        return;
+    }
+
+    array_init(return_value);
+
+    CLICKHOUSE_TRY
+    auto q = build_query(query, params, settings, query_id);
+    apply_deadline(q, settings, watch);
+    php_clickhouse_memory_plan memory;
+    php_clickhouse_memory_begin(intern, q, query, settings, memory);
+    php_clickhouse_select_execute(intern, q, settings, watch, [&](const clickhouse::Block &block) {
+        if (!php_clickhouse_memory_check(intern, memory, block, watch))
+            return false;
+
+        size_t rows = block.GetRowCount();
+        size_t cols = block.GetColumnCount();
+
+        if (rows == 0)
+            return true;
+
+        for (size_t r = 0; r < rows; ++r) {
+            zval row;
+            array_init_size(&row, cols);
+
+            for (size_t c = 0; c < cols; ++c) {
+                zval val;
+                php_clickhouse_column_to_zval(block[c], r, &val);
+                add_assoc_zval_ex(&row, block.GetColumnName(c).c_str(),
+                                  block.GetColumnName(c).size(), &val);
+            }
+
+            add_next_index_zval(return_value, &row);
+        }
+        return true;
+    });
+    CLICKHOUSE_CATCH_RETURN
+}
+
+ZEND_METHOD(ClickHouse_Driver_Client, selectByBlock)
+{
+    zend_string *query = nullptr;
+    zend_fcall_info fci;
+    zend_fcall_info_cache fcc;
+    zval *params = nullptr;
+    zval *settings = nullptr;
+    zend_string *query_id = nullptr;
+    zend_fcall_info fci_progress = empty_fcall_info;
+    zend_fcall_info_cache fcc_progress = empty_fcall_info_cache;
+    zend_fcall_info fci_profile = empty_fcall_info;
+    zend_fcall_info_cache fcc_profile = empty_fcall_info_cache;
+    zend_long timeout_ms = 0;
+    zend_bool timeout_is_null = 1;
+    zend_long min_rows = 0;
+    zend_long max_rows = 0;
+
+    ZEND_PARSE_PARAMETERS_START(2, 10)
+    Z_PARAM_STR(query)
+    Z_PARAM_FUNC(fci, fcc)
+    Z_PARAM_OPTIONAL
+    Z_PARAM_ARRAY_EX(params, 1, 0)
+    Z_PARAM_ARRAY_EX(settings, 1, 0)
+    Z_PARAM_STR_OR_NULL(query_id)
+    Z_PARAM_FUNC_OR_NULL(fci_progress, fcc_progress)
+    Z_PARAM_FUNC_OR_NULL(fci_profile, fcc_profile)
+    Z_PARAM_LONG_OR_NULL(timeout_ms, timeout_is_null)
+    Z_PARAM_LONG(min_rows)
+    Z_PARAM_LONG(max_rows)
+    ZEND_PARSE_PARAMETERS_END();
+
+    php_clickhouse_query_watch watch;
+    if (!php_clickhouse_watch_init(watch, timeout_ms, timeout_is_null)) {
+        return;
+    }
+    if (min_rows < 0 || max_rows < 0) {
+        zend_throw_exception(clickhouse_ce_ValidationException,
+                             "minRows and maxRows must not be negative", 0);
+        return;
+    }
+    if (max_rows > 0 && max_rows < min_rows) {
+        zend_throw_exception(clickhouse_ce_ValidationException,
+                             "maxRows must be 0 or at least minRows", 0);
+        return;
+    }
+
+    auto *intern = Z_CLICKHOUSE_CLIENT_P(ZEND_THIS);
+    if (!php_clickhouse_client_connected(intern)) {
+        return;
+    }
+
+    CLICKHOUSE_TRY
+    auto q = build_query(query, params, settings, query_id);
+    apply_deadline(q, settings, watch);
+    php_clickhouse_memory_plan memory;
+    php_clickhouse_memory_begin(intern, q, query, settings, memory);
+
+    /* Hands one block, as regrouped, to the user's callback */
+    auto call_back = [&](const clickhouse::Block &block) -> bool {
+        if (!php_clickhouse_memory_check(intern, memory, block, watch))
+            return false;
+
+        zval block_zv;
+        php_clickhouse_create_block_from_cpp(&block_zv, block);
+
+        zval retval;
+        fci.param_count = 1;
+        fci.params = &block_zv;
+        fci.retval = &retval;
+
+        if (zend_call_function(&fci, &fcc) == SUCCESS) {
+            bool should_continue = true;
+            if (EG(exception) || Z_TYPE(retval) == IS_FALSE) {
+                should_continue = false;
+            }
+            zval_ptr_dtor(&retval);
+            zval_ptr_dtor(&block_zv);
+            return should_continue;
+        }
+
+        zval_ptr_dtor(&block_zv);
+        return false;
+    };
+
+    /* Data callback (cancelable) */
+    php_clickhouse_block_regroup regroup(static_cast<size_t>(min_rows),
+                                         static_cast<size_t>(max_rows));
+    bool stopped = false;
+    auto on_block = [&](const clickhouse::Block &block) -> bool {
+        if (block.GetRowCount() == 0)
+            return php_clickhouse_memory_check(intern, memory, block, watch);
+        stopped = !regroup.push(block, call_back);
+        return !stopped;
+    };
+
+    /* Progress callback */
+    auto on_progress = [&](const clickhouse::Progress &progress) {
+        zval arg;
+        array_init_size(&arg, 5);
+        add_assoc_long(&arg, "rows", static_cast<zend_long>(progress.rows));
+        add_assoc_long(&arg, "bytes", static_cast<zend_long>(progress.bytes));
+        add_assoc_long(&arg, "total_rows", static_cast<zend_long>(progress.total_rows));
+        add_assoc_long(&arg, "written_rows", static_cast<zend_long>(progress.written_rows));
+        add_assoc_long(&arg, "written_bytes", static_cast<zend_long>(progress.written_bytes));
+
+        zval retval;
+        fci_progress.param_count = 1;
+        fci_progress.params = &arg;
+        fci_progress.retval = &retval;
+        zend_call_function(&fci_progress, &fcc_progress);
+        zval_ptr_dtor(&retval);
+        zval_ptr_dtor(&arg);
+    };
+
+    /* Profile callback */
+    auto on_profile = [&](const clickhouse::Profile &profile) {
+        zval arg;
+        array_init_size(&arg, 6);
+        add_assoc_long(&arg, "rows", static_cast<zend_long>(profile.rows));
+        add_assoc_long(&arg, "blocks", static_cast<zend_long>(profile.blocks));
+        add_assoc_long(&arg, "bytes", static_cast<zend_long>(profile.bytes));
+        add_assoc_long(&arg, "rows_before_limit",
+                       static_cast<zend_long>(profile.rows_before_limit));
+        add_assoc_bool(&arg, "applied_limit", profile.applied_limit);
+        add_assoc_bool(&arg, "calculated_rows_before_limit",
+                       profile.calculated_rows_before_limit);
+
+        zval retval;
+        fci_profile.param_count = 1;
+        fci_profile.params = &arg;
+        fci_profile.retval = &retval;
+        zend_call_function(&fci_profile, &fcc_profile);
+        zval_ptr_dtor(&retval);
+        zval_ptr_dtor(&arg);
+    };
+
+    bool has_progress = ZEND_FCI_INITIALIZED(fci_progress);
+    bool has_profile = ZEND_FCI_INITIALIZED(fci_profile);
+    php_clickhouse_select_execute(
+        intern, q, settings, watch, on_block,
+        [&](const clickhouse::Progress &progress) {
+            if (has_progress)
+                on_progress(progress);
+        },
+        [&](const clickhouse::Profile &profile) {
+            if (has_profile)
+                on_profile(profile);
+        });
+    if (!stopped && !regroup.flush(call_back) && !watch.memory_error.empty()) {
+        throw php_clickhouse_memory_error(watch.memory_error);
+    }
+    CLICKHOUSE_CATCH
+}
+
+ZEND_METHOD(ClickHouse_Driver_Client, selectJson)
+{
+    zend_string *query = nullptr;
+    zval *params = nullptr;
+    zval *settings = nullptr;
+    zend_string *query_id = nullptr;
+    zend_long timeout_ms = 0;
+    zend_bool timeout_is_null = 1;
+    zend_bool columnar = 0;
+
+    ZEND_PARSE_PARAMETERS_START(1, 6)
+    Z_PARAM_STR(query)
+    Z_PARAM_OPTIONAL
+    Z_PARAM_ARRAY_EX(params, 1, 0)
+    Z_PARAM_ARRAY_EX(settings, 1, 0)
+    Z_PARAM_STR_OR_NULL(query_id)
+    Z_PARAM_LONG_OR_NULL(timeout_ms, timeout_is_null)
+    Z_PARAM_BOOL(columnar)
+    ZEND_PARSE_PARAMETERS_END();
+
+    php_clickhouse_query_watch watch;
+    if (!php_clickhouse_watch_init(watch, timeout_ms, timeout_is_null)) {
+        return;
+    }
+
+    auto *intern = Z_CLICKHOUSE_CLIENT_P(ZEND_THIS);
+    if (!php_clickhouse_client_connected(intern)) {
+        return;
+    }
+
+    CLICKHOUSE_TRY
+    auto q = build_query(query, params, settings, query_id);
+    apply_deadline(q, settings, watch);
+    php_clickhouse_json_writer writer(columnar);
+    php_clickhouse_select_execute(intern, q, settings, watch, [&](const clickhouse::Block &block) {
+        writer.append(block);
+        return true;
+    });
+    std::string json = writer.finish();
+    RETVAL_STRINGL(json.data(), json.size());
+    CLICKHOUSE_CATCH
+}
+
+ZEND_METHOD(ClickHouse_Driver_Client, selectNative)
+{
+    zend_string *query = nullptr;
+    zval *params = nullptr;
+    zval *settings = nullptr;
+    zend_string *query_id = nullptr;
+    zend_long timeout_ms = 0;
+    zend_bool timeout_is_null = 1;
+    zval *compression = nullptr;
+
+    ZEND_PARSE_PARAMETERS_START(1, 6)
+    Z_PARAM_STR(query)
+    Z_PARAM_OPTIONAL
+    Z_PARAM_ARRAY_EX(params, 1, 0)
+    Z_PARAM_ARRAY_EX(settings, 1, 0)
+    Z_PARAM_STR_OR_NULL(query_id)
+    Z_PARAM_LONG_OR_NULL(timeout_ms, timeout_is_null)
+    Z_PARAM_ZVAL(compression)
+    ZEND_PARSE_PARAMETERS_END();
+
+    clickhouse::CompressionMethod method;
+    if (!php_clickhouse_native_compression(compression, method)) {
+        return;
+    }
+
+    php_clickhouse_query_watch watch;
+    if (!php_clickhouse_watch_init(watch, timeout_ms, timeout_is_null)) {
+        return;
+    }
+
+    auto *intern = Z_CLICKHOUSE_CLIENT_P(ZEND_THIS);
+    if (!php_clickhouse_client_connected(intern)) {
+        return;
+    }
+
+    CLICKHOUSE_TRY
+    auto q = build_query(query, params, settings, query_id);
+    apply_deadline(q, settings, watch);
+    php_clickhouse_native_writer writer(method);
+    bool have_header = false;
+    php_clickhouse_select_execute(intern, q, settings, watch, [&](const clickhouse::Block &block) {
+        /* The server's leading empty block carries the column types; later
+         * empty ones (progress, totals headers) only add bytes */
+        if (block.GetRowCount() > 0 || !have_header) {
+            writer.append(block);
+            have_header = true;
+        }
+        return true;
+    });
+    const clickhouse::Buffer &out = writer.finish();
+    RETVAL_STRINGL(reinterpret_cast<const char *>(out.data()), out.size());
+    CLICKHOUSE_CATCH
+}
+
+ZEND_METHOD(ClickHouse_Driver_Client, selectArrowIpc)
+{
+    zend_string *query = nullptr;
+    zval *params = nullptr;
+    zval *settings = nullptr;
+    zend_string *query_id = nullptr;
+    zend_long timeout_ms = 0;
+    zend_bool timeout_is_null = 1;
+
+    ZEND_PARSE_PARAMETERS_START(1, 5)
+    Z_PARAM_STR(query)
+    Z_PARAM_OPTIONAL
+    Z_PARAM_ARRAY_EX(params, 1, 0)
+    Z_PARAM_ARRAY_EX(settings, 1, 0)
+    Z_PARAM_STR_OR_NULL(query_id)
+    Z_PARAM_LONG_OR_NULL(timeout_ms, timeout_is_null)
+    ZEND_PARSE_PARAMETERS_END();
+
+    php_clickhouse_query_watch watch;
+    if (!php_clickhouse_watch_init(watch, timeout_ms, timeout_is_null)) {
+        return;
+    }
+
+    auto *intern = Z_CLICKHOUSE_CLIENT_P(ZEND_THIS);
+    if (!php_clickhouse_client_connected(intern)) {
         return;
     }
 
     CLICKHOUSE_TRY
     auto q = build_query(query, params, settings, query_id);
-    intern->client->Execute(q);
+    apply_deadline(q, settings, watch);
+    php_clickhouse_arrow_writer writer;
+    php_clickhouse_select_execute(intern, q, settings, watch, [&](const clickhouse::Block &block) {
+        writer.append(block);
+        return true;
+    });
+    std::string out = writer.finish();
+    RETVAL_STRINGL(out.data(), out.size());
     CLICKHOUSE_CATCH
 }
 
-ZEND_METHOD(ClickHouse_Driver_Client, select)
+ZEND_METHOD(ClickHouse_Driver_Client, selectCached)
 {
     zend_string *query = nullptr;
+    zend_long ttl_seconds = 0;
     zval *params = nullptr;
     zval *settings = nullptr;
     zend_string *query_id = nullptr;
+    zend_long timeout_ms = 0;
+    zend_bool timeout_is_null = 1;
 
-    ZEND_PARSE_PARAMETERS_START(1, 4)
+    ZEND_PARSE_PARAMETERS_START(2, 6)
     Z_PARAM_STR(query)
+    Z_PARAM_LONG(ttl_seconds)
     Z_PARAM_OPTIONAL
     Z_PARAM_ARRAY_EX(params, 1, 0)
     Z_PARAM_ARRAY_EX(settings, 1, 0)
     Z_PARAM_STR_OR_NULL(query_id)
+    Z_PARAM_LONG_OR_NULL(timeout_ms, timeout_is_null)
     ZEND_PARSE_PARAMETERS_END();
 
+    if (ttl_seconds <= 0) {
+        zend_throw_exception(clickhouse_ce_ValidationException, "ttlSeconds must be positive", 0);
+        return;
+    }
+
+    php_clickhouse_query_watch watch;
+    if (!php_clickhouse_watch_init(watch, timeout_ms, timeout_is_null)) {
+        return;
+    }
+
     auto *intern = Z_CLICKHOUSE_CLIENT_P(ZEND_THIS);
-    if (!intern->client) {
-        zend_throw_exception(clickhouse_ce_ClickHouseException, "Client not connected", 0);
+    std::string key;
+    if (php_clickhouse_result_cache_enabled()) {
+        key = php_clickhouse_result_cache_key(intern->cache_scope, query, params, settings);
+        std::string cached;
+        if (php_clickhouse_result_cache_get(key, cached)) {
+            /* A hit never touches the connection, lazyConnect clients stay unconnected */
+            array_init(return_value);
+            CLICKHOUSE_TRY
+            /* Block by block as stored, with the same memoryLimitFraction check */
+            php_clickhouse_memory_plan memory;
+            php_clickhouse_memory_plan_init(intern, query, memory);
+            php_clickhouse_native_read_each(
+                cached.data(), cached.size(), [&](const clickhouse::Block &block) {
+                    if (!php_clickhouse_memory_check(intern, memory, block, watch)) {
+                        throw php_clickhouse_memory_error(watch.memory_error);
+                    }
+                    for (size_t r = 0; r < block.GetRowCount(); ++r) {
+                        zval row;
+                        php_clickhouse_row_to_zval(block, r, &row);
+                        add_next_index_zval(return_value, &row);
+                    }
+                    return true;
+                });
+            CLICKHOUSE_CATCH_RETURN
+            return;
+        }
+    }
+
+    if (!php_clickhouse_client_connected(intern)) {
         return;
     }
 
@@ -161,138 +1661,146 @@ ZEND_METHOD(ClickHouse_Driver_Client, select)
 
     CLICKHOUSE_TRY
     auto q = build_query(query, params, settings, query_id);
-    q.OnData([&](const clickhouse::Block &block) {
-        size_t rows = block.GetRowCount();
-        size_t cols = block.GetColumnCount();
-
-        if (rows == 0)
-            return;
-
-        for (size_t r = 0; r < rows; ++r) {
-            zval row;
-            array_init_size(&row, cols);
-
-            for (size_t c = 0; c < cols; ++c) {
-                zval val;
-                php_clickhouse_column_to_zval(block[c], r, &val);
-                add_assoc_zval_ex(&row, block.GetColumnName(c).c_str(),
-                                  block.GetColumnName(c).size(), &val);
+    apply_deadline(q, settings, watch);
+    php_clickhouse_memory_plan memory;
+    php_clickhouse_memory_begin(intern, q, query, settings, memory);
+    /* Dropped once the result outgrows what the cache would take */
+    std::unique_ptr<php_clickhouse_native_writer> writer;
+    if (!key.empty()) {
+        writer =
+            std::make_unique<php_clickhouse_native_writer>(clickhouse::CompressionMethod::None);
+    }
+    bool have_header = false;
+    php_clickhouse_select_execute(intern, q, settings, watch, [&](const clickhouse::Block &block) {
+        if (!php_clickhouse_memory_check(intern, memory, block, watch))
+            return false;
+
+        if (writer && (block.GetRowCount() > 0 || !have_header)) {
+            writer->append(block);
+            have_header = true;
+            if (writer->size() > php_clickhouse_result_cache_max_entry()) {
+                writer.reset();
             }
-
+        }
+        for (size_t r = 0; r < block.GetRowCount(); ++r) {
+            zval row;
+            php_clickhouse_row_to_zval(block, r, &row);
             add_next_index_zval(return_value, &row);
         }
+        return true;
     });
-    intern->client->Execute(q);
+    if (writer) {
+        const clickhouse::Buffer &out = writer->finish();
+        php_clickhouse_result_cache_put(key, reinterpret_cast<const char *>(out.data()),
+                                        out.size(), std::chrono::seconds(ttl_seconds));
+    }
     CLICKHOUSE_CATCH_RETURN
 }
 
-ZEND_METHOD(ClickHouse_Driver_Client, selectByBlock)
+/* selectToStream() writes once this much text has been formatted */
+#define PHP_CLICKHOUSE_STREAM_CHUNK (64 * 1024)
+
+ZEND_METHOD(ClickHouse_Driver_Client, selectToStream)
 {
     zend_string *query = nullptr;
-    zend_fcall_info fci;
-    zend_fcall_info_cache fcc;
+    zval *zstream = nullptr;
+    zend_string *format_name = nullptr;
     zval *params = nullptr;
     zval *settings = nullptr;
     zend_string *query_id = nullptr;
-    zend_fcall_info fci_progress = empty_fcall_info;
-    zend_fcall_info_cache fcc_progress = empty_fcall_info_cache;
-    zend_fcall_info fci_profile = empty_fcall_info;
-    zend_fcall_info_cache fcc_profile = empty_fcall_info_cache;
+    zend_long timeout_ms = 0;
+    zend_bool timeout_is_null = 1;
 
-    ZEND_PARSE_PARAMETERS_START(2, 7)
+    ZEND_PARSE_PARAMETERS_START(3, 7)
     Z_PARAM_STR(query)
-    Z_PARAM_FUNC(fci, fcc)
+    Z_PARAM_RESOURCE(zstream)
+    Z_PARAM_STR(format_name)
     Z_PARAM_OPTIONAL
     Z_PARAM_ARRAY_EX(params, 1, 0)
     Z_PARAM_ARRAY_EX(settings, 1, 0)
     Z_PARAM_STR_OR_NULL(query_id)
-    Z_PARAM_FUNC_OR_NULL(fci_progress, fcc_progress)
-    Z_PARAM_FUNC_OR_NULL(fci_profile, fcc_profile)
+    Z_PARAM_LONG_OR_NULL(timeout_ms, timeout_is_null)
     ZEND_PARSE_PARAMETERS_END();
 
+    php_clickhouse_text_format format;
+    bool with_names = false;
+    if (!php_clickhouse_text_writer::parse(ZSTR_VAL(format_name), ZSTR_LEN(format_name), format,
+                                           with_names)) {
+        zend_throw_exception_ex(clickhouse_ce_ValidationException, 0,
+                                "Unsupported format \"%s\": expected CSV, CSVWithNames, TSV, "
+                                "TSVWithNames or JSONEachRow",
+                                ZSTR_VAL(format_name));
+        return;
+    }
+
+    php_stream *stream;
+    php_stream_from_zval(stream, zstream);
+
+    php_clickhouse_query_watch watch;
+    if (!php_clickhouse_watch_init(watch, timeout_ms, timeout_is_null)) {
+        return;
+    }
+
     auto *intern = Z_CLICKHOUSE_CLIENT_P(ZEND_THIS);
-    if (!intern->client) {
-        zend_throw_exception(clickhouse_ce_ClickHouseException, "Client not connected", 0);
+    if (!php_clickhouse_client_connected(intern)) {
         return;
     }
 
+    zend_long rows_written = 0;
+
     CLICKHOUSE_TRY
     auto q = build_query(query, params, settings, query_id);
-
-    /* Data callback (cancelable) */
-    q.OnDataCancelable([&](const clickhouse::Block &block) -> bool {
-        if (block.GetRowCount() == 0)
+    apply_deadline(q, settings, watch);
+
+    php_clickhouse_text_writer writer(format);
+    std::string out;
+    out.reserve(PHP_CLICKHOUSE_STREAM_CHUNK * 2);
+    bool header_pending = with_names;
+    bool write_failed = false;
+    auto write_out = [&]() -> bool {
+        if (out.empty()) {
             return true;
+        }
+        /* size_t before PHP 8.0, ssize_t and -1 on error since */
+        auto written = php_stream_write(stream, out.data(), out.size());
+        write_failed = static_cast<size_t>(written) != out.size();
+        out.clear();
+        return !write_failed;
+    };
+    auto on_block = [&](const clickhouse::Block &block) -> bool {
+        if (header_pending && block.GetColumnCount() > 0) {
+            writer.header(block, out);
+            header_pending = false;
+        }
 
-        zval block_zv;
-        php_clickhouse_create_block_from_cpp(&block_zv, block);
-
-        zval retval;
-        fci.param_count = 1;
-        fci.params = &block_zv;
-        fci.retval = &retval;
-
-        if (zend_call_function(&fci, &fcc) == SUCCESS) {
-            bool should_continue = true;
-            if (EG(exception) || Z_TYPE(retval) == IS_FALSE) {
-                should_continue = false;
+        size_t rows = block.GetRowCount();
+        for (size_t r = 0; r < rows; ++r) {
+            writer.row(block, r, out);
+            if (out.size() >= PHP_CLICKHOUSE_STREAM_CHUNK && !write_out()) {
+                return false;
             }
-            zval_ptr_dtor(&retval);
-            zval_ptr_dtor(&block_zv);
-            return should_continue;
         }
-
-        zval_ptr_dtor(&block_zv);
-        return false;
-    });
-
-    /* Progress callback */
-    if (ZEND_FCI_INITIALIZED(fci_progress)) {
-        q.OnProgress([&](const clickhouse::Progress &progress) {
-            zval arg;
-            array_init_size(&arg, 5);
-            add_assoc_long(&arg, "rows", static_cast<zend_long>(progress.rows));
-            add_assoc_long(&arg, "bytes", static_cast<zend_long>(progress.bytes));
-            add_assoc_long(&arg, "total_rows", static_cast<zend_long>(progress.total_rows));
-            add_assoc_long(&arg, "written_rows", static_cast<zend_long>(progress.written_rows));
-            add_assoc_long(&arg, "written_bytes", static_cast<zend_long>(progress.written_bytes));
-
-            zval retval;
-            fci_progress.param_count = 1;
-            fci_progress.params = &arg;
-            fci_progress.retval = &retval;
-            zend_call_function(&fci_progress, &fcc_progress);
-            zval_ptr_dtor(&retval);
-            zval_ptr_dtor(&arg);
-        });
+        rows_written += static_cast<zend_long>(rows);
+        return true;
+    };
+
+    try {
+        php_clickhouse_select_execute(intern, q, settings, watch, on_block);
+    } catch (const clickhouse::ServerException &e) {
+        /* The server's answer to the Cancel sent after a failed write */
+        if (!write_failed || e.GetCode() != 394) {
+            throw;
+        }
     }
-
-    /* Profile callback */
-    if (ZEND_FCI_INITIALIZED(fci_profile)) {
-        q.OnProfile([&](const clickhouse::Profile &profile) {
-            zval arg;
-            array_init_size(&arg, 6);
-            add_assoc_long(&arg, "rows", static_cast<zend_long>(profile.rows));
-            add_assoc_long(&arg, "blocks", static_cast<zend_long>(profile.blocks));
-            add_assoc_long(&arg, "bytes", static_cast<zend_long>(profile.bytes));
-            add_assoc_long(&arg, "rows_before_limit",
-                           static_cast<zend_long>(profile.rows_before_limit));
-            add_assoc_bool(&arg, "applied_limit", profile.applied_limit);
-            add_assoc_bool(&arg, "calculated_rows_before_limit",
-                           profile.calculated_rows_before_limit);
-
-            zval retval;
-            fci_profile.param_count = 1;
-            fci_profile.params = &arg;
-            fci_profile.retval = &retval;
-            zend_call_function(&fci_profile, &fcc_profile);
-            zval_ptr_dtor(&retval);
-            zval_ptr_dtor(&arg);
-        });
+    if (!write_failed) {
+        write_out();
+    }
+    if (write_failed) {
+        throw clickhouse::Error("Query cancelled: writing the result to the stream failed");
     }
-
-    intern->client->Execute(q);
     CLICKHOUSE_CATCH
+
+    RETURN_LONG(rows_written);
 }
 
 ZEND_METHOD(ClickHouse_Driver_Client, selectWithExternalData)
@@ -302,19 +1810,26 @@ ZEND_METHOD(ClickHouse_Driver_Client, selectWithExternalData)
     zval *params = nullptr;
     zval *settings = nullptr;
     zend_string *query_id = nullptr;
+    zend_long timeout_ms = 0;
+    zend_bool timeout_is_null = 1;
 
-    ZEND_PARSE_PARAMETERS_START(2, 5)
+    ZEND_PARSE_PARAMETERS_START(2, 6)
     Z_PARAM_STR(query)
     Z_PARAM_ARRAY(ext_tables)
     Z_PARAM_OPTIONAL
     Z_PARAM_ARRAY_EX(params, 1, 0)
     Z_PARAM_ARRAY_EX(settings, 1, 0)
     Z_PARAM_STR_OR_NULL(query_id)
+    Z_PARAM_LONG_OR_NULL(timeout_ms, timeout_is_null)
     ZEND_PARSE_PARAMETERS_END();
 
+    php_clickhouse_query_watch watch;
+    if (!php_clickhouse_watch_init(watch, timeout_ms, timeout_is_null)) {
+        return;
+    }
+
     auto *intern = Z_CLICKHOUSE_CLIENT_P(ZEND_THIS);
-    if (!intern->client) {
-        zend_throw_exception(clickhouse_ce_ClickHouseException, "Client not connected", 0);
+    if (!php_clickhouse_client_connected(intern)) {
         return;
     }
 
@@ -343,17 +1858,33 @@ ZEND_METHOD(ClickHouse_Driver_Client, selectWithExternalData)
         if (!block_intern->block)
             continue;
 
+        clickhouse::Block data = *block_intern->block;
+        if (intern->hedge) {
+            /* A losing hedge may still be sending after this call returns, so
+             * it gets columns of its own rather than the Block's */
+            const clickhouse::Block &source = *block_intern->block;
+            data = clickhouse::Block(source.GetColumnCount(), source.GetRowCount());
+            for (size_t c = 0; c < source.GetColumnCount(); ++c) {
+                data.AppendColumn(source.GetColumnName(c), source[c]->Slice(0, source[c]->Size()));
+            }
+        }
         tables.push_back(clickhouse::ExternalTable{
-            std::string_view(Z_STRVAL_P(name_zv), Z_STRLEN_P(name_zv)), *block_intern->block});
+            std::string_view(Z_STRVAL_P(name_zv), Z_STRLEN_P(name_zv)), std::move(data)});
     }
     ZEND_HASH_FOREACH_END();
 
     auto q = build_query(query, params, settings, query_id);
-    q.OnData([&](const clickhouse::Block &block) {
+    apply_deadline(q, settings, watch);
+    php_clickhouse_memory_plan memory;
+    php_clickhouse_memory_begin(intern, q, query, settings, memory);
+    auto on_block = [&](const clickhouse::Block &block) -> bool {
+        if (!php_clickhouse_memory_check(intern, memory, block, watch))
+            return false;
+
         size_t rows = block.GetRowCount();
         size_t cols = block.GetColumnCount();
         if (rows == 0)
-            return;
+            return true;
 
         for (size_t r = 0; r < rows; ++r) {
             zval row;
@@ -366,8 +1897,463 @@ ZEND_METHOD(ClickHouse_Driver_Client, selectWithExternalData)
             }
             add_next_index_zval(return_value, &row);
         }
+        return true;
+    };
+    php_clickhouse_select_execute(intern, q, settings, watch, on_block, tables);
+    CLICKHOUSE_CATCH_RETURN
+}
+
+/* One column of a selectFanOut orderBy */
+struct php_clickhouse_merge_key
+{
+    std::string column;
+    bool descending = false;
+    /* String columns sort bytewise, like the server does */
+    bool bytewise = false;
+};
+
+/* A shard's stream in a k-way merge: the block being read and its next row */
+struct php_clickhouse_merge_cursor
+{
+    php_clickhouse_query_runner *runner = nullptr;
+    clickhouse::Block block;
+    size_t row = 0;
+    zval head;
+    bool has_head = false;
+
+    php_clickhouse_merge_cursor() = default;
+    php_clickhouse_merge_cursor(const php_clickhouse_merge_cursor &) = delete;
+    php_clickhouse_merge_cursor &operator=(const php_clickhouse_merge_cursor &) = delete;
+    ~php_clickhouse_merge_cursor()
+    {
+        if (has_head) {
+            zval_ptr_dtor(&head);
+        }
+    }
+};
+
+/* Parse selectFanOut's endpoints; a missing port falls back to the client's.
+ * Returns false with an exception pending. */
+static bool php_clickhouse_fan_out_endpoints(zval *endpoints, uint16_t default_port,
+                                             std::vector<clickhouse::Endpoint> &out,
+                                             std::vector<std::string> &names)
+{
+    zval *entry;
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(endpoints), entry)
+    {
+        zval *host = Z_TYPE_P(entry) == IS_ARRAY
+                         ? zend_hash_str_find(Z_ARRVAL_P(entry), "host", sizeof("host") - 1)
+                         : nullptr;
+        if (!host || Z_TYPE_P(host) != IS_STRING || Z_STRLEN_P(host) == 0) {
+            zend_throw_exception(clickhouse_ce_ValidationException,
+                                 "selectFanOut endpoints must be arrays with a 'host' string", 0);
+            return false;
+        }
+        clickhouse::Endpoint ep;
+        ep.host = std::string(Z_STRVAL_P(host), Z_STRLEN_P(host));
+        ep.port = default_port;
+        zval *port = zend_hash_str_find(Z_ARRVAL_P(entry), "port", sizeof("port") - 1);
+        if (port) {
+            if (Z_TYPE_P(port) != IS_LONG || Z_LVAL_P(port) < 1 || Z_LVAL_P(port) > UINT16_MAX) {
+                zend_throw_exception(clickhouse_ce_ValidationException,
+                                     "selectFanOut endpoint port must be between 1 and 65535", 0);
+                return false;
+            }
+            ep.port = static_cast<uint16_t>(Z_LVAL_P(port));
+        }
+
+        std::string name = ep.host + ":" + std::to_string(ep.port);
+        if (std::find(names.begin(), names.end(), name) != names.end()) {
+            zend_throw_exception_ex(clickhouse_ce_ValidationException, 0,
+                                    "selectFanOut endpoint %s is listed twice", name.c_str());
+            return false;
+        }
+        out.push_back(std::move(ep));
+        names.push_back(std::move(name));
+    }
+    ZEND_HASH_FOREACH_END();
+
+    if (out.empty()) {
+        zend_throw_exception(clickhouse_ce_ValidationException,
+                             "selectFanOut needs at least one endpoint", 0);
+        return false;
+    }
+    return true;
+}
+
+/* Parse orderBy: ['col', 'other DESC', ...]. Returns false with an exception pending. */
+static bool php_clickhouse_merge_keys(zval *order_by, std::vector<php_clickhouse_merge_key> &keys)
+{
+    zval *entry;
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(order_by), entry)
+    {
+        std::string spec;
+        if (Z_TYPE_P(entry) == IS_STRING) {
+            spec.assign(Z_STRVAL_P(entry), Z_STRLEN_P(entry));
+        }
+
+        php_clickhouse_merge_key key;
+        size_t space = spec.find_last_of(' ');
+        if (space != std::string::npos) {
+            std::string direction = spec.substr(space + 1);
+            std::transform(direction.begin(), direction.end(), direction.begin(),
+                           [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+            if (direction == "desc" || direction == "asc") {
+                key.descending = direction == "desc";
+                spec.erase(space);
+            }
+        }
+        size_t last = spec.find_last_not_of(' ');
+        spec.erase(last == std::string::npos ? 0 : last + 1);
+        if (spec.empty() || spec.find(' ') != std::string::npos) {
+            zend_throw_exception(clickhouse_ce_ValidationException,
+                                 "selectFanOut orderBy entries must be 'column' or 'column DESC'",
+                                 0);
+            return false;
+        }
+        key.column = std::move(spec);
+        keys.push_back(std::move(key));
+    }
+    ZEND_HASH_FOREACH_END();
+    return true;
+}
+
+/* Open the shard connections that are missing or were aborted, concurrently.
+ * Rethrows the first failure once every attempt has finished. */
+static void php_clickhouse_fan_out_connect(php_clickhouse_fan_out &fan_out,
+                                           const std::vector<clickhouse::Endpoint> &endpoints,
+                                           const std::vector<std::string> &names)
+{
+    std::vector<std::pair<php_clickhouse_shard *, const clickhouse::Endpoint *>> missing;
+    for (size_t i = 0; i < endpoints.size(); ++i) {
+        php_clickhouse_shard &shard = fan_out.shards[names[i]];
+        if (!shard.client || shard.connect_state->aborted) {
+            missing.emplace_back(&shard, &endpoints[i]);
+        }
+    }
+
+    std::vector<std::exception_ptr> errors(missing.size());
+    auto connect = [&fan_out, &missing, &errors](size_t i) {
+        php_clickhouse_shard &shard = *missing[i].first;
+        try {
+            if (shard.client) {
+                shard.client->ResetConnection();
+                return;
+            }
+            clickhouse::ClientOptions options = fan_out.options;
+            options.host = missing[i].second->host;
+            options.port = missing[i].second->port;
+            options.endpoints.clear();
+            shard.client = php_clickhouse_client_new(options, fan_out.connect, shard.connect_state);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    try {
+        for (size_t i = 1; i < missing.size(); ++i) {
+            threads.emplace_back(connect, i);
+        }
+    } catch (...) {
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        throw;
+    }
+    if (!missing.empty()) {
+        connect(0);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    for (auto &error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+/* Compare two merged rows on the orderBy columns. NULLs sort last, as with
+ * the server's default NULLS LAST. */
+static int php_clickhouse_merge_compare(const std::vector<php_clickhouse_merge_key> &keys,
+                                        zval *a_row, zval *b_row)
+{
+    for (const auto &key : keys) {
+        zval *a = zend_hash_str_find(Z_ARRVAL_P(a_row), key.column.data(), key.column.size());
+        zval *b = zend_hash_str_find(Z_ARRVAL_P(b_row), key.column.data(), key.column.size());
+        bool a_null = !a || Z_TYPE_P(a) == IS_NULL;
+        bool b_null = !b || Z_TYPE_P(b) == IS_NULL;
+        if (a_null || b_null) {
+            if (a_null != b_null) {
+                return a_null ? 1 : -1;
+            }
+            continue;
+        }
+
+        int cmp;
+        if (key.bytewise && Z_TYPE_P(a) == IS_STRING && Z_TYPE_P(b) == IS_STRING) {
+            cmp = zend_binary_strcmp(Z_STRVAL_P(a), Z_STRLEN_P(a), Z_STRVAL_P(b), Z_STRLEN_P(b));
+        } else {
+#if PHP_VERSION_ID >= 80000
+            cmp = zend_compare(a, b);
+#else
+            zval result;
+            compare_function(&result, a, b);
+            cmp = static_cast<int>(Z_LVAL(result));
+#endif
+        }
+        if (cmp != 0) {
+            cmp = cmp < 0 ? -1 : 1;
+            return key.descending ? -cmp : cmp;
+        }
+    }
+    return 0;
+}
+
+/* String and FixedString, also inside Nullable and LowCardinality */
+static bool php_clickhouse_string_type(const clickhouse::TypeRef &type)
+{
+    switch (type->GetCode()) {
+    case clickhouse::Type::String:
+    case clickhouse::Type::FixedString:
+        return true;
+    case clickhouse::Type::Nullable:
+        return php_clickhouse_string_type(type->As<clickhouse::NullableType>()->GetNestedType());
+    case clickhouse::Type::LowCardinality:
+        return php_clickhouse_string_type(
+            type->As<clickhouse::LowCardinalityType>()->GetNestedType());
+    default:
+        return false;
+    }
+}
+
+/* Look the orderBy columns up in the first block that has rows */
+static void php_clickhouse_merge_resolve(std::vector<php_clickhouse_merge_key> &keys,
+                                         const clickhouse::Block &block)
+{
+    for (auto &key : keys) {
+        size_t c = 0;
+        while (c < block.GetColumnCount() && block.GetColumnName(c) != key.column) {
+            ++c;
+        }
+        if (c == block.GetColumnCount()) {
+            throw clickhouse::ValidationError("selectFanOut orderBy column '" + key.column +
+                                              "' is not in the result");
+        }
+        key.bytewise = php_clickhouse_string_type(block[c]->Type());
+    }
+}
+
+/* Run the query on every shard and collect the rows: concatenated as blocks
+ * arrive, or k-way merged when the shards return rows sorted on `keys`. The
+ * memory plan is checked against each block before its rows join the result. */
+static void php_clickhouse_fan_out_run(php_clickhouse_client *intern,
+                                       const std::vector<clickhouse::Endpoint> &endpoints,
+                                       const std::vector<std::string> &names,
+                                       const clickhouse::Query &q,
+                                       std::vector<php_clickhouse_merge_key> &keys,
+                                       php_clickhouse_memory_plan &memory,
+                                       php_clickhouse_query_watch &watch, zval *rows)
+{
+    using runner_t = php_clickhouse_query_runner;
+    php_clickhouse_fan_out &fan_out = *intern->fan_out;
+    php_clickhouse_fan_out_connect(fan_out, endpoints, names);
+
+    php_clickhouse_background_scope scope(intern);
+    auto &lanes = intern->background;
+    auto signal = std::make_shared<php_clickhouse_runner_signal>();
+    for (const auto &name : names) {
+        php_clickhouse_shard &shard = fan_out.shards[name];
+        lanes.push_back({std::make_unique<runner_t>(*shard.client, q,
+                                                    PHP_CLICKHOUSE_FAN_OUT_QUEUE_BLOCKS, signal),
+                         shard.connect_state});
+    }
+    for (auto &lane : lanes) {
+        lane.runner->start();
+    }
+
+    /* Cancel every shard without waiting for the streams to drain, since a
+     * stalled one would hold the call past its deadline; the shards reconnect
+     * on next use and run_watched reports the reason */
+    auto stop = [&lanes] {
+        for (auto &lane : lanes) {
+            lane.runner->cancel();
+            php_clickhouse_connect_abort(*lane.connect_state);
+        }
+    };
+    /* Whether a block received from a shard may join the result */
+    auto accept = [&](const clickhouse::Block &block) {
+        return !watch.cancel_requested() &&
+               php_clickhouse_memory_check(intern, memory, block, watch);
+    };
+
+    try {
+        if (keys.empty()) {
+            std::vector<runner_t *> live;
+            for (auto &lane : lanes) {
+                live.push_back(lane.runner.get());
+            }
+            size_t remaining = live.size();
+            auto ready = [](runner_t &r) { return r.ready_locked(); };
+            while (remaining > 0) {
+                int i = php_clickhouse_wait_any(live, watch.next_check(), ready);
+                if (i < 0) {
+                    if (watch.cancel_requested()) {
+                        stop();
+                        return;
+                    }
+                    continue;
+                }
+                php_clickhouse_query_event event;
+                if (live[i]->next(event) == runner_t::wait_result::finished) {
+                    live[i]->finish();
+                    live[i] = nullptr;
+                    --remaining;
+                    continue;
+                }
+                if (event.type != php_clickhouse_query_event::kind::data) {
+                    continue;
+                }
+                if (!accept(event.block)) {
+                    stop();
+                    return;
+                }
+                for (size_t r = 0; r < event.block.GetRowCount(); ++r) {
+                    zval row;
+                    php_clickhouse_row_to_zval(event.block, r, &row);
+                    add_next_index_zval(rows, &row);
+                }
+            }
+            return;
+        }
+
+        std::vector<php_clickhouse_merge_cursor> cursors(lanes.size());
+        bool resolved = false;
+        bool cancelled = false;
+        /* Load the next row of shard i into its head; false once it is
+         * exhausted or the query was cancelled */
+        auto advance = [&](size_t i) -> bool {
+            php_clickhouse_merge_cursor &cursor = cursors[i];
+            while (cursor.row >= cursor.block.GetRowCount()) {
+                php_clickhouse_query_event event;
+                auto got = cursor.runner->next(event, watch.next_check());
+                if (got == runner_t::wait_result::timeout) {
+                    if (watch.cancel_requested()) {
+                        cancelled = true;
+                        return false;
+                    }
+                    continue;
+                }
+                if (got == runner_t::wait_result::finished) {
+                    cursor.runner->finish();
+                    return false;
+                }
+                if (event.type != php_clickhouse_query_event::kind::data) {
+                    continue;
+                }
+                if (!accept(event.block)) {
+                    cancelled = true;
+                    return false;
+                }
+                cursor.block = std::move(event.block);
+                cursor.row = 0;
+                if (!resolved && cursor.block.GetRowCount() > 0) {
+                    php_clickhouse_merge_resolve(keys, cursor.block);
+                    resolved = true;
+                }
+            }
+            php_clickhouse_row_to_zval(cursor.block, cursor.row++, &cursor.head);
+            cursor.has_head = true;
+            return true;
+        };
+
+        for (size_t i = 0; i < cursors.size() && !cancelled; ++i) {
+            cursors[i].runner = lanes[i].runner.get();
+            advance(i);
+        }
+        while (!cancelled) {
+            php_clickhouse_merge_cursor *best = nullptr;
+            size_t best_index = 0;
+            for (size_t i = 0; i < cursors.size(); ++i) {
+                if (cursors[i].has_head &&
+                    (!best || php_clickhouse_merge_compare(keys, &cursors[i].head,
+                                                           &best->head) < 0)) {
+                    best = &cursors[i];
+                    best_index = i;
+                }
+            }
+            if (!best) {
+                return;
+            }
+            /* The row moves into the result */
+            add_next_index_zval(rows, &best->head);
+            best->has_head = false;
+            advance(best_index);
+        }
+        stop();
+    } catch (...) {
+        stop();
+        throw;
+    }
+}
+
+ZEND_METHOD(ClickHouse_Driver_Client, selectFanOut)
+{
+    zval *endpoints = nullptr;
+    zend_string *query = nullptr;
+    zval *params = nullptr;
+    zval *settings = nullptr;
+    zval *order_by = nullptr;
+    zend_long timeout_ms = 0;
+    zend_bool timeout_is_null = 1;
+
+    ZEND_PARSE_PARAMETERS_START(2, 6)
+    Z_PARAM_ARRAY(endpoints)
+    Z_PARAM_STR(query)
+    Z_PARAM_OPTIONAL
+    Z_PARAM_ARRAY_EX(params, 1, 0)
+    Z_PARAM_ARRAY_EX(settings, 1, 0)
+    Z_PARAM_ARRAY_EX(order_by, 1, 0)
+    Z_PARAM_LONG_OR_NULL(timeout_ms, timeout_is_null)
+    ZEND_PARSE_PARAMETERS_END();
+
+    auto *intern = Z_CLICKHOUSE_CLIENT_P(ZEND_THIS);
+    if (!php_clickhouse_client_idle(intern)) {
+        return;
+    }
+    if (!intern->fan_out) {
+        zend_throw_exception(clickhouse_ce_ClickHouseException, "Client not connected", 0);
+        return;
+    }
+
+    php_clickhouse_query_watch watch;
+    if (!php_clickhouse_watch_init(watch, timeout_ms, timeout_is_null)) {
+        return;
+    }
+
+    std::vector<clickhouse::Endpoint> shard_endpoints;
+    std::vector<std::string> names;
+    if (!php_clickhouse_fan_out_endpoints(endpoints, intern->fan_out->options.port,
+                                          shard_endpoints, names)) {
+        return;
+    }
+    std::vector<php_clickhouse_merge_key> keys;
+    if (order_by && !php_clickhouse_merge_keys(order_by, keys)) {
+        return;
+    }
+
+    array_init(return_value);
+
+    CLICKHOUSE_TRY
+    auto q = build_query(query, params, settings, nullptr);
+    apply_deadline(q, settings, watch);
+    php_clickhouse_memory_plan memory;
+    php_clickhouse_memory_begin(intern, q, query, settings, memory);
+    run_watched(intern, watch, [&] {
+        php_clickhouse_fan_out_run(intern, shard_endpoints, names, q, keys, memory, watch,
+                                   return_value);
     });
-    intern->client->SelectWithExternalData(q, tables);
     CLICKHOUSE_CATCH_RETURN
 }
 
@@ -385,8 +2371,7 @@ ZEND_METHOD(ClickHouse_Driver_Client, insert)
     ZEND_PARSE_PARAMETERS_END();
 
     auto *intern = Z_CLICKHOUSE_CLIENT_P(ZEND_THIS);
-    if (!intern->client) {
-        zend_throw_exception(clickhouse_ce_ClickHouseException, "Client not connected", 0);
+    if (!php_clickhouse_client_connected(intern)) {
         return;
     }
 
@@ -397,6 +2382,7 @@ ZEND_METHOD(ClickHouse_Driver_Client, insert)
     }
 
     CLICKHOUSE_TRY
+    php_clickhouse_in_query_scope scope(intern);
     std::string tbl(ZSTR_VAL(table_name), ZSTR_LEN(table_name));
     if (query_id) {
         std::string qid(ZSTR_VAL(query_id), ZSTR_LEN(query_id));
@@ -412,12 +2398,12 @@ ZEND_METHOD(ClickHouse_Driver_Client, ping)
     ZEND_PARSE_PARAMETERS_NONE();
 
     auto *intern = Z_CLICKHOUSE_CLIENT_P(ZEND_THIS);
-    if (!intern->client) {
-        zend_throw_exception(clickhouse_ce_ClickHouseException, "Client not connected", 0);
+    if (!php_clickhouse_client_connected(intern)) {
         return;
     }
 
     CLICKHOUSE_TRY
+    php_clickhouse_in_query_scope scope(intern);
     intern->client->Ping();
     CLICKHOUSE_CATCH
 }
@@ -427,8 +2413,10 @@ ZEND_METHOD(ClickHouse_Driver_Client, resetConnection)
     ZEND_PARSE_PARAMETERS_NONE();
 
     auto *intern = Z_CLICKHOUSE_CLIENT_P(ZEND_THIS);
-    if (!intern->client) {
-        zend_throw_exception(clickhouse_ce_ClickHouseException, "Client not connected", 0);
+    if (!intern->client && intern->pending) {
+        return; /* a lazy client gets a fresh connection on first use anyway */
+    }
+    if (!php_clickhouse_client_connected(intern)) {
         return;
     }
 
@@ -442,8 +2430,10 @@ ZEND_METHOD(ClickHouse_Driver_Client, resetConnectionEndpoint)
     ZEND_PARSE_PARAMETERS_NONE();
 
     auto *intern = Z_CLICKHOUSE_CLIENT_P(ZEND_THIS);
-    if (!intern->client) {
-        zend_throw_exception(clickhouse_ce_ClickHouseException, "Client not connected", 0);
+    if (!intern->client && intern->pending) {
+        return; /* a lazy client gets a fresh connection on first use anyway */
+    }
+    if (!php_clickhouse_client_connected(intern)) {
         return;
     }
 
@@ -461,7 +2451,7 @@ ZEND_METHOD(ClickHouse_Driver_Client, getCurrentEndpoint)
         RETURN_NULL();
     }
 
-    const auto &ep = intern->client->GetCurrentEndpoint();
+    std::optional<clickhouse::Endpoint> ep = php_clickhouse_client_endpoint(intern);
     if (!ep.has_value()) {
         RETURN_NULL();
     }
@@ -471,13 +2461,54 @@ ZEND_METHOD(ClickHouse_Driver_Client, getCurrentEndpoint)
     add_assoc_long(return_value, "port", static_cast<zend_long>(ep->port));
 }
 
+static void php_clickhouse_codec_stats_to_zval(zval *out, const php_clickhouse_codec_stats &codec)
+{
+    array_init(out);
+    add_assoc_long(out, "queries", static_cast<zend_long>(codec.queries));
+    add_assoc_double(out, "ratio", codec.ratio);
+    add_assoc_double(out, "decode", codec.decode);
+}
+
+ZEND_METHOD(ClickHouse_Driver_Client, getCompressionStats)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+
+    auto *intern = Z_CLICKHOUSE_CLIENT_P(ZEND_THIS);
+    const php_clickhouse_adaptive_compression &ac = intern->compression;
+
+    array_init(return_value);
+    add_assoc_bool(return_value, "adaptive", ac.enabled);
+    if (ac.last) {
+        add_assoc_string(return_value, "last", ac.last);
+    } else {
+        add_assoc_null(return_value, "last");
+    }
+    /* Wire bytes are only counted by the driver's own socket factory */
+    if (intern->connect_state) {
+        add_assoc_long(return_value, "bytes_received",
+                       static_cast<zend_long>(intern->connect_state->bytes_received.load()));
+        add_assoc_long(return_value, "bytes_sent",
+                       static_cast<zend_long>(intern->connect_state->bytes_sent.load()));
+    } else {
+        add_assoc_null(return_value, "bytes_received");
+        add_assoc_null(return_value, "bytes_sent");
+    }
+    add_assoc_double(return_value, "bandwidth", ac.bandwidth);
+
+    zval lz4, zstd;
+    php_clickhouse_codec_stats_to_zval(&lz4, ac.lz4);
+    add_assoc_zval(return_value, "lz4", &lz4);
+    php_clickhouse_codec_stats_to_zval(&zstd, ac.zstd);
+    add_assoc_long(&zstd, "level", static_cast<zend_long>(ac.zstd_level));
+    add_assoc_zval(return_value, "zstd", &zstd);
+}
+
 ZEND_METHOD(ClickHouse_Driver_Client, getServerInfo)
 {
     ZEND_PARSE_PARAMETERS_NONE();
 
     auto *intern = Z_CLICKHOUSE_CLIENT_P(ZEND_THIS);
-    if (!intern->client) {
-        zend_throw_exception(clickhouse_ce_ClickHouseException, "Client not connected", 0);
+    if (!php_clickhouse_client_connected(intern)) {
         return;
     }
 
@@ -519,10 +2550,23 @@ static const zend_function_entry class_ClickHouse_Driver_Client_methods[] = {
                 ZEND_ACC_PUBLIC) ZEND_ME(ClickHouse_Driver_Client, selectByBlock,
                                          arginfo_class_ClickHouse_Driver_Client_selectByBlock,
                                          ZEND_ACC_PUBLIC)
+            ZEND_ME(ClickHouse_Driver_Client, selectJson,
+                    arginfo_class_ClickHouse_Driver_Client_selectJson, ZEND_ACC_PUBLIC)
+            ZEND_ME(ClickHouse_Driver_Client, selectNative,
+                    arginfo_class_ClickHouse_Driver_Client_selectNative, ZEND_ACC_PUBLIC)
+            ZEND_ME(ClickHouse_Driver_Client, selectCached,
+                    arginfo_class_ClickHouse_Driver_Client_selectCached, ZEND_ACC_PUBLIC)
+            ZEND_ME(ClickHouse_Driver_Client, selectArrowIpc,
+                    arginfo_class_ClickHouse_Driver_Client_selectArrowIpc, ZEND_ACC_PUBLIC)
+            ZEND_ME(ClickHouse_Driver_Client, selectToStream,
+                    arginfo_class_ClickHouse_Driver_Client_selectToStream, ZEND_ACC_PUBLIC)
             ZEND_ME(ClickHouse_Driver_Client, insert, arginfo_class_ClickHouse_Driver_Client_insert,
                     ZEND_ACC_PUBLIC)
                 ZEND_ME(ClickHouse_Driver_Client, selectWithExternalData,
                         arginfo_class_ClickHouse_Driver_Client_selectWithExternalData,
+                        ZEND_ACC_PUBLIC)
+                ZEND_ME(ClickHouse_Driver_Client, selectFanOut,
+                        arginfo_class_ClickHouse_Driver_Client_selectFanOut,
                         ZEND_ACC_PUBLIC) ZEND_ME(ClickHouse_Driver_Client, ping,
                                                  arginfo_class_ClickHouse_Driver_Client_ping,
                                                  ZEND_ACC_PUBLIC)
@@ -534,6 +2578,9 @@ static const zend_function_entry class_ClickHouse_Driver_Client_methods[] = {
                             ZEND_ME(ClickHouse_Driver_Client, getCurrentEndpoint,
                                     arginfo_class_ClickHouse_Driver_Client_getCurrentEndpoint,
                                     ZEND_ACC_PUBLIC)
+                            ZEND_ME(ClickHouse_Driver_Client, getCompressionStats,
+                                    arginfo_class_ClickHouse_Driver_Client_getCompressionStats,
+                                    ZEND_ACC_PUBLIC)
                                 ZEND_ME(ClickHouse_Driver_Client, getServerInfo,
                                         arginfo_class_ClickHouse_Driver_Client_getServerInfo,
                                         ZEND_ACC_PUBLIC) ZEND_FE_END};
@@ -3,12 +3,124 @@
 
 #include "php_clickhouse.h"
 #include "clickhouse/client.h"
+#include "src/client_options.h"
+#include "src/query_runner.h"
+#include "src/socket_factory.h"
 
+#include <map>
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* Blocks buffered per connection while a hedged select is racing */
+#define PHP_CLICKHOUSE_HEDGE_QUEUE_BLOCKS 16
+
+/* Blocks buffered per shard by selectFanOut */
+#define PHP_CLICKHOUSE_FAN_OUT_QUEUE_BLOCKS 8
+
+/* Queries whose converted row size a client remembers (blockMemoryBudget) */
+#define PHP_CLICKHOUSE_ROW_COST_CACHE 256
+
+/* Connection settings kept by a lazyConnect client until its first use */
+struct php_clickhouse_pending_connect
+{
+    clickhouse::ClientOptions options;
+    php_clickhouse_extra_options extra;
+};
+
+/* Second connection used by hedged selects (hedgeDelayMs) */
+struct php_clickhouse_hedge
+{
+    clickhouse::ClientOptions options;
+    php_clickhouse_connect_options connect;
+    std::chrono::milliseconds delay;
+    /* Opened by the first select that actually hedges */
+    std::unique_ptr<clickhouse::Client> client;
+    std::shared_ptr<php_clickhouse_connect_state> connect_state;
+    /* The losing query of the last race, aborted and left to exit on its own;
+     * it always runs on `client` and is joined before that is used again */
+    std::unique_ptr<php_clickhouse_query_runner> straggler;
+};
+
+/* What one result codec achieved on a client (CompressionMethod::Adaptive) */
+struct php_clickhouse_codec_stats
+{
+    uint64_t queries = 0;
+    /* Moving average of uncompressed / wire bytes */
+    double ratio = 0;
+    /* Moving average of the seconds clickhouse-cpp spent decompressing and
+     * parsing one uncompressed byte; zero until timed */
+    double decode = 0;
+};
+
+struct php_clickhouse_adaptive_compression
+{
+    bool enabled = false;
+    /* Moving average of the wire throughput of results while their blocks
+     * arrive, bytes per second spent waiting on the socket */
+    double bandwidth = 0;
+    php_clickhouse_codec_stats lz4;
+    php_clickhouse_codec_stats zstd;
+    int zstd_level = 1;
+    /* Adaptive selects since the codec not picked was last used */
+    uint64_t since_explore = 0;
+    /* Codec picked for the last query, or null */
+    const char *last = nullptr;
+};
+
+/* blockMemoryBudget and memoryLimitFraction */
+struct php_clickhouse_memory_budget
+{
+    size_t block_bytes = 0;
+    double limit_fraction = 0;
+    /* PHP bytes per converted row, learned from each query text's first block */
+    std::unordered_map<std::string, size_t> row_costs;
+};
+
+struct php_clickhouse_shard
+{
+    std::unique_ptr<clickhouse::Client> client;
+    std::shared_ptr<php_clickhouse_connect_state> connect_state;
+};
+
+/* Shard connections of selectFanOut, keyed by "host:port", opened on first use */
+struct php_clickhouse_fan_out
+{
+    clickhouse::ClientOptions options;
+    php_clickhouse_connect_options connect;
+    std::map<std::string, php_clickhouse_shard> shards;
+};
+
+/* A query of the current call running on a background thread, with the
+ * state of the socket it reads from */
+struct php_clickhouse_background_query
+{
+    std::unique_ptr<php_clickhouse_query_runner> runner;
+    std::shared_ptr<php_clickhouse_connect_state> connect_state;
+};
 
 struct php_clickhouse_client
 {
     std::unique_ptr<clickhouse::Client> client;
+    /* Set when the driver's own socket factory is in use */
+    std::shared_ptr<php_clickhouse_connect_state> connect_state;
+    /* Set while a lazyConnect client has not connected yet */
+    std::unique_ptr<php_clickhouse_pending_connect> pending;
+    /* A query is executing; still set after a bailout out of a callback */
+    bool in_query;
+    std::unique_ptr<php_clickhouse_hedge> hedge;
+    std::unique_ptr<php_clickhouse_fan_out> fan_out;
+    /* readAheadBlocks; zero receives on the PHP thread */
+    size_t read_ahead_blocks;
+    php_clickhouse_adaptive_compression compression;
+    php_clickhouse_memory_budget memory;
+    /* Servers, database and user, the part of selectCached() keys that
+     * keeps clients of different servers or users apart */
+    std::string cache_scope;
+    /* Owned here rather than by the caller so free_obj can stop the threads
+     * when a bailout skipped the caller's cleanup */
+    std::vector<php_clickhouse_background_query> background;
     zend_object std;
 };
 
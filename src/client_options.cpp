@@ -21,6 +21,7 @@ static zend_object *php_clickhouse_client_options_create(zend_class_entry *ce)
         zend_object_alloc(sizeof(php_clickhouse_client_options), ce));
 
     new (&intern->options) std::unique_ptr<clickhouse::ClientOptions>();
+    new (&intern->extra) php_clickhouse_extra_options();
 
     zend_object_std_init(&intern->std, ce);
     object_properties_init(&intern->std, ce);
@@ -33,6 +34,7 @@ static void php_clickhouse_client_options_free(zend_object *object)
 {
     auto *intern = php_clickhouse_client_options_from_obj(object);
     intern->options.~unique_ptr();
+    intern->extra.~php_clickhouse_extra_options();
     zend_object_std_dtor(object);
 }
 
@@ -46,6 +48,7 @@ static const php_clickhouse_enum_case php_clickhouse_compression_cases[] = {
     {"None", -1},
     {"LZ4", 1},
     {"ZSTD", 2},
+    {"Adaptive", PHP_CLICKHOUSE_COMPRESSION_ADAPTIVE},
     {nullptr, 0},
 };
 
@@ -133,6 +136,12 @@ static bool php_clickhouse_validate_numeric_option(const char *name, zend_long v
     return true;
 }
 
+bool php_clickhouse_compression_from_zval(zval *value, zend_long *out)
+{
+    return php_clickhouse_zval_to_enum_value(value, clickhouse_ce_CompressionMethod,
+                                             php_clickhouse_compression_cases, out);
+}
+
 ZEND_METHOD(ClickHouse_Driver_ClientOptions, __construct)
 {
     zend_string *host = nullptr;
@@ -155,8 +164,19 @@ ZEND_METHOD(ClickHouse_Driver_ClientOptions, __construct)
     zend_long tcp_keepalive_interval = 5;
     zend_long tcp_keepalive_count = 3;
     zend_long max_compression_chunk_size = 65535;
-
-    ZEND_PARSE_PARAMETERS_START(0, 20)
+    zend_long connect_parallelism = 1;
+    zend_long connect_stagger_ms = 250;
+    zend_long dns_cache_ttl = 0;
+    zend_long dns_negative_ttl = 5;
+    zend_bool lazy_connect = false;
+    zend_long hedge_delay_ms = 0;
+    zend_long read_ahead_blocks = 0;
+    zend_bool io_uring = false;
+    zend_long zero_copy_threshold = 0;
+    zend_long block_memory_budget = 0;
+    double memory_limit_fraction = 0;
+
+    ZEND_PARSE_PARAMETERS_START(0, 31)
     Z_PARAM_OPTIONAL
     Z_PARAM_STR(host)
     Z_PARAM_LONG(port)
@@ -178,6 +198,17 @@ ZEND_METHOD(ClickHouse_Driver_ClientOptions, __construct)
     Z_PARAM_LONG(tcp_keepalive_interval)
     Z_PARAM_LONG(tcp_keepalive_count)
     Z_PARAM_LONG(max_compression_chunk_size)
+    Z_PARAM_LONG(connect_parallelism)
+    Z_PARAM_LONG(connect_stagger_ms)
+    Z_PARAM_LONG(dns_cache_ttl)
+    Z_PARAM_LONG(dns_negative_ttl)
+    Z_PARAM_BOOL(lazy_connect)
+    Z_PARAM_LONG(hedge_delay_ms)
+    Z_PARAM_LONG(read_ahead_blocks)
+    Z_PARAM_BOOL(io_uring)
+    Z_PARAM_LONG(zero_copy_threshold)
+    Z_PARAM_LONG(block_memory_budget)
+    Z_PARAM_DOUBLE(memory_limit_fraction)
     ZEND_PARSE_PARAMETERS_END();
 
     const uint64_t unsigned_int_max =
@@ -201,7 +232,28 @@ ZEND_METHOD(ClickHouse_Driver_ClientOptions, __construct)
         !php_clickhouse_validate_numeric_option("tcpKeepAliveCount", tcp_keepalive_count, 0,
                                                 unsigned_int_max) ||
         !php_clickhouse_validate_numeric_option("maxCompressionChunkSize",
-                                                max_compression_chunk_size, 1, unsigned_int_max)) {
+                                                max_compression_chunk_size, 1, unsigned_int_max) ||
+        !php_clickhouse_validate_numeric_option("connectParallelism", connect_parallelism, 1,
+                                                PHP_CLICKHOUSE_MAX_CONNECT_PARALLELISM) ||
+        !php_clickhouse_validate_numeric_option("connectStaggerMs", connect_stagger_ms, 0,
+                                                PHP_CLICKHOUSE_MAX_CONNECT_STAGGER_MS) ||
+        !php_clickhouse_validate_numeric_option("dnsCacheTtlSeconds", dns_cache_ttl, 0,
+                                                zend_long_max) ||
+        !php_clickhouse_validate_numeric_option("dnsNegativeTtlSeconds", dns_negative_ttl, 0,
+                                                zend_long_max) ||
+        !php_clickhouse_validate_numeric_option("hedgeDelayMs", hedge_delay_ms, 0,
+                                                PHP_CLICKHOUSE_MAX_HEDGE_DELAY_MS) ||
+        !php_clickhouse_validate_numeric_option("readAheadBlocks", read_ahead_blocks, 0,
+                                                PHP_CLICKHOUSE_MAX_READ_AHEAD_BLOCKS) ||
+        !php_clickhouse_validate_numeric_option("zeroCopyThreshold", zero_copy_threshold, 0,
+                                                zend_long_max) ||
+        !php_clickhouse_validate_numeric_option("blockMemoryBudget", block_memory_budget, 0,
+                                                zend_long_max)) {
+        return;
+    }
+    if (!(memory_limit_fraction >= 0 && memory_limit_fraction <= 1)) {
+        zend_throw_exception(clickhouse_ce_ValidationException,
+                             "ClientOptions parameter memoryLimitFraction is out of range", 0);
         return;
     }
 
@@ -264,6 +316,7 @@ ZEND_METHOD(ClickHouse_Driver_ClientOptions, __construct)
     }
 
     /* Compression enum */
+    bool adaptive_compression = false;
     if (compression) {
         zend_long compression_value = 0;
         if (!php_clickhouse_zval_to_enum_value(compression, clickhouse_ce_CompressionMethod,
@@ -273,6 +326,11 @@ ZEND_METHOD(ClickHouse_Driver_ClientOptions, __construct)
                                  0);
             return;
         }
+        if (compression_value == PHP_CLICKHOUSE_COMPRESSION_ADAPTIVE) {
+            /* The codec of each result is picked per query; connections and inserts use LZ4 */
+            adaptive_compression = true;
+            compression_value = static_cast<zend_long>(clickhouse::CompressionMethod::LZ4);
+        }
         opts->SetCompressionMethod(static_cast<clickhouse::CompressionMethod>(compression_value));
     }
 
@@ -281,21 +339,25 @@ ZEND_METHOD(ClickHouse_Driver_ClientOptions, __construct)
         clickhouse::ClientOptions::SSLOptions ssl_opts;
         ssl_opts.SetUseDefaultCALocations(true);
         ssl_opts.SetUseSNI(true);
+        php_clickhouse_tls_options tls;
 
         HashTable *ht = Z_ARRVAL_P(ssl);
         zval *tmp;
 
         if ((tmp = zend_hash_str_find(ht, "skip_verification", sizeof("skip_verification") - 1)) !=
             nullptr) {
-            ssl_opts.SetSkipVerification(zend_is_true(tmp));
+            tls.skip_verification = zend_is_true(tmp);
+            ssl_opts.SetSkipVerification(tls.skip_verification);
         }
         if ((tmp = zend_hash_str_find(ht, "use_default_ca", sizeof("use_default_ca") - 1)) !=
             nullptr) {
-            ssl_opts.SetUseDefaultCALocations(zend_is_true(tmp));
+            tls.use_default_ca = zend_is_true(tmp);
+            ssl_opts.SetUseDefaultCALocations(tls.use_default_ca);
         }
         if ((tmp = zend_hash_str_find(ht, "ca_directory", sizeof("ca_directory") - 1)) != nullptr &&
             Z_TYPE_P(tmp) == IS_STRING) {
-            ssl_opts.SetPathToCADirectory(std::string(Z_STRVAL_P(tmp), Z_STRLEN_P(tmp)));
+            tls.ca_directory.assign(Z_STRVAL_P(tmp), Z_STRLEN_P(tmp));
+            ssl_opts.SetPathToCADirectory(tls.ca_directory);
         }
         std::vector<std::string> ca_files;
         if ((tmp = zend_hash_str_find(ht, "ca_file", sizeof("ca_file") - 1)) != nullptr &&
@@ -315,27 +377,50 @@ ZEND_METHOD(ClickHouse_Driver_ClientOptions, __construct)
         }
         if (!ca_files.empty()) {
             ssl_opts.SetPathToCAFiles(ca_files);
+            tls.ca_files = std::move(ca_files);
         }
         if ((tmp = zend_hash_str_find(ht, "use_sni", sizeof("use_sni") - 1)) != nullptr) {
-            ssl_opts.SetUseSNI(zend_is_true(tmp));
+            tls.use_sni = zend_is_true(tmp);
+            ssl_opts.SetUseSNI(tls.use_sni);
         }
         std::vector<clickhouse::ClientOptions::SSLOptions::CommandAndValue> ssl_config;
         if ((tmp = zend_hash_str_find(ht, "client_cert", sizeof("client_cert") - 1)) != nullptr &&
             Z_TYPE_P(tmp) == IS_STRING) {
-            ssl_config.push_back({"Certificate", std::string(Z_STRVAL_P(tmp), Z_STRLEN_P(tmp))});
+            tls.client_cert.assign(Z_STRVAL_P(tmp), Z_STRLEN_P(tmp));
+            ssl_config.push_back({"Certificate", tls.client_cert});
         }
         if ((tmp = zend_hash_str_find(ht, "client_key", sizeof("client_key") - 1)) != nullptr &&
             Z_TYPE_P(tmp) == IS_STRING) {
-            ssl_config.push_back({"PrivateKey", std::string(Z_STRVAL_P(tmp), Z_STRLEN_P(tmp))});
+            tls.client_key.assign(Z_STRVAL_P(tmp), Z_STRLEN_P(tmp));
+            ssl_config.push_back({"PrivateKey", tls.client_key});
         }
         if (!ssl_config.empty()) {
             ssl_opts.SetConfiguration(ssl_config);
         }
 
+        /* The driver's TLS sockets apply clickhouse-cpp's defaults for these */
+        tls.context_options = ssl_opts.context_options;
+        tls.min_protocol_version = ssl_opts.min_protocol_version;
+        tls.max_protocol_version = ssl_opts.max_protocol_version;
+        tls.host_flags = ssl_opts.host_flags;
+
         opts->SetSSLOptions(std::move(ssl_opts));
+        intern->extra.connect.tls = std::move(tls);
     }
 
     intern->options = std::move(opts);
+    intern->extra.connect.parallelism = static_cast<unsigned int>(connect_parallelism);
+    intern->extra.connect.stagger = std::chrono::milliseconds(connect_stagger_ms);
+    intern->extra.connect.dns.ttl = std::chrono::seconds(dns_cache_ttl);
+    intern->extra.connect.dns.negative_ttl = std::chrono::seconds(dns_negative_ttl);
+    intern->extra.connect.io_uring = io_uring;
+    intern->extra.connect.zero_copy_threshold = static_cast<size_t>(zero_copy_threshold);
+    intern->extra.lazy_connect = lazy_connect;
+    intern->extra.hedge_delay = std::chrono::milliseconds(hedge_delay_ms);
+    intern->extra.read_ahead_blocks = static_cast<size_t>(read_ahead_blocks);
+    intern->extra.adaptive_compression = adaptive_compression;
+    intern->extra.block_memory_budget = static_cast<size_t>(block_memory_budget);
+    intern->extra.memory_limit_fraction = memory_limit_fraction;
 
     CLICKHOUSE_CATCH
 }
@@ -3,12 +3,48 @@
 
 #include "php_clickhouse.h"
 #include "clickhouse/client.h"
+#include "src/socket_factory.h"
 
+#include <chrono>
 #include <memory>
 
+/* Upper bound for connectParallelism; more sockets than this only adds SYN load */
+#define PHP_CLICKHOUSE_MAX_CONNECT_PARALLELISM 16
+
+/* Upper bound for connectStaggerMs */
+#define PHP_CLICKHOUSE_MAX_CONNECT_STAGGER_MS 60000
+
+/* Upper bound for hedgeDelayMs */
+#define PHP_CLICKHOUSE_MAX_HEDGE_DELAY_MS 600000
+
+/* Upper bound for readAheadBlocks */
+#define PHP_CLICKHOUSE_MAX_READ_AHEAD_BLOCKS 1024
+
+/* CompressionMethod::Adaptive; has no clickhouse::CompressionMethod counterpart */
+#define PHP_CLICKHOUSE_COMPRESSION_ADAPTIVE 3
+
+/* Driver-level settings that have no counterpart in clickhouse::ClientOptions */
+struct php_clickhouse_extra_options
+{
+    php_clickhouse_connect_options connect;
+    /* Connect on first use instead of in Client::__construct */
+    bool lazy_connect = false;
+    /* Hedged select() delay; zero disables hedging */
+    std::chrono::milliseconds hedge_delay{0};
+    /* Blocks received ahead of the PHP thread by select()/selectByBlock(); zero disables */
+    size_t read_ahead_blocks = 0;
+    /* CompressionMethod::Adaptive: choose the codec of each result */
+    bool adaptive_compression = false;
+    /* PHP memory one result block may take once converted; zero keeps the server's sizes */
+    size_t block_memory_budget = 0;
+    /* Share of memory_limit a select may fill before it is cancelled; zero disables */
+    double memory_limit_fraction = 0;
+};
+
 struct php_clickhouse_client_options
 {
     std::unique_ptr<clickhouse::ClientOptions> options;
+    php_clickhouse_extra_options extra;
     zend_object std;
 };
 
@@ -21,6 +57,9 @@ php_clickhouse_client_options_from_obj(zend_object *obj)
 
 #define Z_CLICKHOUSE_OPTIONS_P(zv) php_clickhouse_client_options_from_obj(Z_OBJ_P(zv))
 
+/* A CompressionMethod case (its int value before PHP 8.1) as a zend_long; false if invalid */
+bool php_clickhouse_compression_from_zval(zval *value, zend_long *out);
+
 void php_clickhouse_register_client_options(int module_number);
 void php_clickhouse_register_enums(int module_number);
 void php_clickhouse_register_server_info(int module_number);
@@ -1,12 +1,22 @@
 #include "src/column.h"
+#include "src/column_aggregate.h"
 #include "src/column_convert.h"
+#include "src/column_filter.h"
 #include "src/column_write.h"
 #include "src/common.h"
 #include "clickhouse_arginfo.h"
+#include "clickhouse/base/buffer.h"
+#include "clickhouse/base/input.h"
+#include "clickhouse/base/output.h"
 #include "clickhouse/columns/factory.h"
+#include "clickhouse/columns/nullable.h"
+#include "clickhouse/columns/numeric.h"
+#include "clickhouse/types/types.h"
 
 zend_class_entry *clickhouse_ce_Column = nullptr;
+zend_class_entry *clickhouse_ce_ColumnBuffer = nullptr;
 static zend_object_handlers clickhouse_column_handlers;
+static zend_object_handlers clickhouse_column_buffer_handlers;
 
 static zend_object *php_clickhouse_column_create(zend_class_entry *ce)
 {
@@ -153,6 +163,433 @@ ZEND_METHOD(ClickHouse_Driver_Column, toArray)
     }
 }
 
+/*
+ * Bytes per value of the types whose Native body is a packed little-endian
+ * array of fixed-size values, 0 for all others. Decimals are stored as Int32,
+ * Int64 or Int128 by precision, DateTime64 as Int64 ticks, Date as UInt16
+ * days, Date32 as Int32 days, UUID as two UInt64 halves.
+ */
+static size_t php_clickhouse_packed_width(const clickhouse::TypeRef &type)
+{
+    using clickhouse::Type;
+
+    switch (type->GetCode()) {
+    case Type::Int8:
+    case Type::UInt8:
+        return 1;
+    case Type::Int16:
+    case Type::UInt16:
+    case Type::Date:
+        return 2;
+    case Type::Int32:
+    case Type::UInt32:
+    case Type::Float32:
+    case Type::Date32:
+    case Type::DateTime:
+        return 4;
+    case Type::Int64:
+    case Type::UInt64:
+    case Type::Float64:
+    case Type::DateTime64:
+        return 8;
+    case Type::Int128:
+    case Type::UInt128:
+    case Type::UUID:
+        return 16;
+    case Type::Decimal:
+    case Type::Decimal32:
+    case Type::Decimal64:
+    case Type::Decimal128: {
+        size_t precision = type->As<clickhouse::DecimalType>()->GetPrecision();
+        return precision <= 9 ? 4 : precision <= 18 ? 8 : 16;
+    }
+    case Type::FixedString:
+        return type->As<clickhouse::FixedStringType>()->GetSize();
+    default:
+        return 0;
+    }
+}
+
+ZEND_METHOD(ClickHouse_Driver_Column, toBinary)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+
+    auto *intern = Z_CLICKHOUSE_COLUMN_P(ZEND_THIS);
+    if (!intern->column) {
+        RETURN_EMPTY_STRING();
+    }
+
+    size_t width = php_clickhouse_packed_width(intern->column->Type());
+    if (width == 0) {
+        zend_throw_exception_ex(clickhouse_ce_ValidationException, 0,
+                                "Column of type %s has no packed binary form",
+                                intern->column->Type()->GetName().c_str());
+        return;
+    }
+
+    CLICKHOUSE_TRY
+    clickhouse::Buffer buffer;
+    buffer.reserve(intern->column->Size() * width);
+    clickhouse::BufferOutput output(&buffer);
+    intern->column->Save(&output);
+    output.Flush();
+    RETVAL_STRINGL(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+    CLICKHOUSE_CATCH
+}
+
+ZEND_METHOD(ClickHouse_Driver_Column, fromBinary)
+{
+    zend_string *type_name = nullptr;
+    zend_string *bytes = nullptr;
+
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+    Z_PARAM_STR(type_name)
+    Z_PARAM_STR(bytes)
+    ZEND_PARSE_PARAMETERS_END();
+
+    CLICKHOUSE_TRY
+    std::string cpp_type_name(ZSTR_VAL(type_name), ZSTR_LEN(type_name));
+    clickhouse::ColumnRef col = clickhouse::CreateColumnByType(cpp_type_name);
+
+    if (!col) {
+        zend_throw_exception_ex(clickhouse_ce_ValidationException, 0, "Unknown ClickHouse type: %s",
+                                ZSTR_VAL(type_name));
+        return;
+    }
+
+    size_t width = php_clickhouse_packed_width(col->Type());
+    if (width == 0) {
+        zend_throw_exception_ex(clickhouse_ce_ValidationException, 0,
+                                "Column of type %s has no packed binary form",
+                                ZSTR_VAL(type_name));
+        return;
+    }
+    if (ZSTR_LEN(bytes) % width != 0) {
+        zend_throw_exception_ex(clickhouse_ce_ValidationException, 0,
+                                "Binary data of %zu bytes is not a multiple of the %zu-byte %s",
+                                ZSTR_LEN(bytes), width, ZSTR_VAL(type_name));
+        return;
+    }
+
+    size_t rows = ZSTR_LEN(bytes) / width;
+    if (rows) {
+        clickhouse::ArrayInput input(ZSTR_VAL(bytes), ZSTR_LEN(bytes));
+        if (!col->Load(&input, rows)) {
+            zend_throw_exception_ex(clickhouse_ce_ValidationException, 0,
+                                    "Binary data does not hold %zu values of type %s", rows,
+                                    ZSTR_VAL(type_name));
+            return;
+        }
+    }
+
+    php_clickhouse_create_column_from_ref(return_value, col);
+    CLICKHOUSE_CATCH_RETURN
+}
+
+/* Shared body of Column::sum(), min(), max() and mean() */
+static void php_clickhouse_column_reduce(zval *object, php_clickhouse_aggregate op,
+                                         zval *return_value)
+{
+    auto *intern = Z_CLICKHOUSE_COLUMN_P(object);
+    if (!intern->column) {
+        if (op == php_clickhouse_aggregate::sum) {
+            RETURN_LONG(0);
+        }
+        RETURN_NULL();
+    }
+
+    CLICKHOUSE_TRY
+    if (!php_clickhouse_column_aggregate(intern->column, op, return_value)) {
+        zend_throw_exception_ex(clickhouse_ce_ValidationException, 0,
+                                "Column of type %s cannot be aggregated",
+                                intern->column->Type()->GetName().c_str());
+    }
+    CLICKHOUSE_CATCH
+}
+
+ZEND_METHOD(ClickHouse_Driver_Column, sum)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    php_clickhouse_column_reduce(ZEND_THIS, php_clickhouse_aggregate::sum, return_value);
+}
+
+ZEND_METHOD(ClickHouse_Driver_Column, min)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    php_clickhouse_column_reduce(ZEND_THIS, php_clickhouse_aggregate::min, return_value);
+}
+
+ZEND_METHOD(ClickHouse_Driver_Column, max)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    php_clickhouse_column_reduce(ZEND_THIS, php_clickhouse_aggregate::max, return_value);
+}
+
+ZEND_METHOD(ClickHouse_Driver_Column, mean)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    php_clickhouse_column_reduce(ZEND_THIS, php_clickhouse_aggregate::mean, return_value);
+}
+
+ZEND_METHOD(ClickHouse_Driver_Column, countNonNull)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+
+    auto *intern = Z_CLICKHOUSE_COLUMN_P(ZEND_THIS);
+    if (!intern->column) {
+        RETURN_LONG(0);
+    }
+    RETURN_LONG(static_cast<zend_long>(php_clickhouse_column_count_non_null(intern->column)));
+}
+
+ZEND_METHOD(ClickHouse_Driver_Column, quantiles)
+{
+    zval *levels_zv = nullptr;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+    Z_PARAM_ARRAY(levels_zv)
+    ZEND_PARSE_PARAMETERS_END();
+
+    std::vector<double> levels;
+    zval *entry;
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(levels_zv), entry)
+    {
+        double level = Z_TYPE_P(entry) == IS_LONG     ? static_cast<double>(Z_LVAL_P(entry))
+                       : Z_TYPE_P(entry) == IS_DOUBLE ? Z_DVAL_P(entry)
+                                                      : -1.0;
+        if (!(level >= 0.0 && level <= 1.0)) {
+            zend_throw_exception(clickhouse_ce_ValidationException,
+                                 "Quantile levels must be numbers from 0 to 1", 0);
+            return;
+        }
+        levels.push_back(level);
+    }
+    ZEND_HASH_FOREACH_END();
+
+    auto *intern = Z_CLICKHOUSE_COLUMN_P(ZEND_THIS);
+    if (!intern->column) {
+        array_init(return_value);
+        for (size_t i = 0; i < levels.size(); ++i) {
+            add_next_index_null(return_value);
+        }
+        return;
+    }
+
+    CLICKHOUSE_TRY
+    if (!php_clickhouse_column_quantiles(intern->column, levels, return_value)) {
+        zend_throw_exception_ex(clickhouse_ce_ValidationException, 0,
+                                "Column of type %s cannot be aggregated",
+                                intern->column->Type()->GetName().c_str());
+    }
+    CLICKHOUSE_CATCH
+}
+
+ZEND_METHOD(ClickHouse_Driver_Column, slice)
+{
+    zend_long offset = 0;
+    zend_long length = 0;
+    zend_bool length_is_null = 1;
+
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+    Z_PARAM_LONG(offset)
+    Z_PARAM_OPTIONAL
+    Z_PARAM_LONG_OR_NULL(length, length_is_null)
+    ZEND_PARSE_PARAMETERS_END();
+
+    auto *intern = Z_CLICKHOUSE_COLUMN_P(ZEND_THIS);
+    size_t begin = 0;
+    size_t len = 0;
+    if (!intern->column || !php_clickhouse_slice_range(offset, length, length_is_null,
+                                                       intern->column->Size(), begin, len)) {
+        zend_throw_exception(clickhouse_ce_ValidationException, "Slice out of range", 0);
+        return;
+    }
+
+    CLICKHOUSE_TRY
+    php_clickhouse_create_column_from_ref(return_value, intern->column->Slice(begin, len));
+    CLICKHOUSE_CATCH
+}
+
+ZEND_METHOD(ClickHouse_Driver_Column, compare)
+{
+    zend_string *op_name = nullptr;
+    zval *value = nullptr;
+
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+    Z_PARAM_STR(op_name)
+    Z_PARAM_ZVAL(value)
+    ZEND_PARSE_PARAMETERS_END();
+
+    php_clickhouse_compare_op op;
+    if (!php_clickhouse_compare_op_parse(ZSTR_VAL(op_name), ZSTR_LEN(op_name), op)) {
+        zend_throw_exception_ex(clickhouse_ce_ValidationException, 0,
+                                "Unknown comparison operator: %s", ZSTR_VAL(op_name));
+        return;
+    }
+
+    auto *intern = Z_CLICKHOUSE_COLUMN_P(ZEND_THIS);
+    if (!intern->column) {
+        php_clickhouse_create_column_from_ref(return_value,
+                                              clickhouse::CreateColumnByType("UInt8"));
+        return;
+    }
+
+    CLICKHOUSE_TRY
+    clickhouse::ColumnRef mask = php_clickhouse_column_compare(intern->column, op, value);
+    if (!mask) {
+        zend_throw_exception_ex(clickhouse_ce_ValidationException, 0,
+                                "Column of type %s cannot be compared with %s",
+                                intern->column->Type()->GetName().c_str(),
+                                zend_zval_type_name(value));
+        return;
+    }
+    php_clickhouse_create_column_from_ref(return_value, mask);
+    CLICKHOUSE_CATCH
+}
+
+static zend_object *php_clickhouse_column_buffer_create(zend_class_entry *ce)
+{
+    auto *intern = static_cast<php_clickhouse_column_buffer *>(
+        zend_object_alloc(sizeof(php_clickhouse_column_buffer), ce));
+
+    new (&intern->column) clickhouse::ColumnRef();
+    intern->data = nullptr;
+    intern->count = 0;
+    intern->width = 0;
+    intern->ctype = "";
+
+    zend_object_std_init(&intern->std, ce);
+    object_properties_init(&intern->std, ce);
+    intern->std.handlers = &clickhouse_column_buffer_handlers;
+
+    return &intern->std;
+}
+
+static void php_clickhouse_column_buffer_free(zend_object *object)
+{
+    auto *intern = php_clickhouse_column_buffer_from_obj(object);
+    intern->column.~shared_ptr();
+    zend_object_std_dtor(object);
+}
+
+template <typename T>
+static bool php_clickhouse_vector_buffer(zval *return_value, const clickhouse::ColumnRef &col,
+                                         const char *ctype)
+{
+    auto typed = col->As<clickhouse::ColumnVector<T>>();
+    if (!typed) {
+        return false;
+    }
+
+    auto &data = typed->GetWritableData();
+    object_init_ex(return_value, clickhouse_ce_ColumnBuffer);
+    auto *view = Z_CLICKHOUSE_COLUMN_BUFFER_P(return_value);
+    view->column = col;
+    view->data = data.data();
+    view->count = data.size();
+    view->width = sizeof(T);
+    view->ctype = ctype;
+    return true;
+}
+
+/* A ColumnBuffer over the ColumnVector behind `col`, false for other columns */
+static bool php_clickhouse_column_buffer_init(zval *return_value, const clickhouse::ColumnRef &col)
+{
+    using clickhouse::Type;
+
+    switch (col->Type()->GetCode()) {
+    case Type::Int8:
+        return php_clickhouse_vector_buffer<int8_t>(return_value, col, "int8_t");
+    case Type::UInt8:
+        return php_clickhouse_vector_buffer<uint8_t>(return_value, col, "uint8_t");
+    case Type::Int16:
+        return php_clickhouse_vector_buffer<int16_t>(return_value, col, "int16_t");
+    case Type::UInt16:
+        return php_clickhouse_vector_buffer<uint16_t>(return_value, col, "uint16_t");
+    case Type::Int32:
+        return php_clickhouse_vector_buffer<int32_t>(return_value, col, "int32_t");
+    case Type::UInt32:
+        return php_clickhouse_vector_buffer<uint32_t>(return_value, col, "uint32_t");
+    case Type::Int64:
+        return php_clickhouse_vector_buffer<int64_t>(return_value, col, "int64_t");
+    case Type::UInt64:
+        return php_clickhouse_vector_buffer<uint64_t>(return_value, col, "uint64_t");
+    case Type::Float32:
+        return php_clickhouse_vector_buffer<float>(return_value, col, "float");
+    case Type::Float64:
+        return php_clickhouse_vector_buffer<double>(return_value, col, "double");
+    default:
+        return false;
+    }
+}
+
+ZEND_METHOD(ClickHouse_Driver_Column, bufferView)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+
+    auto *intern = Z_CLICKHOUSE_COLUMN_P(ZEND_THIS);
+    if (!intern->column) {
+        object_init_ex(return_value, clickhouse_ce_ColumnBuffer);
+        return;
+    }
+
+    clickhouse::ColumnRef col = intern->column;
+    if (auto nullable = col->As<clickhouse::ColumnNullable>()) {
+        col = nullable->Nested();
+    }
+    if (!php_clickhouse_column_buffer_init(return_value, col)) {
+        zend_throw_exception_ex(clickhouse_ce_ValidationException, 0,
+                                "Column of type %s has no numeric buffer",
+                                intern->column->Type()->GetName().c_str());
+    }
+}
+
+ZEND_METHOD(ClickHouse_Driver_Column, nullMapView)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+
+    auto *intern = Z_CLICKHOUSE_COLUMN_P(ZEND_THIS);
+    auto nullable = intern->column ? intern->column->As<clickhouse::ColumnNullable>() : nullptr;
+    if (!nullable) {
+        zend_throw_exception_ex(clickhouse_ce_ValidationException, 0,
+                                "Column of type %s is not Nullable",
+                                intern->column ? intern->column->Type()->GetName().c_str() : "");
+        return;
+    }
+
+    php_clickhouse_vector_buffer<uint8_t>(return_value, nullable->Nulls(), "uint8_t");
+}
+
+ZEND_METHOD(ClickHouse_Driver_ColumnBuffer, getAddress)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+
+    auto *intern = Z_CLICKHOUSE_COLUMN_BUFFER_P(ZEND_THIS);
+    RETURN_LONG(static_cast<zend_long>(reinterpret_cast<uintptr_t>(intern->data)));
+}
+
+ZEND_METHOD(ClickHouse_Driver_ColumnBuffer, getCount)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+
+    RETURN_LONG(static_cast<zend_long>(Z_CLICKHOUSE_COLUMN_BUFFER_P(ZEND_THIS)->count));
+}
+
+ZEND_METHOD(ClickHouse_Driver_ColumnBuffer, getByteLength)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+
+    auto *intern = Z_CLICKHOUSE_COLUMN_BUFFER_P(ZEND_THIS);
+    RETURN_LONG(static_cast<zend_long>(intern->count * intern->width));
+}
+
+ZEND_METHOD(ClickHouse_Driver_ColumnBuffer, getCType)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+
+    RETURN_STRING(Z_CLICKHOUSE_COLUMN_BUFFER_P(ZEND_THIS)->ctype);
+}
+
 void php_clickhouse_create_column_from_ref(zval *return_value, clickhouse::ColumnRef col_ref)
 {
     object_init_ex(return_value, clickhouse_ce_Column);
@@ -172,7 +609,45 @@ static const zend_function_entry class_ClickHouse_Driver_Column_methods[] = {
                     ZEND_ME(ClickHouse_Driver_Column, at, arginfo_class_ClickHouse_Driver_Column_at,
                             ZEND_ACC_PUBLIC) ZEND_ME(ClickHouse_Driver_Column, toArray,
                                                      arginfo_class_ClickHouse_Driver_Column_toArray,
-                                                     ZEND_ACC_PUBLIC) ZEND_FE_END};
+                                                     ZEND_ACC_PUBLIC)
+                        ZEND_ME(ClickHouse_Driver_Column, toBinary,
+                                arginfo_class_ClickHouse_Driver_Column_toBinary, ZEND_ACC_PUBLIC)
+                        ZEND_ME(ClickHouse_Driver_Column, fromBinary,
+                                arginfo_class_ClickHouse_Driver_Column_fromBinary,
+                                ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
+                        ZEND_ME(ClickHouse_Driver_Column, bufferView,
+                                arginfo_class_ClickHouse_Driver_Column_bufferView, ZEND_ACC_PUBLIC)
+                        ZEND_ME(ClickHouse_Driver_Column, nullMapView,
+                                arginfo_class_ClickHouse_Driver_Column_nullMapView, ZEND_ACC_PUBLIC)
+                        ZEND_ME(ClickHouse_Driver_Column, sum,
+                                arginfo_class_ClickHouse_Driver_Column_sum, ZEND_ACC_PUBLIC)
+                        ZEND_ME(ClickHouse_Driver_Column, min,
+                                arginfo_class_ClickHouse_Driver_Column_min, ZEND_ACC_PUBLIC)
+                        ZEND_ME(ClickHouse_Driver_Column, max,
+                                arginfo_class_ClickHouse_Driver_Column_max, ZEND_ACC_PUBLIC)
+                        ZEND_ME(ClickHouse_Driver_Column, mean,
+                                arginfo_class_ClickHouse_Driver_Column_mean, ZEND_ACC_PUBLIC)
+                        ZEND_ME(ClickHouse_Driver_Column, countNonNull,
+                                arginfo_class_ClickHouse_Driver_Column_countNonNull,
+                                ZEND_ACC_PUBLIC)
+                        ZEND_ME(ClickHouse_Driver_Column, quantiles,
+                                arginfo_class_ClickHouse_Driver_Column_quantiles, ZEND_ACC_PUBLIC)
+                        ZEND_ME(ClickHouse_Driver_Column, slice,
+                                arginfo_class_ClickHouse_Driver_Column_slice, ZEND_ACC_PUBLIC)
+                        ZEND_ME(ClickHouse_Driver_Column, compare,
+                                arginfo_class_ClickHouse_Driver_Column_compare, ZEND_ACC_PUBLIC)
+                        ZEND_FE_END};
+
+static const zend_function_entry class_ClickHouse_Driver_ColumnBuffer_methods[] = {
+    ZEND_ME(ClickHouse_Driver_ColumnBuffer, getAddress,
+            arginfo_class_ClickHouse_Driver_ColumnBuffer_getAddress, ZEND_ACC_PUBLIC)
+        ZEND_ME(ClickHouse_Driver_ColumnBuffer, getCount,
+                arginfo_class_ClickHouse_Driver_ColumnBuffer_getCount, ZEND_ACC_PUBLIC)
+            ZEND_ME(ClickHouse_Driver_ColumnBuffer, getByteLength,
+                    arginfo_class_ClickHouse_Driver_ColumnBuffer_getByteLength, ZEND_ACC_PUBLIC)
+                ZEND_ME(ClickHouse_Driver_ColumnBuffer, getCType,
+                        arginfo_class_ClickHouse_Driver_ColumnBuffer_getCType, ZEND_ACC_PUBLIC)
+                    ZEND_FE_END};
 
 void php_clickhouse_register_column(int module_number)
 {
@@ -191,4 +666,19 @@ void php_clickhouse_register_column(int module_number)
     clickhouse_column_handlers.offset = XtOffsetOf(php_clickhouse_column, std);
     clickhouse_column_handlers.free_obj = php_clickhouse_column_free;
     clickhouse_column_handlers.clone_obj = nullptr;
+
+    INIT_NS_CLASS_ENTRY(ce, "ClickHouse\\Driver", "ColumnBuffer",
+                        class_ClickHouse_Driver_ColumnBuffer_methods);
+    clickhouse_ce_ColumnBuffer = zend_register_internal_class(&ce);
+    clickhouse_ce_ColumnBuffer->ce_flags |= ZEND_ACC_FINAL;
+    clickhouse_ce_ColumnBuffer->create_object = php_clickhouse_column_buffer_create;
+#if PHP_VERSION_ID >= 80300
+    clickhouse_ce_ColumnBuffer->default_object_handlers = &clickhouse_column_buffer_handlers;
+#endif
+
+    memcpy(&clickhouse_column_buffer_handlers, zend_get_std_object_handlers(),
+           sizeof(zend_object_handlers));
+    clickhouse_column_buffer_handlers.offset = XtOffsetOf(php_clickhouse_column_buffer, std);
+    clickhouse_column_buffer_handlers.free_obj = php_clickhouse_column_buffer_free;
+    clickhouse_column_buffer_handlers.clone_obj = nullptr;
 }
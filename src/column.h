@@ -23,6 +23,26 @@ static inline php_clickhouse_column *php_clickhouse_column_from_zval(zval *zv)
 
 #define Z_CLICKHOUSE_COLUMN_P(zv) php_clickhouse_column_from_obj(Z_OBJ_P(zv))
 
+/* ColumnBuffer: the values of a numeric column or a null map, read in place */
+struct php_clickhouse_column_buffer
+{
+    clickhouse::ColumnRef column; /* keeps `data` alive */
+    const void *data;
+    size_t count;
+    size_t width;
+    const char *ctype;
+    zend_object std;
+};
+
+static inline php_clickhouse_column_buffer *php_clickhouse_column_buffer_from_obj(zend_object *obj)
+{
+    return reinterpret_cast<php_clickhouse_column_buffer *>(
+        reinterpret_cast<char *>(obj) - XtOffsetOf(php_clickhouse_column_buffer, std));
+}
+
+#define Z_CLICKHOUSE_COLUMN_BUFFER_P(zv) php_clickhouse_column_buffer_from_obj(Z_OBJ_P(zv))
+
+/* Registers Column and ColumnBuffer */
 void php_clickhouse_register_column(int module_number);
 
 /* Create a PHP Column object wrapping an existing ColumnRef */
@@ -0,0 +1,381 @@
+#include "src/column_aggregate.h"
+#include "src/column_convert.h"
+
+#include "clickhouse/columns/decimal.h"
+#include "clickhouse/columns/nullable.h"
+#include "clickhouse/columns/numeric.h"
+#include "clickhouse/exceptions.h"
+#include "clickhouse/types/types.h"
+
+#include "absl/numeric/int128.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+using namespace clickhouse;
+
+namespace
+{
+
+/* Integers up to 32 bits would need over 2^31 rows to overflow an Int64 sum.
+ * 128-bit integers are summed in their own type, with an overflow check. */
+template <typename T>
+using sum_type = std::conditional_t<
+    std::is_floating_point_v<T>, double,
+    std::conditional_t<(sizeof(T) < 8), int64_t,
+                       std::conditional_t<std::is_same_v<T, UInt128>, UInt128, Int128>>>;
+
+template <typename T>
+struct reduction
+{
+    sum_type<T> sum = 0;
+    T min = std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity()
+                                                 : std::numeric_limits<T>::max();
+    T max = std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity()
+                                                 : std::numeric_limits<T>::lowest();
+    size_t count = 0;
+};
+
+/*
+ * Branch-free so that the compiler vectorizes the loops: a NULL adds zero
+ * and leaves min and max alone. NaN compares neither below nor above
+ * anything, so min and max skip it while the sum turns NaN.
+ */
+template <typename T>
+reduction<T> reduce(const T *values, const uint8_t *nulls, size_t n)
+{
+    reduction<T> r;
+    sum_type<T> sum = 0;
+    T lo = r.min;
+    T hi = r.max;
+
+    if (!nulls) {
+        for (size_t i = 0; i < n; ++i) {
+            T v = values[i];
+            sum += v;
+            lo = v < lo ? v : lo;
+            hi = v > hi ? v : hi;
+        }
+        r.count = n;
+    } else {
+        size_t count = 0;
+        for (size_t i = 0; i < n; ++i) {
+            bool valid = !nulls[i];
+            T v = values[i];
+            sum += valid ? v : T(0);
+            count += valid;
+            lo = valid && v < lo ? v : lo;
+            hi = valid && v > hi ? v : hi;
+        }
+        r.count = count;
+    }
+
+    r.sum = sum;
+    r.min = lo;
+    r.max = hi;
+    if constexpr (std::is_floating_point_v<T>) {
+        /* Only NaN: min and max stayed at the infinities they started from */
+        if (r.count > 0 && lo > hi) {
+            r.min = r.max = std::numeric_limits<T>::quiet_NaN();
+        }
+    }
+    return r;
+}
+
+/* For sums that can overflow their widest type: 128-bit integers, and
+ * decimals, which are read through At() as their storage width is private */
+template <typename T, typename Get>
+reduction<T> reduce_checked(size_t n, const uint8_t *nulls, Get get, const Column &col,
+                            const char *accumulator)
+{
+    static const T max = std::numeric_limits<T>::max();
+    static const T min = std::numeric_limits<T>::min();
+    reduction<T> r;
+
+    for (size_t i = 0; i < n; ++i) {
+        if (nulls && nulls[i]) {
+            continue;
+        }
+        T v = get(i);
+        if ((v > T(0) && r.sum > max - v) || (v < T(0) && r.sum < min - v)) {
+            throw ValidationError("Sum of column " + col.Type()->GetName() + " overflows " +
+                                  accumulator);
+        }
+        r.sum += v;
+        r.min = v < r.min ? v : r.min;
+        r.max = v > r.max ? v : r.max;
+        ++r.count;
+    }
+    return r;
+}
+
+void value_to_zval(double v, zval *rv)
+{
+    ZVAL_DOUBLE(rv, v);
+}
+
+void value_to_zval(Int128 v, zval *rv)
+{
+    if (v >= Int128(ZEND_LONG_MIN) && v <= Int128(ZEND_LONG_MAX)) {
+        ZVAL_LONG(rv, static_cast<zend_long>(v));
+        return;
+    }
+    /* Past PHP_INT_MAX: a numeric string, as for UInt64 values */
+    std::ostringstream text;
+    text << v;
+    std::string s = text.str();
+    ZVAL_STRINGL(rv, s.data(), s.size());
+}
+
+/* 128-bit integers are always strings, as at() returns them */
+template <typename T>
+void wide_to_zval(T v, zval *rv)
+{
+    std::ostringstream text;
+    text << v;
+    std::string s = text.str();
+    ZVAL_STRINGL(rv, s.data(), s.size());
+}
+
+template <typename T>
+void value_to_zval(T v, zval *rv)
+{
+    if constexpr (std::is_floating_point_v<T>) {
+        ZVAL_DOUBLE(rv, static_cast<double>(v));
+    } else {
+        value_to_zval(Int128(v), rv);
+    }
+}
+
+void decimal_to_zval(Int128 v, size_t scale, zval *rv)
+{
+    std::string text = php_clickhouse_decimal_text(v, scale);
+    ZVAL_STRINGL(rv, text.data(), text.size());
+}
+
+/* `col` without its Nullable wrapper; `nulls` is its null map or null */
+ColumnRef unwrap_nullable(const ColumnRef &col, const uint8_t *&nulls)
+{
+    nulls = nullptr;
+    if (auto nullable = col->As<ColumnNullable>()) {
+        nulls = nullable->Nulls()->As<ColumnUInt8>()->GetWritableData().data();
+        return nullable->Nested();
+    }
+    return col;
+}
+
+/* Calls fn(ColumnVector<T> &) for the numeric types up to 64 bits, false for others */
+template <typename F>
+bool visit_numeric(const ColumnRef &col, F &&fn)
+{
+    switch (col->Type()->GetCode()) {
+    case Type::Int8:
+        return fn(*col->As<ColumnVector<int8_t>>());
+    case Type::UInt8:
+        return fn(*col->As<ColumnVector<uint8_t>>());
+    case Type::Int16:
+        return fn(*col->As<ColumnVector<int16_t>>());
+    case Type::UInt16:
+        return fn(*col->As<ColumnVector<uint16_t>>());
+    case Type::Int32:
+        return fn(*col->As<ColumnVector<int32_t>>());
+    case Type::UInt32:
+        return fn(*col->As<ColumnVector<uint32_t>>());
+    case Type::Int64:
+        return fn(*col->As<ColumnVector<int64_t>>());
+    case Type::UInt64:
+        return fn(*col->As<ColumnVector<uint64_t>>());
+    case Type::Float32:
+        return fn(*col->As<ColumnVector<float>>());
+    case Type::Float64:
+        return fn(*col->As<ColumnVector<double>>());
+    default:
+        return false;
+    }
+}
+
+/* NaN is left out of quantiles, as ClickHouse does */
+template <typename T>
+bool is_nan(const T &v)
+{
+    if constexpr (std::is_floating_point_v<T>) {
+        return std::isnan(v);
+    }
+    return false;
+}
+
+template <typename T, typename Get, typename ToZval>
+void quantiles_of(size_t n, const uint8_t *nulls, Get get, const std::vector<double> &levels,
+                  ToZval to_zval, zval *rv)
+{
+    std::vector<T> values;
+    values.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        if (!(nulls && nulls[i])) {
+            T v = get(i);
+            if (!is_nan(v)) {
+                values.push_back(v);
+            }
+        }
+    }
+
+    array_init_size(rv, static_cast<uint32_t>(levels.size()));
+    for (double level : levels) {
+        zval value;
+        if (values.empty()) {
+            ZVAL_NULL(&value);
+        } else {
+            size_t k = std::min(static_cast<size_t>(level * static_cast<double>(values.size())),
+                                values.size() - 1);
+            std::nth_element(values.begin(), values.begin() + k, values.end());
+            to_zval(values[k], &value);
+        }
+        add_next_index_zval(rv, &value);
+    }
+}
+
+/* The value of `op` from a reduction; sum, min and max go through `to_zval`.
+ * `unit` is what one unit of the sum is worth (10^scale for decimals). */
+template <typename T, typename ToZval>
+void aggregate_result(const reduction<T> &r, php_clickhouse_aggregate op, double unit,
+                      ToZval to_zval, zval *rv)
+{
+    switch (op) {
+    case php_clickhouse_aggregate::sum:
+        to_zval(r.sum, rv);
+        break;
+    case php_clickhouse_aggregate::min:
+    case php_clickhouse_aggregate::max:
+        if (r.count == 0) {
+            ZVAL_NULL(rv);
+        } else {
+            to_zval(op == php_clickhouse_aggregate::min ? r.min : r.max, rv);
+        }
+        break;
+    case php_clickhouse_aggregate::mean:
+        if (r.count == 0) {
+            ZVAL_NULL(rv);
+        } else {
+            ZVAL_DOUBLE(rv, static_cast<double>(r.sum) / static_cast<double>(r.count) / unit);
+        }
+        break;
+    }
+}
+
+} // namespace
+
+bool php_clickhouse_column_aggregate(const ColumnRef &col, php_clickhouse_aggregate op,
+                                     zval *return_value)
+{
+    const uint8_t *nulls;
+    ColumnRef values = unwrap_nullable(col, nulls);
+    size_t n = values->Size();
+
+    if (auto decimal = values->As<ColumnDecimal>()) {
+        size_t scale = values->Type()->As<DecimalType>()->GetScale();
+        auto r = reduce_checked<Int128>(
+            n, nulls, [&](size_t i) { return decimal->At(i); }, *values, "Int128");
+        aggregate_result(
+            r, op, std::pow(10.0, static_cast<double>(scale)),
+            [scale](Int128 v, zval *rv) { decimal_to_zval(v, scale, rv); }, return_value);
+        return true;
+    }
+
+    switch (values->Type()->GetCode()) {
+    case Type::Int128: {
+        const auto &data = values->As<ColumnVector<Int128>>()->GetWritableData();
+        auto r = reduce_checked<Int128>(
+            n, nulls, [&](size_t i) { return data[i]; }, *values, "Int128");
+        aggregate_result(r, op, 1.0, wide_to_zval<Int128>, return_value);
+        return true;
+    }
+    case Type::UInt128: {
+        const auto &data = values->As<ColumnVector<UInt128>>()->GetWritableData();
+        auto r = reduce_checked<UInt128>(
+            n, nulls, [&](size_t i) { return data[i]; }, *values, "UInt128");
+        aggregate_result(r, op, 1.0, wide_to_zval<UInt128>, return_value);
+        return true;
+    }
+    default:
+        break;
+    }
+
+    return visit_numeric(values, [&](auto &typed) {
+        const auto &data = typed.GetWritableData();
+        auto r = reduce(data.data(), nulls, data.size());
+        aggregate_result(
+            r, op, 1.0, [](auto v, zval *rv) { value_to_zval(v, rv); }, return_value);
+        return true;
+    });
+}
+
+bool php_clickhouse_column_quantiles(const ColumnRef &col, const std::vector<double> &levels,
+                                     zval *return_value)
+{
+    const uint8_t *nulls;
+    ColumnRef values = unwrap_nullable(col, nulls);
+
+    if (auto decimal = values->As<ColumnDecimal>()) {
+        size_t scale = values->Type()->As<DecimalType>()->GetScale();
+        quantiles_of<Int128>(
+            values->Size(), nulls, [&](size_t i) { return decimal->At(i); }, levels,
+            [scale](Int128 v, zval *rv) { decimal_to_zval(v, scale, rv); }, return_value);
+        return true;
+    }
+
+    switch (values->Type()->GetCode()) {
+    case Type::Int128: {
+        const auto &data = values->As<ColumnVector<Int128>>()->GetWritableData();
+        quantiles_of<Int128>(
+            data.size(), nulls, [&](size_t i) { return data[i]; }, levels,
+            wide_to_zval<Int128>, return_value);
+        return true;
+    }
+    case Type::UInt128: {
+        const auto &data = values->As<ColumnVector<UInt128>>()->GetWritableData();
+        quantiles_of<UInt128>(
+            data.size(), nulls, [&](size_t i) { return data[i]; }, levels,
+            wide_to_zval<UInt128>, return_value);
+        return true;
+    }
+    default:
+        break;
+    }
+
+    return visit_numeric(values, [&](auto &typed) {
+        const auto &data = typed.GetWritableData();
+        using T = typename std::decay_t<decltype(data)>::value_type;
+        quantiles_of<T>(
+            data.size(), nulls, [&](size_t i) { return data[i]; }, levels,
+            [](T v, zval *rv) { value_to_zval(v, rv); }, return_value);
+        return true;
+    });
+}
+
+size_t php_clickhouse_column_count_non_null(const ColumnRef &col)
+{
+    if (auto nullable = col->As<ColumnNullable>()) {
+        const auto &nulls = nullable->Nulls()->As<ColumnUInt8>()->GetWritableData();
+        size_t count = 0;
+        for (uint8_t null : nulls) {
+            count += !null;
+        }
+        return count;
+    }
+
+    if (col->Type()->GetCode() == Type::LowCardinality) {
+        /* A NULL of LowCardinality(Nullable(T)) reads back as a Void item */
+        size_t count = 0;
+        for (size_t i = 0; i < col->Size(); ++i) {
+            count += col->GetItem(i).type != Type::Void;
+        }
+        return count;
+    }
+
+    return col->Size();
+}
@@ -0,0 +1,41 @@
+#ifndef PHP_CLICKHOUSE_COLUMN_AGGREGATE_H
+#define PHP_CLICKHOUSE_COLUMN_AGGREGATE_H
+
+#include "php_clickhouse.h"
+#include "clickhouse/columns/column.h"
+
+#include <vector>
+
+/* Reductions of Column::sum(), min(), max() and mean() */
+enum class php_clickhouse_aggregate
+{
+    sum,
+    min,
+    max,
+    mean,
+};
+
+/**
+ * One pass over an Int*, UInt*, Float* or Decimal column, or a Nullable of
+ * one, skipping NULLs. Integers are summed in a wider accumulator (Int64 up
+ * to 32-bit values, Int128 above), floats in double; Decimal sums that leave
+ * Int128 throw a ValidationError. Results take the form at() returns values
+ * in: integers as int or, past PHP_INT_MAX, a numeric string, Decimals as
+ * strings. min, max and mean of no values are null, a sum is 0.
+ * Returns false for other column types.
+ */
+bool php_clickhouse_column_aggregate(const clickhouse::ColumnRef &col, php_clickhouse_aggregate op,
+                                     zval *return_value);
+
+/**
+ * Exact quantiles of the same columns, as ClickHouse's quantileExact picks
+ * them: the value at index floor(level * n) of the n sorted non-NULL values.
+ * Fills a list with one value per level, null each when there are no values.
+ */
+bool php_clickhouse_column_quantiles(const clickhouse::ColumnRef &col,
+                                     const std::vector<double> &levels, zval *return_value);
+
+/* Rows that are not NULL, for any column type */
+size_t php_clickhouse_column_count_non_null(const clickhouse::ColumnRef &col);
+
+#endif
@@ -110,13 +110,8 @@ static void date_to_zval(const ColumnRef &col, size_t index, zval *rv)
 {
     /* ColumnDate stores days since epoch as uint16_t; convert to 'Y-m-d' */
     auto typed = col->As<ColumnDate>();
-    std::time_t t = typed->At(index);
-    struct tm tm_buf;
-    gmtime_r(&t, &tm_buf);
-    char buf[16];
-    int len = snprintf(buf, sizeof(buf), "%04d-%02d-%02d", tm_buf.tm_year + 1900, tm_buf.tm_mon + 1,
-                       tm_buf.tm_mday);
-    ZVAL_STRINGL(rv, buf, static_cast<size_t>(len));
+    char buf[PHP_CLICKHOUSE_VALUE_TEXT_MAX];
+    ZVAL_STRINGL(rv, buf, php_clickhouse_date_text(typed->At(index), buf));
 }
 
 static void datetime_to_zval(const ColumnRef &col, size_t index, zval *rv)
@@ -148,7 +143,30 @@ static void time64_to_zval(const ColumnRef &col, size_t index, zval *rv)
 
 static void datetime64_value_to_zval(int64_t val, size_t precision, zval *rv)
 {
+    char buf[PHP_CLICKHOUSE_VALUE_TEXT_MAX];
+    ZVAL_STRINGL(rv, buf, php_clickhouse_datetime64_text(val, precision, buf));
+}
 
+size_t php_clickhouse_date_text(std::time_t seconds, char *buf)
+{
+    struct tm tm_buf;
+    gmtime_r(&seconds, &tm_buf);
+    int len = snprintf(buf, PHP_CLICKHOUSE_VALUE_TEXT_MAX, "%04d-%02d-%02d", tm_buf.tm_year + 1900,
+                       tm_buf.tm_mon + 1, tm_buf.tm_mday);
+    return static_cast<size_t>(len);
+}
+
+std::time_t php_clickhouse_date_item(const ItemView &item)
+{
+    /* Date items are uint16_t and Date32 items int32_t days since the epoch */
+    if (item.type == Type::Date) {
+        return static_cast<std::time_t>(item.get<uint16_t>()) * 86400;
+    }
+    return static_cast<std::time_t>(item.get<int32_t>()) * 86400;
+}
+
+size_t php_clickhouse_datetime64_text(int64_t val, size_t precision, char *buf)
+{
     int64_t divisor = 1;
     for (size_t i = 0; i < precision; ++i)
         divisor *= 10;
@@ -164,23 +182,18 @@ static void datetime64_value_to_zval(int64_t val, size_t precision, zval *rv)
     time_t t = static_cast<time_t>(seconds);
     gmtime_r(&t, &tm_buf);
 
-    char buf[64];
-    int len = snprintf(buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d:%02d.%0*" PRId64,
-                       tm_buf.tm_year + 1900, tm_buf.tm_mon + 1, tm_buf.tm_mday, tm_buf.tm_hour,
-                       tm_buf.tm_min, tm_buf.tm_sec, static_cast<int>(precision), frac);
-    ZVAL_STRINGL(rv, buf, static_cast<size_t>(len));
+    int len = snprintf(buf, PHP_CLICKHOUSE_VALUE_TEXT_MAX,
+                       "%04d-%02d-%02d %02d:%02d:%02d.%0*" PRId64, tm_buf.tm_year + 1900,
+                       tm_buf.tm_mon + 1, tm_buf.tm_mday, tm_buf.tm_hour, tm_buf.tm_min,
+                       tm_buf.tm_sec, static_cast<int>(precision), frac);
+    return static_cast<size_t>(len);
 }
 
 static void date32_to_zval(const ColumnRef &col, size_t index, zval *rv)
 {
     auto typed = col->As<ColumnDate32>();
-    std::time_t t = typed->At(index);
-    struct tm tm_buf;
-    gmtime_r(&t, &tm_buf);
-    char buf[16];
-    int len = snprintf(buf, sizeof(buf), "%04d-%02d-%02d", tm_buf.tm_year + 1900, tm_buf.tm_mon + 1,
-                       tm_buf.tm_mday);
-    ZVAL_STRINGL(rv, buf, static_cast<size_t>(len));
+    char buf[PHP_CLICKHOUSE_VALUE_TEXT_MAX];
+    ZVAL_STRINGL(rv, buf, php_clickhouse_date_text(typed->At(index), buf));
 }
 
 static void nullable_to_zval(const ColumnRef &col, size_t index, zval *rv)
@@ -276,13 +289,17 @@ static void uuid_to_zval(const ColumnRef &col, size_t index, zval *rv)
 
 static void uuid_parts_to_zval(uint64_t hi, uint64_t lo, zval *rv)
 {
+    char buf[PHP_CLICKHOUSE_VALUE_TEXT_MAX];
+    ZVAL_STRINGL(rv, buf, php_clickhouse_uuid_text(hi, lo, buf));
+}
 
+size_t php_clickhouse_uuid_text(uint64_t hi, uint64_t lo, char *buf)
+{
     /* UUID is stored as two uint64_t values. Format as standard UUID string. */
-    char buf[37];
-    snprintf(buf, sizeof(buf), "%08x-%04x-%04x-%04x-%012" PRIx64, static_cast<uint32_t>(hi >> 32),
-             static_cast<uint16_t>(hi >> 16), static_cast<uint16_t>(hi),
-             static_cast<uint16_t>(lo >> 48), lo & 0x0000FFFFFFFFFFFF);
-    ZVAL_STRINGL(rv, buf, 36);
+    snprintf(buf, PHP_CLICKHOUSE_VALUE_TEXT_MAX, "%08x-%04x-%04x-%04x-%012" PRIx64,
+             static_cast<uint32_t>(hi >> 32), static_cast<uint16_t>(hi >> 16),
+             static_cast<uint16_t>(hi), static_cast<uint16_t>(lo >> 48), lo & 0x0000FFFFFFFFFFFF);
+    return 36;
 }
 
 static void ipv4_to_zval(const ColumnRef &col, size_t index, zval *rv)
@@ -321,13 +338,17 @@ static void decimal_to_zval(const ColumnRef &col, size_t index, zval *rv)
 }
 
 static void decimal_value_to_zval(Int128 raw, size_t scale, zval *rv)
+{
+    std::string str = php_clickhouse_decimal_text(raw, scale);
+    ZVAL_STRINGL(rv, str.c_str(), str.size());
+}
+
+std::string php_clickhouse_decimal_text(Int128 raw, size_t scale)
 {
     if (scale == 0) {
         std::ostringstream oss;
         oss << raw;
-        std::string str = oss.str();
-        ZVAL_STRINGL(rv, str.c_str(), str.size());
-        return;
+        return oss.str();
     }
 
     Int128 divisor = 1;
@@ -353,12 +374,10 @@ static void decimal_value_to_zval(Int128 raw, size_t scale, zval *rv)
     for (size_t i = frac_str.size(); i < scale; ++i)
         oss << '0';
     oss << frac_str;
-
-    std::string str = oss.str();
-    ZVAL_STRINGL(rv, str.c_str(), str.size());
+    return oss.str();
 }
 
-static Int128 decimal_item_to_int128(const ItemView &item)
+Int128 php_clickhouse_decimal_item(const ItemView &item)
 {
     switch (item.AsBinaryData().size()) {
     case sizeof(int32_t):
@@ -454,24 +473,10 @@ static void lowcardinality_to_zval(const ColumnRef &col, size_t index, zval *rv)
         ZVAL_BOOL(rv, item.get<uint8_t>() != 0);
         break;
 
-    case Type::Date: {
-        std::time_t t = static_cast<std::time_t>(item.get<uint16_t>()) * 86400;
-        struct tm tm_buf;
-        gmtime_r(&t, &tm_buf);
-        char buf[16];
-        int len = snprintf(buf, sizeof(buf), "%04d-%02d-%02d", tm_buf.tm_year + 1900,
-                           tm_buf.tm_mon + 1, tm_buf.tm_mday);
-        ZVAL_STRINGL(rv, buf, static_cast<size_t>(len));
-        break;
-    }
+    case Type::Date:
     case Type::Date32: {
-        std::time_t t = static_cast<std::time_t>(item.get<int32_t>()) * 86400;
-        struct tm tm_buf;
-        gmtime_r(&t, &tm_buf);
-        char buf[16];
-        int len = snprintf(buf, sizeof(buf), "%04d-%02d-%02d", tm_buf.tm_year + 1900,
-                           tm_buf.tm_mon + 1, tm_buf.tm_mday);
-        ZVAL_STRINGL(rv, buf, static_cast<size_t>(len));
+        char buf[PHP_CLICKHOUSE_VALUE_TEXT_MAX];
+        ZVAL_STRINGL(rv, buf, php_clickhouse_date_text(php_clickhouse_date_item(item), buf));
         break;
     }
     case Type::DateTime:
@@ -540,7 +545,7 @@ static void lowcardinality_to_zval(const ColumnRef &col, size_t index, zval *rv)
     case Type::Decimal32:
     case Type::Decimal64:
     case Type::Decimal128:
-        decimal_value_to_zval(decimal_item_to_int128(item),
+        decimal_value_to_zval(php_clickhouse_decimal_item(item),
                               value_type->As<DecimalType>()->GetScale(), rv);
         break;
 
@@ -802,3 +807,63 @@ void php_clickhouse_column_to_zval(const ColumnRef &col, size_t index, zval *ret
         break;
     }
 }
+
+/* zend_string header plus terminator, rounded to the allocator's 8-byte step */
+static size_t string_cost(size_t len)
+{
+    return (_ZSTR_HEADER_SIZE + len + 1 + 7) & ~static_cast<size_t>(7);
+}
+
+size_t php_clickhouse_value_cost(const TypeRef &type)
+{
+    switch (type->GetCode()) {
+    case Type::Int8:
+    case Type::Int16:
+    case Type::Int32:
+    case Type::Int64:
+    case Type::UInt8:
+    case Type::UInt16:
+    case Type::UInt32:
+    case Type::UInt64:
+    case Type::Float32:
+    case Type::Float64:
+    case Type::Bool:
+    case Type::DateTime:
+    case Type::Time:
+    case Type::Time64:
+        return 0;
+
+    case Type::FixedString:
+        return string_cost(type->As<FixedStringType>()->GetSize());
+    case Type::UUID:
+        return string_cost(36);
+    case Type::Date:
+    case Type::Date32:
+    case Type::IPv4:
+        return string_cost(15);
+    case Type::Int128:
+    case Type::UInt128:
+    case Type::IPv6:
+        return string_cost(39);
+
+    case Type::Nullable:
+        return php_clickhouse_value_cost(type->As<NullableType>()->GetNestedType());
+    case Type::LowCardinality:
+        return php_clickhouse_value_cost(type->As<LowCardinalityType>()->GetNestedType());
+
+    case Type::Array:
+    case Type::Tuple:
+    case Type::Map:
+    case Type::Point:
+    case Type::Ring:
+    case Type::Polygon:
+    case Type::MultiPolygon:
+        /* A packed zend_array with its first 8 slots; element sizes are unknown */
+        return 56 + 8 * sizeof(zval);
+
+    default:
+        /* String, JSON, decimals, enums and DateTime64 come back as
+         * strings of no fixed length */
+        return string_cost(24);
+    }
+}
@@ -3,6 +3,10 @@
 
 #include "php_clickhouse.h"
 #include "clickhouse/columns/column.h"
+#include "clickhouse/columns/itemview.h"
+
+#include <ctime>
+#include <string>
 
 /**
  * Convert a value at row `index` from a ClickHouse column to a PHP zval.
@@ -11,4 +15,29 @@
 void php_clickhouse_column_to_zval(const clickhouse::ColumnRef &col, size_t index,
                                    zval *return_value);
 
+/**
+ * Rough PHP heap bytes one converted value of `type` allocates beyond its
+ * zval: nothing for integers and floats, a short zend_string for values
+ * returned as strings, a small array for composite types. Used to size
+ * result blocks against blockMemoryBudget and memory_limit.
+ */
+size_t php_clickhouse_value_cost(const clickhouse::TypeRef &type);
+
+/* Buffer size for the *_text() helpers below */
+#define PHP_CLICKHOUSE_VALUE_TEXT_MAX 64
+
+/*
+ * Text of the values the read path returns as strings, shared with the
+ * text output formats. The *_text() helpers fill `buf` and return the length.
+ */
+size_t php_clickhouse_date_text(std::time_t seconds, char *buf);
+size_t php_clickhouse_datetime64_text(int64_t value, size_t precision, char *buf);
+size_t php_clickhouse_uuid_text(uint64_t hi, uint64_t lo, char *buf);
+std::string php_clickhouse_decimal_text(clickhouse::Int128 raw, size_t scale);
+
+/* Date or Date32 ItemView as seconds since the epoch */
+std::time_t php_clickhouse_date_item(const clickhouse::ItemView &item);
+/* Raw scaled integer of a Decimal ItemView of any width */
+clickhouse::Int128 php_clickhouse_decimal_item(const clickhouse::ItemView &item);
+
 #endif
@@ -0,0 +1,357 @@
+#include "src/column_filter.h"
+
+#include "clickhouse/columns/date.h"
+#include "clickhouse/columns/nullable.h"
+#include "clickhouse/columns/numeric.h"
+#include "clickhouse/columns/string.h"
+#include "clickhouse/types/types.h"
+
+#include <cstring>
+#include <ctime>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+using namespace clickhouse;
+
+namespace
+{
+
+/* out[i] = get(i) <op> value, one branch-free loop per operator */
+template <typename Get, typename V>
+void compare_rows(size_t n, Get get, php_clickhouse_compare_op op, const V &value, uint8_t *out)
+{
+    switch (op) {
+    case php_clickhouse_compare_op::eq:
+        for (size_t i = 0; i < n; ++i)
+            out[i] = get(i) == value;
+        break;
+    case php_clickhouse_compare_op::ne:
+        for (size_t i = 0; i < n; ++i)
+            out[i] = get(i) != value;
+        break;
+    case php_clickhouse_compare_op::lt:
+        for (size_t i = 0; i < n; ++i)
+            out[i] = get(i) < value;
+        break;
+    case php_clickhouse_compare_op::le:
+        for (size_t i = 0; i < n; ++i)
+            out[i] = get(i) <= value;
+        break;
+    case php_clickhouse_compare_op::gt:
+        for (size_t i = 0; i < n; ++i)
+            out[i] = get(i) > value;
+        break;
+    case php_clickhouse_compare_op::ge:
+        for (size_t i = 0; i < n; ++i)
+            out[i] = get(i) >= value;
+        break;
+    }
+}
+
+/* The result when every value lies above (or below) what it is compared with */
+void compare_constant(size_t n, php_clickhouse_compare_op op, bool above, uint8_t *out)
+{
+    bool result = false;
+    switch (op) {
+    case php_clickhouse_compare_op::eq:
+        result = false;
+        break;
+    case php_clickhouse_compare_op::ne:
+        result = true;
+        break;
+    case php_clickhouse_compare_op::lt:
+    case php_clickhouse_compare_op::le:
+        result = !above;
+        break;
+    case php_clickhouse_compare_op::gt:
+    case php_clickhouse_compare_op::ge:
+        result = above;
+        break;
+    }
+    memset(out, result ? 1 : 0, n);
+}
+
+/*
+ * Integers compare with an int in their own type, after ruling out values
+ * outside it; a float compares as double.
+ */
+template <typename T, typename Get>
+bool compare_integer(size_t n, Get get, php_clickhouse_compare_op op, zval *value, uint8_t *out)
+{
+    if (Z_TYPE_P(value) == IS_DOUBLE) {
+        compare_rows(
+            n, [&](size_t i) { return static_cast<double>(get(i)); }, op, Z_DVAL_P(value), out);
+        return true;
+    }
+    if (Z_TYPE_P(value) != IS_LONG) {
+        return false;
+    }
+
+    zend_long scalar = Z_LVAL_P(value);
+    if constexpr (std::is_unsigned_v<T>) {
+        if (scalar < 0) {
+            compare_constant(n, op, true, out);
+            return true;
+        }
+        if (static_cast<uint64_t>(scalar) > std::numeric_limits<T>::max()) {
+            compare_constant(n, op, false, out);
+            return true;
+        }
+    } else {
+        if (scalar < static_cast<zend_long>(std::numeric_limits<T>::min())) {
+            compare_constant(n, op, true, out);
+            return true;
+        }
+        if (scalar > static_cast<zend_long>(std::numeric_limits<T>::max())) {
+            compare_constant(n, op, false, out);
+            return true;
+        }
+    }
+    compare_rows(n, get, op, static_cast<T>(scalar), out);
+    return true;
+}
+
+template <typename T>
+bool compare_vector(const ColumnRef &col, php_clickhouse_compare_op op, zval *value, uint8_t *out)
+{
+    const auto &data = col->As<ColumnVector<T>>()->GetWritableData();
+    auto get = [&data](size_t i) { return data[i]; };
+
+    if constexpr (std::is_floating_point_v<T>) {
+        double scalar;
+        if (Z_TYPE_P(value) == IS_DOUBLE) {
+            scalar = Z_DVAL_P(value);
+        } else if (Z_TYPE_P(value) == IS_LONG) {
+            scalar = static_cast<double>(Z_LVAL_P(value));
+        } else {
+            return false;
+        }
+        compare_rows(
+            data.size(), [&data](size_t i) { return static_cast<double>(data[i]); }, op, scalar,
+            out);
+        return true;
+    } else {
+        return compare_integer<T>(data.size(), get, op, value, out);
+    }
+}
+
+template <typename T>
+ColumnRef take_vector(const ColumnRef &col, const std::vector<size_t> &rows)
+{
+    const auto &in = col->As<ColumnVector<T>>()->GetWritableData();
+    ColumnRef out = col->CloneEmpty();
+    auto &data = out->As<ColumnVector<T>>()->GetWritableData();
+    data.resize(rows.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+        data[i] = in[rows[i]];
+    }
+    return out;
+}
+
+ColumnRef take_string(const ColumnRef &col, const std::vector<size_t> &rows)
+{
+    auto in = col->As<ColumnString>();
+    ColumnRef out = col->CloneEmpty();
+    auto strings = out->As<ColumnString>();
+    strings->Reserve(rows.size());
+    for (size_t row : rows) {
+        strings->Append(in->At(row));
+    }
+    return out;
+}
+
+/* Any other type: Append() a Slice() per run of consecutive rows */
+ColumnRef take_slices(const ColumnRef &col, const std::vector<size_t> &rows)
+{
+    ColumnRef out = col->CloneEmpty();
+    for (size_t i = 0; i < rows.size();) {
+        size_t len = 1;
+        while (i + len < rows.size() && rows[i + len] == rows[i] + len) {
+            ++len;
+        }
+        out->Append(col->Slice(rows[i], len));
+        i += len;
+    }
+    return out;
+}
+
+} // namespace
+
+bool php_clickhouse_compare_op_parse(const char *op, size_t len, php_clickhouse_compare_op &out)
+{
+    std::string_view name(op, len);
+    if (name == "=" || name == "==") {
+        out = php_clickhouse_compare_op::eq;
+    } else if (name == "!=" || name == "<>") {
+        out = php_clickhouse_compare_op::ne;
+    } else if (name == "<") {
+        out = php_clickhouse_compare_op::lt;
+    } else if (name == "<=") {
+        out = php_clickhouse_compare_op::le;
+    } else if (name == ">") {
+        out = php_clickhouse_compare_op::gt;
+    } else if (name == ">=") {
+        out = php_clickhouse_compare_op::ge;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+ColumnRef php_clickhouse_column_compare(const ColumnRef &col, php_clickhouse_compare_op op,
+                                        zval *value)
+{
+    if (auto nullable = col->As<ColumnNullable>()) {
+        ColumnRef mask = php_clickhouse_column_compare(nullable->Nested(), op, value);
+        if (!mask) {
+            return nullptr;
+        }
+        auto &bits = mask->As<ColumnUInt8>()->GetWritableData();
+        const auto &nulls = nullable->Nulls()->As<ColumnUInt8>()->GetWritableData();
+        for (size_t i = 0; i < bits.size(); ++i) {
+            bits[i] &= static_cast<uint8_t>(!nulls[i]);
+        }
+        return mask;
+    }
+
+    auto mask = std::make_shared<ColumnUInt8>();
+    auto &out = mask->GetWritableData();
+    size_t n = col->Size();
+    out.resize(n);
+
+    bool ok = false;
+    switch (col->Type()->GetCode()) {
+    case Type::Int8:
+        ok = compare_vector<int8_t>(col, op, value, out.data());
+        break;
+    case Type::UInt8:
+        ok = compare_vector<uint8_t>(col, op, value, out.data());
+        break;
+    case Type::Int16:
+        ok = compare_vector<int16_t>(col, op, value, out.data());
+        break;
+    case Type::UInt16:
+        ok = compare_vector<uint16_t>(col, op, value, out.data());
+        break;
+    case Type::Int32:
+        ok = compare_vector<int32_t>(col, op, value, out.data());
+        break;
+    case Type::UInt32:
+        ok = compare_vector<uint32_t>(col, op, value, out.data());
+        break;
+    case Type::Int64:
+        ok = compare_vector<int64_t>(col, op, value, out.data());
+        break;
+    case Type::UInt64:
+        ok = compare_vector<uint64_t>(col, op, value, out.data());
+        break;
+    case Type::Float32:
+        ok = compare_vector<float>(col, op, value, out.data());
+        break;
+    case Type::Float64:
+        ok = compare_vector<double>(col, op, value, out.data());
+        break;
+    case Type::DateTime: {
+        auto typed = col->As<ColumnDateTime>();
+        ok = compare_integer<std::time_t>(
+            n, [&typed](size_t i) { return typed->At(i); }, op, value, out.data());
+        break;
+    }
+    case Type::String:
+        if (Z_TYPE_P(value) == IS_STRING) {
+            auto typed = col->As<ColumnString>();
+            std::string_view scalar(Z_STRVAL_P(value), Z_STRLEN_P(value));
+            compare_rows(
+                n, [&typed](size_t i) { return typed->At(i); }, op, scalar, out.data());
+            ok = true;
+        }
+        break;
+    case Type::FixedString:
+        if (Z_TYPE_P(value) == IS_STRING) {
+            /* Stored values are zero-padded to the fixed size, so the operand is as well */
+            auto typed = col->As<ColumnFixedString>();
+            std::string scalar(Z_STRVAL_P(value), Z_STRLEN_P(value));
+            if (scalar.size() < typed->FixedSize()) {
+                scalar.resize(typed->FixedSize(), '\0');
+            }
+            compare_rows(
+                n, [&typed](size_t i) { return typed->At(i); }, op, std::string_view(scalar),
+                out.data());
+            ok = true;
+        }
+        break;
+    default:
+        break;
+    }
+    return ok ? mask : nullptr;
+}
+
+ColumnRef php_clickhouse_column_take(const ColumnRef &col, const std::vector<size_t> &rows)
+{
+    if (auto nullable = col->As<ColumnNullable>()) {
+        ColumnRef nested = php_clickhouse_column_take(nullable->Nested(), rows);
+        ColumnRef nulls = php_clickhouse_column_take(nullable->Nulls(), rows);
+        return std::make_shared<ColumnNullable>(nested, nulls);
+    }
+
+    switch (col->Type()->GetCode()) {
+    case Type::Int8:
+        return take_vector<int8_t>(col, rows);
+    case Type::UInt8:
+        return take_vector<uint8_t>(col, rows);
+    case Type::Int16:
+        return take_vector<int16_t>(col, rows);
+    case Type::UInt16:
+        return take_vector<uint16_t>(col, rows);
+    case Type::Int32:
+        return take_vector<int32_t>(col, rows);
+    case Type::UInt32:
+        return take_vector<uint32_t>(col, rows);
+    case Type::Int64:
+        return take_vector<int64_t>(col, rows);
+    case Type::UInt64:
+        return take_vector<uint64_t>(col, rows);
+    case Type::Float32:
+        return take_vector<float>(col, rows);
+    case Type::Float64:
+        return take_vector<double>(col, rows);
+    case Type::String:
+        return take_string(col, rows);
+    default:
+        return take_slices(col, rows);
+    }
+}
+
+bool php_clickhouse_slice_range(zend_long offset, zend_long length, bool length_is_null,
+                                size_t size, size_t &begin, size_t &len)
+{
+    if (offset < 0 || static_cast<size_t>(offset) > size || (!length_is_null && length < 0)) {
+        return false;
+    }
+    begin = static_cast<size_t>(offset);
+    len = size - begin;
+    if (!length_is_null && static_cast<size_t>(length) < len) {
+        len = static_cast<size_t>(length);
+    }
+    return true;
+}
+
+Block php_clickhouse_block_take(const Block &block, const std::vector<size_t> &rows)
+{
+    Block out(block.GetColumnCount(), rows.size());
+    for (size_t c = 0; c < block.GetColumnCount(); ++c) {
+        out.AppendColumn(block.GetColumnName(c), php_clickhouse_column_take(block[c], rows));
+    }
+    return out;
+}
+
+Block php_clickhouse_block_slice(const Block &block, size_t begin, size_t len)
+{
+    Block out(block.GetColumnCount(), len);
+    for (size_t c = 0; c < block.GetColumnCount(); ++c) {
+        out.AppendColumn(block.GetColumnName(c), block[c]->Slice(begin, len));
+    }
+    return out;
+}
@@ -0,0 +1,58 @@
+#ifndef PHP_CLICKHOUSE_COLUMN_FILTER_H
+#define PHP_CLICKHOUSE_COLUMN_FILTER_H
+
+#include "php_clickhouse.h"
+#include "clickhouse/block.h"
+#include "clickhouse/columns/column.h"
+
+#include <vector>
+
+/* Operators of Column::compare() */
+enum class php_clickhouse_compare_op
+{
+    eq,
+    ne,
+    lt,
+    le,
+    gt,
+    ge,
+};
+
+/* Accepts =, ==, !=, <>, <, <=, > and >= */
+bool php_clickhouse_compare_op_parse(const char *op, size_t len, php_clickhouse_compare_op &out);
+
+/**
+ * A UInt8 mask with 1 where `col` compares true with `value`. Int*, UInt*,
+ * Float* and DateTime columns take an int or float, String and FixedString
+ * columns a string; NULL rows of Nullable columns are 0, as in a WHERE.
+ * Integer columns compare in their own type so that UInt64 and Int64 values
+ * stay exact. Returns nullptr for other combinations.
+ */
+clickhouse::ColumnRef php_clickhouse_column_compare(const clickhouse::ColumnRef &col,
+                                                    php_clickhouse_compare_op op, zval *value);
+
+/**
+ * Rows `rows` of `col`, in that order and with repeats, as a new column of
+ * the same type. Numeric, String and Nullable columns are gathered value by
+ * value; other types are copied as Slice()s of consecutive rows.
+ */
+clickhouse::ColumnRef php_clickhouse_column_take(const clickhouse::ColumnRef &col,
+                                                 const std::vector<size_t> &rows);
+
+/*
+ * Rows [begin, begin + len) of `size` for slice($offset, $length): a null
+ * length runs to the end and a longer one is cut there. False when the
+ * offset lies outside [0, size] or the length is negative.
+ */
+bool php_clickhouse_slice_range(zend_long offset, zend_long length, bool length_is_null,
+                                size_t size, size_t &begin, size_t &len);
+
+/* php_clickhouse_column_take() over every column of `block` */
+clickhouse::Block php_clickhouse_block_take(const clickhouse::Block &block,
+                                            const std::vector<size_t> &rows);
+
+/* Rows [begin, begin + len) of every column of `block`, as copies */
+clickhouse::Block php_clickhouse_block_slice(const clickhouse::Block &block, size_t begin,
+                                             size_t len);
+
+#endif
@@ -5,10 +5,25 @@
 
 #include <memory>
 #include <new>
+#include <stdexcept>
 #include <system_error>
 
 #include "clickhouse/exceptions.h"
 
+/* Raised by the driver when a per-call timeoutMs deadline expires */
+class php_clickhouse_timeout_error : public std::runtime_error
+{
+  public:
+    using std::runtime_error::runtime_error;
+};
+
+/* Raised by the driver when a result would cross memoryLimitFraction */
+class php_clickhouse_memory_error : public std::runtime_error
+{
+  public:
+    using std::runtime_error::runtime_error;
+};
+
 void php_clickhouse_throw_server_exception(const clickhouse::ServerException &e);
 void php_clickhouse_throw_exception(const char *message, zend_class_entry *ce);
 
@@ -41,6 +56,16 @@ void php_clickhouse_throw_exception(const char *message, zend_class_entry *ce);
         php_clickhouse_throw_exception(e.what(), clickhouse_ce_ConnectionException);               \
         return;                                                                                    \
     }                                                                                              \
+    catch (const php_clickhouse_timeout_error &e)                                                  \
+    {                                                                                              \
+        php_clickhouse_throw_exception(e.what(), clickhouse_ce_QueryTimeoutException);             \
+        return;                                                                                    \
+    }                                                                                              \
+    catch (const php_clickhouse_memory_error &e)                                                   \
+    {                                                                                              \
+        php_clickhouse_throw_exception(e.what(), clickhouse_ce_MemoryLimitException);              \
+        return;                                                                                    \
+    }                                                                                              \
     catch (const std::exception &e)                                                                \
     {                                                                                              \
         php_clickhouse_throw_exception(e.what(), clickhouse_ce_ClickHouseException);               \
@@ -75,6 +100,16 @@ void php_clickhouse_throw_exception(const char *message, zend_class_entry *ce);
         php_clickhouse_throw_exception(e.what(), clickhouse_ce_ConnectionException);               \
         return;                                                                                    \
     }                                                                                              \
+    catch (const php_clickhouse_timeout_error &e)                                                  \
+    {                                                                                              \
+        php_clickhouse_throw_exception(e.what(), clickhouse_ce_QueryTimeoutException);             \
+        return;                                                                                    \
+    }                                                                                              \
+    catch (const php_clickhouse_memory_error &e)                                                   \
+    {                                                                                              \
+        php_clickhouse_throw_exception(e.what(), clickhouse_ce_MemoryLimitException);              \
+        return;                                                                                    \
+    }                                                                                              \
     catch (const std::exception &e)                                                                \
     {                                                                                              \
         php_clickhouse_throw_exception(e.what(), clickhouse_ce_ClickHouseException);               \
@@ -0,0 +1,265 @@
+#include "src/dns_cache.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include <dlfcn.h>
+#include <netdb.h>
+#include <unistd.h>
+
+using steady_clock = std::chrono::steady_clock;
+
+/* How long MSHUTDOWN waits for the refresher to leave getaddrinfo() */
+#define DNS_SHUTDOWN_WAIT std::chrono::milliseconds(500)
+
+struct dns_entry
+{
+    std::vector<php_clickhouse_resolved_address> addresses;
+    int error = 0;
+    steady_clock::time_point expires;
+    php_clickhouse_dns_policy policy;
+    bool refreshing = false;
+};
+
+struct dns_refresh_job
+{
+    std::string host;
+    uint16_t port;
+};
+
+static std::mutex dns_lock;
+static std::unordered_map<std::string, dns_entry> dns_entries;
+static std::atomic<uint64_t> dns_lookups{0};
+static std::atomic<uint64_t> dns_hits{0};
+
+/* Refresher state. The thread is heap-allocated so a handle inherited across
+ * fork() (FPM workers) can simply be forgotten, and so static destruction at
+ * exit never sees a joinable std::thread. */
+static std::condition_variable dns_wakeup;
+static std::deque<dns_refresh_job> dns_jobs;
+static std::thread *dns_refresher = nullptr;
+static pid_t dns_refresher_pid = 0;
+static bool dns_stopping = false;
+/* Set by the refresher as it returns, under dns_lock */
+static bool dns_refresher_done = false;
+static std::condition_variable dns_exited;
+
+static std::string dns_key(const std::string &host, uint16_t port)
+{
+    return host + ':' + std::to_string(port);
+}
+
+static int dns_lookup(const std::string &host, uint16_t port,
+                      std::vector<php_clickhouse_resolved_address> &out)
+{
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_ADDRCONFIG;
+
+    dns_lookups++;
+    addrinfo *res = nullptr;
+    std::string service = std::to_string(port);
+    int rc = ::getaddrinfo(host.c_str(), service.c_str(), &hints, &res);
+    if (rc != 0) {
+        return rc;
+    }
+
+    for (addrinfo *ai = res; ai; ai = ai->ai_next) {
+        if (ai->ai_addrlen > sizeof(sockaddr_storage)) {
+            continue;
+        }
+        php_clickhouse_resolved_address a{};
+        memcpy(&a.addr, ai->ai_addr, ai->ai_addrlen);
+        a.addr_len = static_cast<socklen_t>(ai->ai_addrlen);
+        a.family = ai->ai_family;
+        out.push_back(a);
+    }
+    ::freeaddrinfo(res);
+    return out.empty() ? EAI_NONAME : 0;
+}
+
+/* Store a lookup result; a failed refresh keeps the last good addresses. Caller holds dns_lock. */
+static void dns_store(const std::string &key, const php_clickhouse_dns_policy &policy, int rc,
+                      std::vector<php_clickhouse_resolved_address> &&addresses)
+{
+    auto now = steady_clock::now();
+    dns_entry &entry = dns_entries[key];
+    entry.refreshing = false;
+    entry.policy = policy;
+
+    if (rc == 0) {
+        entry.addresses = std::move(addresses);
+        entry.error = 0;
+        entry.expires = now + policy.ttl;
+    } else if (!entry.addresses.empty()) {
+        entry.expires = now + policy.negative_ttl;
+    } else {
+        entry.error = rc;
+        entry.expires = now + policy.negative_ttl;
+    }
+}
+
+static void dns_refresh_loop()
+{
+    std::unique_lock<std::mutex> guard(dns_lock);
+    while (true) {
+        dns_wakeup.wait(guard, [] { return dns_stopping || !dns_jobs.empty(); });
+        if (dns_stopping) {
+            dns_refresher_done = true;
+            dns_exited.notify_all();
+            return;
+        }
+
+        dns_refresh_job job = std::move(dns_jobs.front());
+        dns_jobs.pop_front();
+        std::string key = dns_key(job.host, job.port);
+        auto it = dns_entries.find(key);
+        if (it == dns_entries.end()) {
+            continue;
+        }
+        php_clickhouse_dns_policy policy = it->second.policy;
+
+        guard.unlock();
+        std::vector<php_clickhouse_resolved_address> addresses;
+        int rc = dns_lookup(job.host, job.port, addresses);
+        guard.lock();
+
+        if (!dns_stopping) {
+            dns_store(key, policy, rc, std::move(addresses));
+        }
+    }
+}
+
+/* Caller holds dns_lock */
+static void dns_schedule_refresh(const std::string &host, uint16_t port, dns_entry &entry)
+{
+    if (entry.refreshing) {
+        return;
+    }
+
+    pid_t pid = getpid();
+    if (!dns_refresher || dns_refresher_pid != pid) {
+        /* A handle inherited across fork refers to a thread that does not exist here */
+        dns_refresher = nullptr;
+        dns_jobs.clear();
+        dns_stopping = false;
+        dns_refresher_done = false;
+        try {
+            dns_refresher = new std::thread(dns_refresh_loop);
+        } catch (const std::exception &) {
+            return; /* no thread: the entry is refreshed synchronously once it expires */
+        }
+        dns_refresher_pid = pid;
+    }
+
+    entry.refreshing = true;
+    dns_jobs.push_back({host, port});
+    dns_wakeup.notify_one();
+}
+
+int php_clickhouse_dns_resolve(const std::string &host, uint16_t port,
+                               const php_clickhouse_dns_policy &policy,
+                               std::vector<php_clickhouse_resolved_address> &out)
+{
+    if (policy.ttl.count() <= 0) {
+        return dns_lookup(host, port, out);
+    }
+
+    std::string key = dns_key(host, port);
+    {
+        std::lock_guard<std::mutex> guard(dns_lock);
+        auto it = dns_entries.find(key);
+        if (it != dns_entries.end()) {
+            dns_entry &entry = it->second;
+            bool fresh = steady_clock::now() < entry.expires;
+            if (!entry.addresses.empty()) {
+                if (!fresh) {
+                    /* Serve stale, refresh off the request path */
+                    dns_schedule_refresh(host, port, entry);
+                }
+                out.insert(out.end(), entry.addresses.begin(), entry.addresses.end());
+                dns_hits++;
+                return 0;
+            }
+            if (fresh) {
+                dns_hits++;
+                return entry.error;
+            }
+        }
+    }
+
+    std::vector<php_clickhouse_resolved_address> addresses;
+    int rc = dns_lookup(host, port, addresses);
+
+    std::lock_guard<std::mutex> guard(dns_lock);
+    if (rc == 0) {
+        out.insert(out.end(), addresses.begin(), addresses.end());
+    }
+    if (rc == 0 || policy.negative_ttl.count() > 0) {
+        dns_store(key, policy, rc, std::move(addresses));
+    }
+    return rc;
+}
+
+void php_clickhouse_dns_invalidate(const std::string &host, uint16_t port)
+{
+    std::lock_guard<std::mutex> guard(dns_lock);
+    dns_entries.erase(dns_key(host, port));
+}
+
+void php_clickhouse_dns_cache_get_stats(php_clickhouse_dns_stats &stats)
+{
+    std::lock_guard<std::mutex> guard(dns_lock);
+    stats.entries = dns_entries.size();
+    stats.lookups = dns_lookups.load();
+    stats.hits = dns_hits.load();
+}
+
+/* Keep this shared object mapped after the engine unloads it, for a thread
+ * that is still running code in it */
+static void dns_pin_module()
+{
+    Dl_info info;
+    if (dladdr(reinterpret_cast<void *>(&dns_refresh_loop), &info) && info.dli_fname) {
+        /* Takes a reference that is never dropped */
+        dlopen(info.dli_fname, RTLD_NOW | RTLD_NOLOAD | RTLD_NODELETE);
+    }
+}
+
+void php_clickhouse_dns_cache_shutdown()
+{
+    std::unique_lock<std::mutex> guard(dns_lock);
+    dns_stopping = true;
+    dns_jobs.clear();
+    std::thread *refresher = nullptr;
+    if (dns_refresher && dns_refresher_pid == getpid()) {
+        refresher = dns_refresher;
+    }
+    dns_refresher = nullptr;
+    dns_refresher_pid = 0;
+    dns_entries.clear();
+    dns_wakeup.notify_all();
+    if (!refresher) {
+        return;
+    }
+
+    /* getaddrinfo() cannot be interrupted and may take as long as the
+     * resolver's timeouts; rather than hang shutdown on it, let the thread
+     * finish alone. It sees dns_stopping and returns without touching the
+     * cache. */
+    bool exited = dns_exited.wait_for(guard, DNS_SHUTDOWN_WAIT, [] { return dns_refresher_done; });
+    guard.unlock();
+    if (exited) {
+        refresher->join();
+    } else {
+        dns_pin_module();
+        refresher->detach();
+    }
+    delete refresher;
+}
@@ -0,0 +1,55 @@
+#ifndef PHP_CLICKHOUSE_DNS_CACHE_H
+#define PHP_CLICKHOUSE_DNS_CACHE_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+
+struct php_clickhouse_resolved_address
+{
+    sockaddr_storage addr;
+    socklen_t addr_len;
+    int family;
+};
+
+struct php_clickhouse_dns_policy
+{
+    /* Positive answers are served fresh for `ttl`; 0 bypasses the cache */
+    std::chrono::seconds ttl{0};
+    /* Failed lookups are remembered for `negative_ttl` */
+    std::chrono::seconds negative_ttl{0};
+};
+
+/* Counters since MINIT, shown by phpinfo() */
+struct php_clickhouse_dns_stats
+{
+    size_t entries;
+    /* getaddrinfo() calls made, on the request path or by the refresher */
+    uint64_t lookups;
+    /* Answers served from the cache, fresh or stale */
+    uint64_t hits;
+};
+
+/**
+ * Resolve host:port through the process-wide cache. Stale entries are still
+ * returned while a background thread refreshes them, so only the very first
+ * lookup of a name pays the resolver round trip on the request path.
+ * Returns 0 or a getaddrinfo() error code.
+ */
+int php_clickhouse_dns_resolve(const std::string &host, uint16_t port,
+                               const php_clickhouse_dns_policy &policy,
+                               std::vector<php_clickhouse_resolved_address> &out);
+
+/* Drop the entry for host:port, e.g. after none of its addresses accepted a connection */
+void php_clickhouse_dns_invalidate(const std::string &host, uint16_t port);
+
+void php_clickhouse_dns_cache_get_stats(php_clickhouse_dns_stats &stats);
+
+/* Stop the refresh thread and drop every entry (MSHUTDOWN). Waits briefly
+ * for a refresh stuck in getaddrinfo(), then leaves the thread behind. */
+void php_clickhouse_dns_cache_shutdown();
+
+#endif
@@ -12,6 +12,8 @@ zend_class_entry *clickhouse_ce_ConnectionException = nullptr;
 zend_class_entry *clickhouse_ce_ServerException = nullptr;
 zend_class_entry *clickhouse_ce_ProtocolException = nullptr;
 zend_class_entry *clickhouse_ce_ValidationException = nullptr;
+zend_class_entry *clickhouse_ce_QueryTimeoutException = nullptr;
+zend_class_entry *clickhouse_ce_MemoryLimitException = nullptr;
 
 ZEND_METHOD(ClickHouse_Driver_Exception_ServerException, getClickHouseCode)
 {
@@ -58,6 +60,16 @@ void php_clickhouse_register_exceptions(int module_number)
     clickhouse_ce_ProtocolException =
         zend_register_internal_class_ex(&ce, clickhouse_ce_ClickHouseException);
 
+    /* QueryTimeoutException extends ClickHouseException */
+    INIT_NS_CLASS_ENTRY(ce, "ClickHouse\\Driver\\Exception", "QueryTimeoutException", NULL);
+    clickhouse_ce_QueryTimeoutException =
+        zend_register_internal_class_ex(&ce, clickhouse_ce_ClickHouseException);
+
+    /* MemoryLimitException extends ClickHouseException */
+    INIT_NS_CLASS_ENTRY(ce, "ClickHouse\\Driver\\Exception", "MemoryLimitException", NULL);
+    clickhouse_ce_MemoryLimitException =
+        zend_register_internal_class_ex(&ce, clickhouse_ce_ClickHouseException);
+
     /* ValidationException extends \InvalidArgumentException */
     INIT_NS_CLASS_ENTRY(ce, "ClickHouse\\Driver\\Exception", "ValidationException", NULL);
     clickhouse_ce_ValidationException =
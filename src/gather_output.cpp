@@ -0,0 +1,248 @@
+#include "src/gather_output.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/errqueue.h>
+#endif
+
+#if defined(__linux__) && defined(MSG_ZEROCOPY) && defined(SO_ZEROCOPY)
+#define PHP_CLICKHOUSE_HAVE_ZERO_COPY 1
+#endif
+
+#if defined(MSG_NOSIGNAL)
+#define GATHER_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define GATHER_SEND_FLAGS 0
+#endif
+
+#if defined(IOV_MAX)
+#define GATHER_IOV_MAX IOV_MAX
+#else
+#define GATHER_IOV_MAX 1024
+#endif
+
+using namespace clickhouse;
+
+bool php_clickhouse_zero_copy_enable(int fd)
+{
+#ifdef PHP_CLICKHOUSE_HAVE_ZERO_COPY
+    int one = 1;
+    return ::setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0;
+#else
+    (void)fd;
+    return false;
+#endif
+}
+
+class gather_output : public OutputStream
+{
+  public:
+    gather_output(int fd, bool zero_copy, size_t zero_copy_threshold,
+                  std::chrono::milliseconds send_timeout)
+        : fd_(fd), zero_copy_(zero_copy),
+          threshold_(std::max<size_t>(zero_copy_threshold, PHP_CLICKHOUSE_GATHER_COPY_MAX + 1)),
+          send_timeout_(send_timeout)
+    {
+    }
+
+  protected:
+    size_t DoWrite(const void *data, size_t len) override
+    {
+        if (len > PHP_CLICKHOUSE_GATHER_COPY_MAX) {
+            segments_.push_back({static_cast<const char *>(data), 0, len});
+            return len;
+        }
+        /* Staged bytes are addressed by offset: the buffer may still move */
+        if (segments_.empty() || segments_.back().data) {
+            segments_.push_back({nullptr, staging_.size(), 0});
+        }
+        staging_.insert(staging_.end(), static_cast<const char *>(data),
+                        static_cast<const char *>(data) + len);
+        segments_.back().len += len;
+        return len;
+    }
+
+    void DoFlush() override
+    {
+        if (segments_.empty()) {
+            return;
+        }
+
+        size_t total = 0;
+        std::vector<iovec> plain;
+        auto send_plain = [&]() {
+            if (!plain.empty()) {
+                send_all(plain, 0, total);
+                plain.clear();
+            }
+        };
+        for (const segment &s : segments_) {
+            const char *base = s.data ? s.data : staging_.data() + s.offset;
+            total += s.len;
+            if (zero_copy_ && s.data && s.len >= threshold_) {
+                send_plain();
+                std::vector<iovec> large{{const_cast<char *>(base), s.len}};
+                send_zero_copy(large, total);
+                continue;
+            }
+            plain.push_back({const_cast<char *>(base), s.len});
+            if (plain.size() == GATHER_IOV_MAX) {
+                send_plain();
+            }
+        }
+        send_plain();
+
+        segments_.clear();
+        staging_.clear();
+        wait_zero_copy(total);
+    }
+
+  private:
+    struct segment
+    {
+        /* Caller's memory, or null for bytes in staging_ at `offset` */
+        const char *data;
+        size_t offset;
+        size_t len;
+    };
+
+    [[noreturn]] void fail(int error, size_t total)
+    {
+        segments_.clear();
+        staging_.clear();
+        throw std::system_error(error, std::system_category(),
+                                "fail to send " + std::to_string(total) + " bytes of data");
+    }
+
+    /* sendmsg() until every iovec is out; returns how many calls carried `flags` */
+    size_t send_all(std::vector<iovec> &iov, int flags, size_t total)
+    {
+        size_t calls = 0;
+        size_t first = 0;
+        while (first < iov.size()) {
+            msghdr msg{};
+            msg.msg_iov = iov.data() + first;
+            msg.msg_iovlen = iov.size() - first;
+            ssize_t sent = ::sendmsg(fd_, &msg, GATHER_SEND_FLAGS | flags);
+            if (sent < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (flags && errno == ENOBUFS) {
+                    /* Out of optmem for pinned pages: send this one normally */
+                    flags = 0;
+                    continue;
+                }
+                fail(errno, total);
+            }
+            if (flags) {
+                ++calls;
+            }
+            size_t left = static_cast<size_t>(sent);
+            while (first < iov.size() && left >= iov[first].iov_len) {
+                left -= iov[first].iov_len;
+                ++first;
+            }
+            if (left) {
+                iov[first].iov_base = static_cast<char *>(iov[first].iov_base) + left;
+                iov[first].iov_len -= left;
+            }
+        }
+        return calls;
+    }
+
+    void send_zero_copy(std::vector<iovec> &iov, size_t total)
+    {
+#ifdef PHP_CLICKHOUSE_HAVE_ZERO_COPY
+        /* Every successful MSG_ZEROCOPY call gets the next completion id */
+        issued_ += static_cast<uint32_t>(send_all(iov, MSG_ZEROCOPY, total));
+#else
+        send_all(iov, 0, total);
+#endif
+    }
+
+    /* The kernel may still read the sent regions until it reports them
+     * done on the error queue; the caller's memory must outlive that */
+    void wait_zero_copy(size_t total)
+    {
+#ifdef PHP_CLICKHOUSE_HAVE_ZERO_COPY
+        int timeout_ms = -1;
+        if (send_timeout_.count() > 0) {
+            timeout_ms = static_cast<int>(std::min<long long>(send_timeout_.count(), INT_MAX));
+        }
+        while (completed_ != issued_) {
+            pollfd pfd{fd_, 0, 0};
+            int rc = ::poll(&pfd, 1, timeout_ms);
+            if (rc < 0 && errno == EINTR) {
+                continue;
+            }
+            if (rc <= 0) {
+                /* The pages stay pinned until the kernel lets go of them,
+                 * so only the connection is lost */
+                ::shutdown(fd_, SHUT_RDWR);
+                fail(rc == 0 ? ETIMEDOUT : errno, total);
+            }
+            drain_error_queue();
+        }
+#else
+        (void)total;
+#endif
+    }
+
+#ifdef PHP_CLICKHOUSE_HAVE_ZERO_COPY
+    void drain_error_queue()
+    {
+        while (true) {
+            char control[128];
+            msghdr msg{};
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            if (::recvmsg(fd_, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+                return;
+            }
+            for (cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+                sock_extended_err err;
+                std::memcpy(&err, CMSG_DATA(cm), sizeof(err));
+                if (err.ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+                    continue;
+                }
+                /* ee_info..ee_data is the range of calls that completed */
+                completed_ += err.ee_data - err.ee_info + 1;
+                if (err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                    /* The device (or loopback) copied anyway: pinning pages
+                     * only adds cost, so stop asking */
+                    zero_copy_ = false;
+                }
+            }
+        }
+    }
+#endif
+
+    int fd_;
+    bool zero_copy_;
+    size_t threshold_;
+    std::chrono::milliseconds send_timeout_;
+    std::vector<segment> segments_;
+    std::vector<char> staging_;
+    uint32_t issued_ = 0;
+    uint32_t completed_ = 0;
+};
+
+std::unique_ptr<OutputStream>
+php_clickhouse_gather_output_new(int fd, bool zero_copy, size_t zero_copy_threshold,
+                                 std::chrono::milliseconds send_timeout)
+{
+    return std::make_unique<gather_output>(fd, zero_copy, zero_copy_threshold, send_timeout);
+}
@@ -0,0 +1,33 @@
+#ifndef PHP_CLICKHOUSE_GATHER_OUTPUT_H
+#define PHP_CLICKHOUSE_GATHER_OUTPUT_H
+
+#include "clickhouse/base/output.h"
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+
+/* Writes up to this size are copied; larger ones are sent from the caller's memory */
+#define PHP_CLICKHOUSE_GATHER_COPY_MAX 8192
+
+/* Ask the kernel to report MSG_ZEROCOPY completions on `fd`; false if unsupported */
+bool php_clickhouse_zero_copy_enable(int fd);
+
+/**
+ * Output stream for uncompressed connections (zeroCopyThreshold). Nothing is
+ * sent until Flush(): small writes are copied into a staging buffer, larger
+ * ones are kept as references, and the whole packet goes out with as few
+ * sendmsg() calls as the iovec limit allows. Regions of at least
+ * `zero_copy_threshold` bytes are sent with MSG_ZEROCOPY when `zero_copy` is
+ * set, and Flush() waits for their completions before returning.
+ *
+ * Keeping references relies on clickhouse-cpp's BufferedOutput: it only
+ * passes writes larger than its 8 KiB buffer straight through, and without
+ * compression those point into the block, query or external table that the
+ * packet is built from, which outlive the packet's Flush().
+ */
+std::unique_ptr<clickhouse::OutputStream>
+php_clickhouse_gather_output_new(int fd, bool zero_copy, size_t zero_copy_threshold,
+                                 std::chrono::milliseconds send_timeout);
+
+#endif
@@ -0,0 +1,189 @@
+#include "src/native_format.h"
+#include "src/client_options.h"
+#include "src/common.h"
+
+#include "clickhouse/base/input.h"
+#include "clickhouse/base/wire_format.h"
+#include "clickhouse/columns/factory.h"
+
+#include <cstring>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace clickhouse;
+
+/* Method byte of a compressed frame, after its 16-byte checksum */
+#define NATIVE_FRAME_LZ4 0x82
+#define NATIVE_FRAME_ZSTD 0x90
+/* Checksum, method byte, compressed and uncompressed sizes */
+#define NATIVE_FRAME_HEADER 25
+
+php_clickhouse_native_writer::php_clickhouse_native_writer(CompressionMethod method)
+    : output_(&buffer_)
+{
+    if (method != CompressionMethod::None) {
+        compressed_ = std::make_unique<CompressedOutput>(&output_, PHP_CLICKHOUSE_NATIVE_FRAME_SIZE,
+                                                         method);
+    }
+}
+
+void php_clickhouse_native_writer::append(const Block &block)
+{
+    OutputStream &out = compressed_ ? static_cast<OutputStream &>(*compressed_) : output_;
+    WireFormat::WriteUInt64(out, block.GetColumnCount());
+    WireFormat::WriteUInt64(out, block.GetRowCount());
+    for (size_t c = 0; c < block.GetColumnCount(); ++c) {
+        WireFormat::WriteString(out, block.GetColumnName(c));
+        WireFormat::WriteString(out, block[c]->Type()->GetName());
+        /* An empty block carries no column data; LowCardinality would still
+         * write its dictionary header, which readers do not expect */
+        if (block.GetRowCount() > 0) {
+            block[c]->Save(&out);
+        }
+    }
+}
+
+const Buffer &php_clickhouse_native_writer::finish()
+{
+    if (compressed_) {
+        compressed_->Flush();
+    }
+    output_.Flush();
+    return buffer_;
+}
+
+/* Decode the blocks of `in` one at a time until it ends or `on_block`
+ * returns false */
+static void native_each_block(InputStream &in,
+                              const std::function<bool(const Block &)> &on_block)
+{
+    uint64_t cols = 0;
+    while (WireFormat::ReadUInt64(in, &cols)) {
+        uint64_t rows = 0;
+        if (!WireFormat::ReadUInt64(in, &rows)) {
+            throw ProtocolError("Native data ends inside a block header");
+        }
+        Block block(cols, rows);
+        for (size_t c = 0; c < cols; ++c) {
+            std::string name;
+            std::string type;
+            if (!WireFormat::ReadString(in, &name) || !WireFormat::ReadString(in, &type)) {
+                throw ProtocolError("Native data ends inside a column header");
+            }
+            ColumnRef column = CreateColumnByType(type);
+            if (!column) {
+                throw ProtocolError("Unsupported column type in Native data: " + type);
+            }
+            if (rows && !column->Load(&in, rows)) {
+                throw ProtocolError("Native data ends inside column " + name);
+            }
+            block.AppendColumn(name, column);
+        }
+        if (!on_block(block)) {
+            return;
+        }
+    }
+}
+
+/* Read every block from `in` and append them column by column */
+static Block native_read_blocks(InputStream &in)
+{
+    std::vector<std::pair<std::string, ColumnRef>> columns;
+    bool first = true;
+    native_each_block(in, [&](const Block &block) {
+        size_t cols = block.GetColumnCount();
+        if (!first && cols != columns.size()) {
+            throw ProtocolError("Native blocks have different column counts");
+        }
+        for (size_t c = 0; c < cols; ++c) {
+            if (first) {
+                columns.emplace_back(block.GetColumnName(c), block[c]);
+                continue;
+            }
+            if (columns[c].first != block.GetColumnName(c) ||
+                columns[c].second->Type()->GetName() != block[c]->Type()->GetName()) {
+                throw ProtocolError("Native blocks have different columns");
+            }
+            columns[c].second->Append(block[c]);
+        }
+        first = false;
+        return true;
+    });
+
+    Block block;
+    for (auto &column : columns) {
+        block.AppendColumn(column.first, column.second);
+    }
+    return block;
+}
+
+static bool native_looks_compressed(const char *data, size_t len)
+{
+    if (len < NATIVE_FRAME_HEADER) {
+        return false;
+    }
+    unsigned char method = static_cast<unsigned char>(data[16]);
+    uint32_t frame = 0;
+    memcpy(&frame, data + 17, sizeof(frame));
+    return (method == NATIVE_FRAME_LZ4 || method == NATIVE_FRAME_ZSTD) && frame >= 9 &&
+           frame <= len - 16;
+}
+
+Block php_clickhouse_native_read(const char *data, size_t len)
+{
+    if (native_looks_compressed(data, len)) {
+        try {
+            ArrayInput raw(data, len);
+            CompressedInput in(&raw);
+            return native_read_blocks(in);
+        } catch (const Error &) {
+            /* A plain stream that happens to look like a frame header:
+             * its checksum cannot match, so parse it as it is */
+        }
+    }
+    ArrayInput in(data, len);
+    return native_read_blocks(in);
+}
+
+void php_clickhouse_native_read_each(const char *data, size_t len,
+                                     const std::function<bool(const Block &)> &on_block)
+{
+    if (native_looks_compressed(data, len)) {
+        bool delivered = false;
+        try {
+            ArrayInput raw(data, len);
+            CompressedInput in(&raw);
+            native_each_block(in, [&](const Block &block) {
+                delivered = true;
+                return on_block(block);
+            });
+            return;
+        } catch (const Error &) {
+            /* Only a stream nothing was taken from yet can be parsed again */
+            if (delivered) {
+                throw;
+            }
+        }
+    }
+    ArrayInput in(data, len);
+    native_each_block(in, on_block);
+}
+
+bool php_clickhouse_native_compression(zval *value, CompressionMethod &method)
+{
+    method = CompressionMethod::None;
+    if (!value || Z_TYPE_P(value) == IS_NULL) {
+        return true;
+    }
+    zend_long code = 0;
+    if (!php_clickhouse_compression_from_zval(value, &code) ||
+        code == PHP_CLICKHOUSE_COMPRESSION_ADAPTIVE) {
+        zend_throw_exception(clickhouse_ce_ValidationException,
+                             "Compression must be CompressionMethod::None, LZ4 or ZSTD", 0);
+        return false;
+    }
+    method = static_cast<CompressionMethod>(code);
+    return true;
+}
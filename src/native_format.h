@@ -0,0 +1,67 @@
+#ifndef PHP_CLICKHOUSE_NATIVE_FORMAT_H
+#define PHP_CLICKHOUSE_NATIVE_FORMAT_H
+
+#include "php_clickhouse.h"
+#include "clickhouse/base/buffer.h"
+#include "clickhouse/base/compressed.h"
+#include "clickhouse/base/output.h"
+#include "clickhouse/block.h"
+#include "clickhouse/client.h"
+
+#include <functional>
+#include <memory>
+
+/* Uncompressed bytes per compressed frame, ClickHouse's max_compress_block_size */
+#define PHP_CLICKHOUSE_NATIVE_FRAME_SIZE (1024 * 1024)
+
+/**
+ * Serializes blocks in ClickHouse's Native format, as written by
+ * `FORMAT Native`: per block the column and row counts, then each column's
+ * name, type name and data. With LZ4 or ZSTD the stream is cut into the
+ * checksummed frames that clickhouse-compressor and the HTTP interface's
+ * compress=1 use.
+ */
+class php_clickhouse_native_writer
+{
+  public:
+    explicit php_clickhouse_native_writer(clickhouse::CompressionMethod method);
+
+    void append(const clickhouse::Block &block);
+
+    /* Bytes written so far, up to the last complete frame when compressing */
+    size_t size() const
+    {
+        return buffer_.size();
+    }
+
+    /* The serialized stream; flushes the last compressed frame */
+    const clickhouse::Buffer &finish();
+
+  private:
+    clickhouse::Buffer buffer_;
+    clickhouse::BufferOutput output_;
+    std::unique_ptr<clickhouse::CompressedOutput> compressed_;
+};
+
+/**
+ * Parse a Native stream written by php_clickhouse_native_writer or by the
+ * server, compressed or not. Consecutive blocks are concatenated into one.
+ * Throws clickhouse::ProtocolError on malformed input.
+ */
+clickhouse::Block php_clickhouse_native_read(const char *data, size_t len);
+
+/**
+ * The same, handing each block to `on_block` as it is decoded instead of
+ * concatenating them, so only one block is held at a time. Stops when
+ * `on_block` returns false.
+ */
+void php_clickhouse_native_read_each(
+    const char *data, size_t len, const std::function<bool(const clickhouse::Block &)> &on_block);
+
+/**
+ * Resolve a nullable CompressionMethod argument. Returns false with a
+ * ValidationException pending for invalid values and Adaptive.
+ */
+bool php_clickhouse_native_compression(zval *value, clickhouse::CompressionMethod &method);
+
+#endif
@@ -0,0 +1,136 @@
+#include "src/query_runner.h"
+
+using steady_clock = std::chrono::steady_clock;
+
+php_clickhouse_query_runner::php_clickhouse_query_runner(
+    clickhouse::Client &client, clickhouse::Query query, size_t max_blocks,
+    std::shared_ptr<php_clickhouse_runner_signal> signal, clickhouse::ExternalTables tables)
+    : client_(client), query_(std::move(query)), tables_(std::move(tables)),
+      max_blocks_(max_blocks ? max_blocks : 1),
+      signal_(signal ? std::move(signal) : std::make_shared<php_clickhouse_runner_signal>())
+{
+}
+
+php_clickhouse_query_runner::~php_clickhouse_query_runner()
+{
+    cancel();
+    join();
+}
+
+void php_clickhouse_query_runner::start()
+{
+    query_.OnDataCancelable([this](const clickhouse::Block &block) -> bool {
+        php_clickhouse_query_event event;
+        event.type = php_clickhouse_query_event::kind::data;
+        event.block = block;
+        return push(std::move(event), true);
+    });
+    query_.OnProgress([this](const clickhouse::Progress &progress) {
+        php_clickhouse_query_event event;
+        event.type = php_clickhouse_query_event::kind::progress;
+        event.progress = progress;
+        push(std::move(event), false);
+    });
+    query_.OnProfile([this](const clickhouse::Profile &profile) {
+        php_clickhouse_query_event event;
+        event.type = php_clickhouse_query_event::kind::profile;
+        event.profile = profile;
+        push(std::move(event), false);
+    });
+
+    thread_ = std::thread(&php_clickhouse_query_runner::run, this);
+}
+
+void php_clickhouse_query_runner::run()
+{
+    std::exception_ptr error;
+    try {
+        if (tables_.empty()) {
+            client_.Execute(query_);
+        } else {
+            client_.SelectWithExternalData(query_, tables_);
+        }
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> guard(signal_->lock);
+    error_ = error;
+    done_ = true;
+    signal_->wakeup.notify_all();
+}
+
+/* Runs on the runner thread. Returns false once the consumer cancelled. */
+bool php_clickhouse_query_runner::push(php_clickhouse_query_event &&event, bool is_data)
+{
+    std::unique_lock<std::mutex> guard(signal_->lock);
+    if (is_data) {
+        signal_->wakeup.wait(guard, [this] { return cancelled_ || queued_blocks_ < max_blocks_; });
+    }
+    if (cancelled_) {
+        return false;
+    }
+
+    if (is_data) {
+        ++queued_blocks_;
+        if (event.block.GetRowCount() > 0) {
+            rows_received_ = true;
+        }
+    }
+    events_.push_back(std::move(event));
+    signal_->wakeup.notify_all();
+    return true;
+}
+
+php_clickhouse_query_runner::wait_result
+php_clickhouse_query_runner::next(php_clickhouse_query_event &out, steady_clock::time_point until)
+{
+    std::unique_lock<std::mutex> guard(signal_->lock);
+    auto ready = [this] { return !events_.empty() || done_; };
+    if (until == steady_clock::time_point::max()) {
+        signal_->wakeup.wait(guard, ready);
+    } else if (!signal_->wakeup.wait_until(guard, until, ready)) {
+        return wait_result::timeout;
+    }
+
+    if (events_.empty()) {
+        return wait_result::finished;
+    }
+    out = std::move(events_.front());
+    events_.pop_front();
+    if (out.type == php_clickhouse_query_event::kind::data) {
+        --queued_blocks_;
+        signal_->wakeup.notify_all();
+    }
+    return wait_result::event;
+}
+
+void php_clickhouse_query_runner::cancel()
+{
+    std::lock_guard<std::mutex> guard(signal_->lock);
+    cancelled_ = true;
+    events_.clear();
+    queued_blocks_ = 0;
+    signal_->wakeup.notify_all();
+}
+
+void php_clickhouse_query_runner::finish()
+{
+    join();
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> guard(signal_->lock);
+        error = error_;
+        error_ = nullptr;
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void php_clickhouse_query_runner::join()
+{
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
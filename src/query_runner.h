@@ -0,0 +1,177 @@
+#ifndef PHP_CLICKHOUSE_QUERY_RUNNER_H
+#define PHP_CLICKHOUSE_QUERY_RUNNER_H
+
+#include "clickhouse/client.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* One packet handed from a runner thread to the PHP thread */
+struct php_clickhouse_query_event
+{
+    enum class kind
+    {
+        data,
+        progress,
+        profile
+    };
+
+    kind type = kind::data;
+    clickhouse::Block block;
+    clickhouse::Progress progress{};
+    clickhouse::Profile profile{};
+};
+
+/* Lock and wakeup shared by runners that are waited on together */
+struct php_clickhouse_runner_signal
+{
+    std::mutex lock;
+    std::condition_variable wakeup;
+};
+
+/**
+ * Executes one query on its own thread and queues the received packets for
+ * the PHP thread. The runner thread only touches clickhouse-cpp objects; all
+ * zval work stays on the PHP thread. At most `max_blocks` data blocks are
+ * buffered, after which the server is back-pressured through TCP. With
+ * `tables`, the query is sent with them as external data.
+ */
+class php_clickhouse_query_runner
+{
+  public:
+    enum class wait_result
+    {
+        event,
+        finished,
+        timeout
+    };
+
+    php_clickhouse_query_runner(clickhouse::Client &client, clickhouse::Query query,
+                                size_t max_blocks,
+                                std::shared_ptr<php_clickhouse_runner_signal> signal = nullptr,
+                                clickhouse::ExternalTables tables = {});
+    ~php_clickhouse_query_runner();
+
+    php_clickhouse_query_runner(const php_clickhouse_query_runner &) = delete;
+    php_clickhouse_query_runner &operator=(const php_clickhouse_query_runner &) = delete;
+
+    void start();
+
+    /* Take the next event, waiting until `until` at most */
+    wait_result next(php_clickhouse_query_event &out, std::chrono::steady_clock::time_point until);
+    wait_result next(php_clickhouse_query_event &out)
+    {
+        return next(out, std::chrono::steady_clock::time_point::max());
+    }
+
+    /* Ask the server to stop: the next data block is answered with Cancel */
+    void cancel();
+
+    /* Wait for the thread to exit; rethrows the query's exception, if any */
+    void finish();
+
+    /* Wait for the thread to exit and drop any error (losing or abandoned runners) */
+    void join();
+
+    /* At least one data block with rows has been received (caller holds the signal lock) */
+    bool has_rows_locked() const
+    {
+        return rows_received_;
+    }
+
+    /* next() would not block (caller holds the signal lock) */
+    bool ready_locked() const
+    {
+        return !events_.empty() || done_;
+    }
+
+    /* The query has ended; queued events may remain (caller holds the signal lock) */
+    bool finished_locked() const
+    {
+        return done_;
+    }
+
+    /* The query has ended with an error (caller holds the signal lock) */
+    bool failed_locked() const
+    {
+        return done_ && error_;
+    }
+
+    php_clickhouse_runner_signal &signal()
+    {
+        return *signal_;
+    }
+
+    clickhouse::Client &client()
+    {
+        return client_;
+    }
+
+  private:
+    void run();
+    bool push(php_clickhouse_query_event &&event, bool is_data);
+
+    clickhouse::Client &client_;
+    clickhouse::Query query_;
+    clickhouse::ExternalTables tables_;
+    size_t max_blocks_;
+    std::shared_ptr<php_clickhouse_runner_signal> signal_;
+    std::thread thread_;
+
+    /* Guarded by signal_->lock */
+    std::deque<php_clickhouse_query_event> events_;
+    size_t queued_blocks_ = 0;
+    bool rows_received_ = false;
+    bool cancelled_ = false;
+    bool done_ = false;
+    std::exception_ptr error_;
+};
+
+/**
+ * Block until one of the runners (sharing one signal) satisfies `pred`
+ * or `until` passes. Null entries are skipped. Returns the index of that
+ * runner, or -1 on timeout.
+ */
+template <typename Pred>
+static inline int php_clickhouse_wait_any(const std::vector<php_clickhouse_query_runner *> &runners,
+                                          std::chrono::steady_clock::time_point until, Pred pred)
+{
+    php_clickhouse_query_runner *first = nullptr;
+    for (php_clickhouse_query_runner *runner : runners) {
+        if (runner) {
+            first = runner;
+            break;
+        }
+    }
+    if (!first) {
+        return -1;
+    }
+    php_clickhouse_runner_signal &signal = first->signal();
+    std::unique_lock<std::mutex> guard(signal.lock);
+    while (true) {
+        for (size_t i = 0; i < runners.size(); ++i) {
+            if (runners[i] && pred(*runners[i])) {
+                return static_cast<int>(i);
+            }
+        }
+        if (until == std::chrono::steady_clock::time_point::max()) {
+            signal.wakeup.wait(guard);
+        } else if (signal.wakeup.wait_until(guard, until) == std::cv_status::timeout) {
+            for (size_t i = 0; i < runners.size(); ++i) {
+                if (runners[i] && pred(*runners[i])) {
+                    return static_cast<int>(i);
+                }
+            }
+            return -1;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,508 @@
+#include "src/result_cache.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <limits>
+#include <map>
+#include <string_view>
+
+#include <pthread.h>
+#include <sys/mman.h>
+
+#define CACHE_NONE UINT32_MAX
+/* Fewer chunks than this is not worth a cache */
+#define CACHE_MIN_CHUNKS 16
+
+namespace
+{
+
+/* Metadata of an entry, stored at the index of its first chunk */
+struct cache_entry
+{
+    uint64_t hash;
+    int64_t expires;
+    uint64_t key_len;
+    uint64_t data_len;
+    uint32_t chunks;
+    uint32_t bucket_next;
+    /* Towards the most and the least recently used entry */
+    uint32_t lru_prev;
+    uint32_t lru_next;
+};
+
+struct cache_header
+{
+    pthread_mutex_t lock;
+    uint32_t chunks;
+    uint32_t free_head;
+    uint32_t free_count;
+    uint32_t lru_head;
+    uint32_t lru_tail;
+    uint32_t entries;
+    uint64_t hits;
+    uint64_t misses;
+};
+
+/* The mapping: header, then per chunk a bucket head, a next-chunk link and
+ * an entry slot, then the chunks themselves */
+struct cache_segment
+{
+    void *base = nullptr;
+    size_t size = 0;
+    cache_header *header = nullptr;
+    uint32_t *buckets = nullptr;
+    uint32_t *next = nullptr;
+    cache_entry *entries = nullptr;
+    char *data = nullptr;
+};
+
+cache_segment cache;
+
+char *chunk(uint32_t index)
+{
+    return cache.data + static_cast<size_t>(index) * PHP_CLICKHOUSE_RESULT_CACHE_CHUNK;
+}
+
+void cache_clear()
+{
+    cache_header *h = cache.header;
+    uint32_t n = h->chunks;
+    for (uint32_t i = 0; i < n; ++i) {
+        cache.buckets[i] = CACHE_NONE;
+        cache.next[i] = i + 1 < n ? i + 1 : CACHE_NONE;
+    }
+    h->free_head = 0;
+    h->free_count = n;
+    h->lru_head = CACHE_NONE;
+    h->lru_tail = CACHE_NONE;
+    h->entries = 0;
+}
+
+/* Lock the segment; false if the mutex is unusable */
+bool cache_lock()
+{
+    int rc = pthread_mutex_lock(&cache.header->lock);
+#if defined(__linux__)
+    if (rc == EOWNERDEAD) {
+        /* A worker died inside the cache: its links cannot be trusted */
+        cache_clear();
+        pthread_mutex_consistent(&cache.header->lock);
+        return true;
+    }
+#endif
+    return rc == 0;
+}
+
+void cache_unlock()
+{
+    pthread_mutex_unlock(&cache.header->lock);
+}
+
+/* Copy `len` bytes at `offset` of the chain starting at `first` */
+void chain_read(uint32_t first, size_t offset, char *dst, size_t len)
+{
+    uint32_t c = first;
+    while (offset >= PHP_CLICKHOUSE_RESULT_CACHE_CHUNK) {
+        c = cache.next[c];
+        offset -= PHP_CLICKHOUSE_RESULT_CACHE_CHUNK;
+    }
+    while (len) {
+        size_t n = std::min(len, PHP_CLICKHOUSE_RESULT_CACHE_CHUNK - offset);
+        memcpy(dst, chunk(c) + offset, n);
+        dst += n;
+        len -= n;
+        offset = 0;
+        c = cache.next[c];
+    }
+}
+
+/* Write `len` bytes at the cursor and advance it */
+void chain_write(uint32_t &c, size_t &offset, const char *src, size_t len)
+{
+    while (len) {
+        if (offset == PHP_CLICKHOUSE_RESULT_CACHE_CHUNK) {
+            c = cache.next[c];
+            offset = 0;
+        }
+        size_t n = std::min(len, PHP_CLICKHOUSE_RESULT_CACHE_CHUNK - offset);
+        memcpy(chunk(c) + offset, src, n);
+        src += n;
+        len -= n;
+        offset += n;
+    }
+}
+
+void lru_unlink(uint32_t e)
+{
+    cache_header *h = cache.header;
+    cache_entry &entry = cache.entries[e];
+    if (entry.lru_prev != CACHE_NONE) {
+        cache.entries[entry.lru_prev].lru_next = entry.lru_next;
+    } else {
+        h->lru_head = entry.lru_next;
+    }
+    if (entry.lru_next != CACHE_NONE) {
+        cache.entries[entry.lru_next].lru_prev = entry.lru_prev;
+    } else {
+        h->lru_tail = entry.lru_prev;
+    }
+}
+
+void lru_push_front(uint32_t e)
+{
+    cache_header *h = cache.header;
+    cache_entry &entry = cache.entries[e];
+    entry.lru_prev = CACHE_NONE;
+    entry.lru_next = h->lru_head;
+    if (h->lru_head != CACHE_NONE) {
+        cache.entries[h->lru_head].lru_prev = e;
+    } else {
+        h->lru_tail = e;
+    }
+    h->lru_head = e;
+}
+
+void entry_remove(uint32_t e)
+{
+    cache_header *h = cache.header;
+    cache_entry &entry = cache.entries[e];
+
+    uint32_t *link = &cache.buckets[entry.hash % h->chunks];
+    while (*link != e) {
+        link = &cache.entries[*link].bucket_next;
+    }
+    *link = entry.bucket_next;
+    lru_unlink(e);
+
+    uint32_t last = e;
+    for (uint32_t i = 1; i < entry.chunks; ++i) {
+        last = cache.next[last];
+    }
+    cache.next[last] = h->free_head;
+    h->free_head = e;
+    h->free_count += entry.chunks;
+    h->entries--;
+}
+
+uint32_t entry_find(uint64_t hash, const std::string &key)
+{
+    std::string stored;
+    for (uint32_t e = cache.buckets[hash % cache.header->chunks]; e != CACHE_NONE;
+         e = cache.entries[e].bucket_next) {
+        const cache_entry &entry = cache.entries[e];
+        if (entry.hash != hash || entry.key_len != key.size()) {
+            continue;
+        }
+        stored.resize(key.size());
+        chain_read(e, 0, &stored[0], key.size());
+        if (stored == key) {
+            return e;
+        }
+    }
+    return CACHE_NONE;
+}
+
+size_t chunks_for(size_t bytes)
+{
+    return (bytes + PHP_CLICKHOUSE_RESULT_CACHE_CHUNK - 1) / PHP_CLICKHOUSE_RESULT_CACHE_CHUNK;
+}
+
+/* "64M", "512K", "1G" or a number of bytes */
+size_t parse_size(const char *value)
+{
+    if (!value) {
+        return 0;
+    }
+    char *end = nullptr;
+    unsigned long long size = strtoull(value, &end, 10);
+    switch (std::toupper(static_cast<unsigned char>(*end))) {
+    case 'G':
+        size <<= 10;
+        /* fallthrough */
+    case 'M':
+        size <<= 10;
+        /* fallthrough */
+    case 'K':
+        size <<= 10;
+        break;
+    }
+    return static_cast<size_t>(size);
+}
+
+/* Query text with runs of whitespace outside quotes and comments reduced to
+ * one space. A -- comment keeps the newline that ends it, which stands for
+ * the whitespace after it, so the text that follows is not commented out. */
+void append_normalized(std::string &out, const char *sql, size_t len)
+{
+    char quote = 0;
+    bool space = false;
+    for (size_t i = 0; i < len; ++i) {
+        char ch = sql[i];
+        if (quote) {
+            out += ch;
+            if (ch == '\\' && i + 1 < len) {
+                out += sql[++i];
+            } else if (ch == quote) {
+                quote = 0;
+            }
+            continue;
+        }
+        if (std::isspace(static_cast<unsigned char>(ch))) {
+            space = true;
+            continue;
+        }
+        if (space && !out.empty() && out.back() != '\0' && out.back() != '\n') {
+            out += ' ';
+        }
+        space = false;
+        if (ch == '-' && i + 1 < len && sql[i + 1] == '-') {
+            const char *end = static_cast<const char *>(memchr(sql + i, '\n', len - i));
+            size_t stop = end ? static_cast<size_t>(end - sql) : len;
+            out.append(sql + i, stop - i);
+            if (end) {
+                out += '\n';
+            }
+            i = stop;
+            continue;
+        }
+        if (ch == '/' && i + 1 < len && sql[i + 1] == '*') {
+            size_t end = std::string_view(sql, len).find("*/", i + 2);
+            size_t stop = end != std::string_view::npos ? end + 2 : len;
+            out.append(sql + i, stop - i);
+            i = stop - 1;
+            continue;
+        }
+        if (ch == '\'' || ch == '"' || ch == '`') {
+            quote = ch;
+        }
+        out += ch;
+    }
+}
+
+void append_field(std::string &out, const char *data, size_t len)
+{
+    out += std::to_string(len);
+    out += ':';
+    out.append(data, len);
+}
+
+void append_pairs(std::string &out, zval *values)
+{
+    std::map<std::string, std::string> sorted;
+    if (values && Z_TYPE_P(values) == IS_ARRAY) {
+        zend_string *key;
+        zval *val;
+        ZEND_HASH_FOREACH_STR_KEY_VAL(Z_ARRVAL_P(values), key, val)
+        {
+            if (!key) {
+                continue;
+            }
+            std::string text = "N";
+            if (Z_TYPE_P(val) != IS_NULL) {
+                zend_string *str = zval_get_string(val);
+                text.assign("V").append(ZSTR_VAL(str), ZSTR_LEN(str));
+                zend_string_release(str);
+            }
+            sorted[std::string(ZSTR_VAL(key), ZSTR_LEN(key))] = std::move(text);
+        }
+        ZEND_HASH_FOREACH_END();
+    }
+    out += std::to_string(sorted.size());
+    out += ';';
+    for (const auto &pair : sorted) {
+        append_field(out, pair.first.data(), pair.first.size());
+        append_field(out, pair.second.data(), pair.second.size());
+    }
+}
+
+} // namespace
+
+void php_clickhouse_result_cache_startup(const char *size)
+{
+    size_t bytes = parse_size(size);
+    size_t per_chunk =
+        PHP_CLICKHOUSE_RESULT_CACHE_CHUNK + 2 * sizeof(uint32_t) + sizeof(cache_entry);
+    size_t fit = bytes > sizeof(cache_header) ? (bytes - sizeof(cache_header)) / per_chunk : 0;
+    if (fit < CACHE_MIN_CHUNKS) {
+        return;
+    }
+    uint32_t chunks = static_cast<uint32_t>(std::min<size_t>(fit, CACHE_NONE - 1));
+
+    void *base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        return;
+    }
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+#if defined(__linux__)
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+#endif
+    auto *header = static_cast<cache_header *>(base);
+    int rc = pthread_mutex_init(&header->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+    if (rc != 0) {
+        munmap(base, bytes);
+        return;
+    }
+
+    char *p = static_cast<char *>(base) + sizeof(cache_header);
+    cache.base = base;
+    cache.size = bytes;
+    cache.header = header;
+    cache.buckets = reinterpret_cast<uint32_t *>(p);
+    cache.next = cache.buckets + chunks;
+    cache.entries = reinterpret_cast<cache_entry *>(
+        p + (2 * sizeof(uint32_t) * chunks + alignof(cache_entry) - 1) / alignof(cache_entry) *
+                alignof(cache_entry));
+    cache.data = reinterpret_cast<char *>(cache.entries + chunks);
+    /* Alignment padding may have eaten into the last chunk */
+    size_t room = static_cast<char *>(base) + bytes - cache.data;
+    header->chunks = static_cast<uint32_t>(
+        std::min<size_t>(chunks, room / PHP_CLICKHOUSE_RESULT_CACHE_CHUNK));
+    header->hits = 0;
+    header->misses = 0;
+    cache_clear();
+}
+
+void php_clickhouse_result_cache_shutdown()
+{
+    if (cache.base) {
+        munmap(cache.base, cache.size);
+        cache = cache_segment();
+    }
+}
+
+bool php_clickhouse_result_cache_enabled()
+{
+    return cache.base != nullptr;
+}
+
+size_t php_clickhouse_result_cache_max_entry()
+{
+    return cache.base ? static_cast<size_t>(cache.header->chunks / 4) *
+                            PHP_CLICKHOUSE_RESULT_CACHE_CHUNK
+                      : 0;
+}
+
+std::string php_clickhouse_result_cache_key(const std::string &scope, zend_string *query,
+                                            zval *params, zval *settings)
+{
+    std::string key;
+    key.reserve(scope.size() + ZSTR_LEN(query) + 64);
+    append_field(key, scope.data(), scope.size());
+    key += '\0';
+    append_normalized(key, ZSTR_VAL(query), ZSTR_LEN(query));
+    key += '\0';
+    append_pairs(key, params);
+    append_pairs(key, settings);
+    return key;
+}
+
+bool php_clickhouse_result_cache_get(const std::string &key, std::string &out)
+{
+    if (!cache.base || !cache_lock()) {
+        return false;
+    }
+    cache_header *h = cache.header;
+    uint64_t hash = std::hash<std::string>()(key);
+    uint32_t e = entry_find(hash, key);
+    if (e != CACHE_NONE && cache.entries[e].expires <= static_cast<int64_t>(time(nullptr))) {
+        entry_remove(e);
+        e = CACHE_NONE;
+    }
+    if (e == CACHE_NONE) {
+        h->misses++;
+        cache_unlock();
+        return false;
+    }
+    const cache_entry &entry = cache.entries[e];
+    out.resize(entry.data_len);
+    chain_read(e, entry.key_len, &out[0], entry.data_len);
+    lru_unlink(e);
+    lru_push_front(e);
+    h->hits++;
+    cache_unlock();
+    return true;
+}
+
+void php_clickhouse_result_cache_put(const std::string &key, const char *data, size_t len,
+                                     std::chrono::seconds ttl)
+{
+    size_t need = chunks_for(key.size() + len);
+    if (!cache.base || need == 0 || key.size() + len > php_clickhouse_result_cache_max_entry() ||
+        !cache_lock()) {
+        return;
+    }
+    cache_header *h = cache.header;
+    uint64_t hash = std::hash<std::string>()(key);
+    uint32_t old = entry_find(hash, key);
+    if (old != CACHE_NONE) {
+        entry_remove(old);
+    }
+    int64_t now = static_cast<int64_t>(time(nullptr));
+    if (h->free_count < need) {
+        /* Expired entries make room before live ones are evicted */
+        for (uint32_t e = h->lru_tail; e != CACHE_NONE;) {
+            uint32_t prev = cache.entries[e].lru_prev;
+            if (cache.entries[e].expires <= now) {
+                entry_remove(e);
+            }
+            e = prev;
+        }
+    }
+    while (h->free_count < need && h->lru_tail != CACHE_NONE) {
+        entry_remove(h->lru_tail);
+    }
+
+    uint32_t e = h->free_head;
+    uint32_t last = e;
+    for (size_t i = 1; i < need; ++i) {
+        last = cache.next[last];
+    }
+    h->free_head = cache.next[last];
+    h->free_count -= static_cast<uint32_t>(need);
+    cache.next[last] = CACHE_NONE;
+
+    uint32_t cursor = e;
+    size_t offset = 0;
+    chain_write(cursor, offset, key.data(), key.size());
+    chain_write(cursor, offset, data, len);
+
+    cache_entry &entry = cache.entries[e];
+    entry.hash = hash;
+    int64_t ttl_seconds = static_cast<int64_t>(ttl.count());
+    entry.expires = ttl_seconds > std::numeric_limits<int64_t>::max() - now
+                        ? std::numeric_limits<int64_t>::max()
+                        : now + ttl_seconds;
+    entry.key_len = key.size();
+    entry.data_len = len;
+    entry.chunks = static_cast<uint32_t>(need);
+    uint32_t &bucket = cache.buckets[hash % h->chunks];
+    entry.bucket_next = bucket;
+    bucket = e;
+    lru_push_front(e);
+    h->entries++;
+    cache_unlock();
+}
+
+bool php_clickhouse_result_cache_get_stats(php_clickhouse_result_cache_stats &stats)
+{
+    if (!cache.base || !cache_lock()) {
+        return false;
+    }
+    cache_header *h = cache.header;
+    stats.size = static_cast<size_t>(h->chunks) * PHP_CLICKHOUSE_RESULT_CACHE_CHUNK;
+    stats.used = static_cast<size_t>(h->chunks - h->free_count) * PHP_CLICKHOUSE_RESULT_CACHE_CHUNK;
+    stats.entries = h->entries;
+    stats.hits = h->hits;
+    stats.misses = h->misses;
+    cache_unlock();
+    return true;
+}
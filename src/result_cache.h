@@ -0,0 +1,55 @@
+#ifndef PHP_CLICKHOUSE_RESULT_CACHE_H
+#define PHP_CLICKHOUSE_RESULT_CACHE_H
+
+#include "php_clickhouse.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/* Unit of cache memory; an entry takes a whole number of chunks */
+#define PHP_CLICKHOUSE_RESULT_CACHE_CHUNK 8192
+
+struct php_clickhouse_result_cache_stats
+{
+    size_t size;
+    size_t used;
+    size_t entries;
+    uint64_t hits;
+    uint64_t misses;
+};
+
+/**
+ * Map the result cache (clickhouse.result_cache_size, e.g. "64M"). Called
+ * from MINIT, before FPM forks its workers, so that they all share the
+ * anonymous mapping. Entries are Native-encoded results keyed by
+ * php_clickhouse_result_cache_key(), evicted least recently used first and
+ * guarded by a process-shared mutex; a worker dying while holding it makes
+ * the next one clear the cache.
+ */
+void php_clickhouse_result_cache_startup(const char *size);
+void php_clickhouse_result_cache_shutdown();
+
+bool php_clickhouse_result_cache_enabled();
+
+/* Results larger than this are not stored */
+size_t php_clickhouse_result_cache_max_entry();
+
+/**
+ * Key of a query: the client's scope (servers, database, user), the query
+ * text with whitespace outside literals collapsed, and params and settings
+ * in key order.
+ */
+std::string php_clickhouse_result_cache_key(const std::string &scope, zend_string *query,
+                                            zval *params, zval *settings);
+
+/* Copy out the live entry for `key`; false on a miss */
+bool php_clickhouse_result_cache_get(const std::string &key, std::string &out);
+
+void php_clickhouse_result_cache_put(const std::string &key, const char *data, size_t len,
+                                     std::chrono::seconds ttl);
+
+bool php_clickhouse_result_cache_get_stats(php_clickhouse_result_cache_stats &stats);
+
+#endif
@@ -0,0 +1,501 @@
+#include "src/socket_factory.h"
+#include "src/gather_output.h"
+#include "src/uring_socket.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+using namespace clickhouse;
+
+using steady_clock = std::chrono::steady_clock;
+
+struct connect_candidate
+{
+    php_clickhouse_resolved_address address;
+    size_t endpoint_index;
+};
+
+struct connect_attempt
+{
+    int fd;
+    size_t candidate;
+    /* connection_connect_timeout after the attempt started */
+    steady_clock::time_point deadline;
+};
+
+static void close_fd(int fd)
+{
+    while (::close(fd) == -1 && errno == EINTR) {
+    }
+}
+
+/* `now + timeout`, or never when the timeout is zero or would overflow */
+static steady_clock::time_point deadline_after(steady_clock::time_point now,
+                                               std::chrono::milliseconds timeout)
+{
+    if (timeout.count() <= 0 ||
+        timeout >= std::chrono::duration_cast<std::chrono::milliseconds>(
+                       steady_clock::time_point::max() - now)) {
+        return steady_clock::time_point::max();
+    }
+    return now + timeout;
+}
+
+/* Resolve one endpoint and append its addresses, alternating address families
+ * so a broken IPv6 (or IPv4) path never shadows the other one. */
+static int resolve_endpoint(const Endpoint &endpoint, size_t endpoint_index,
+                            const php_clickhouse_dns_policy &policy,
+                            std::vector<connect_candidate> &out)
+{
+    std::vector<php_clickhouse_resolved_address> addresses;
+    int rc = php_clickhouse_dns_resolve(endpoint.host, endpoint.port, policy, addresses);
+    if (rc != 0) {
+        return rc;
+    }
+
+    std::vector<connect_candidate> primary;
+    std::vector<connect_candidate> secondary;
+    int primary_family = addresses.empty() ? AF_UNSPEC : addresses.front().family;
+    for (const auto &address : addresses) {
+        (address.family == primary_family ? primary : secondary)
+            .push_back({address, endpoint_index});
+    }
+
+    for (size_t i = 0; i < std::max(primary.size(), secondary.size()); ++i) {
+        if (i < primary.size()) {
+            out.push_back(primary[i]);
+        }
+        if (i < secondary.size()) {
+            out.push_back(secondary[i]);
+        }
+    }
+    return 0;
+}
+
+/* Start a non-blocking connect. Returns the descriptor, or -1 with errno set. */
+static int start_connect(const connect_candidate &c, bool *connected)
+{
+    int fd = ::socket(c.address.family, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd == -1) {
+        return -1;
+    }
+
+    *connected = false;
+    if (::connect(fd, reinterpret_cast<const sockaddr *>(&c.address.addr),
+                  c.address.addr_len) == 0) {
+        *connected = true;
+        return fd;
+    }
+    if (errno == EINPROGRESS || errno == EINTR) {
+        return fd;
+    }
+
+    int saved = errno;
+    close_fd(fd);
+    errno = saved;
+    return -1;
+}
+
+static void set_timeout(int fd, int option, std::chrono::milliseconds timeout)
+{
+    if (timeout.count() <= 0) {
+        return;
+    }
+    timeval tv{};
+    tv.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+    tv.tv_usec = static_cast<suseconds_t>((timeout.count() % 1000) * 1000);
+    ::setsockopt(fd, SOL_SOCKET, option, &tv, sizeof(tv));
+}
+
+/* Mirror what clickhouse-cpp applies to its own sockets */
+static void apply_socket_options(int fd, const ClientOptions &opts)
+{
+    int flags = ::fcntl(fd, F_GETFL, 0);
+    if (flags != -1) {
+        ::fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+    }
+
+#if defined(SO_NOSIGPIPE)
+    int nosigpipe = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &nosigpipe, sizeof(nosigpipe));
+#endif
+
+    if (opts.tcp_nodelay) {
+        int val = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &val, sizeof(val));
+    }
+
+    if (opts.tcp_keepalive) {
+        int val = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &val, sizeof(val));
+#if defined(TCP_KEEPIDLE)
+        int idle = static_cast<int>(opts.tcp_keepalive_idle.count());
+        ::setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+#endif
+#if defined(TCP_KEEPINTVL)
+        int intvl = static_cast<int>(opts.tcp_keepalive_intvl.count());
+        ::setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &intvl, sizeof(intvl));
+#endif
+#if defined(TCP_KEEPCNT)
+        int cnt = static_cast<int>(opts.tcp_keepalive_cnt);
+        ::setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &cnt, sizeof(cnt));
+#endif
+    }
+
+    set_timeout(fd, SO_RCVTIMEO, opts.connection_recv_timeout);
+    set_timeout(fd, SO_SNDTIMEO, opts.connection_send_timeout);
+}
+
+php_clickhouse_socket::php_clickhouse_socket(int fd, size_t zero_copy_threshold,
+                                             std::chrono::milliseconds send_timeout)
+    : fd_(fd), zero_copy_threshold_(zero_copy_threshold), send_timeout_(send_timeout)
+{
+    if (zero_copy_threshold_) {
+        zero_copy_ = php_clickhouse_zero_copy_enable(fd_);
+    }
+}
+
+php_clickhouse_socket::~php_clickhouse_socket()
+{
+    if (fd_ != -1) {
+        close_fd(fd_);
+    }
+}
+
+std::unique_ptr<InputStream> php_clickhouse_socket::makeInputStream() const
+{
+    return std::make_unique<SocketInput>(fd_);
+}
+
+std::unique_ptr<OutputStream> php_clickhouse_socket::makeOutputStream() const
+{
+    if (zero_copy_threshold_) {
+        return php_clickhouse_gather_output_new(fd_, zero_copy_, zero_copy_threshold_,
+                                                send_timeout_);
+    }
+    return std::make_unique<SocketOutput>(fd_);
+}
+
+/* Count the bytes a connection moves and the time its reads wait, for
+ * getCompressionStats() and CompressionMethod::Adaptive */
+class counting_input : public InputStream
+{
+  public:
+    counting_input(std::unique_ptr<InputStream> input,
+                   std::shared_ptr<php_clickhouse_connect_state> state)
+        : input_(std::move(input)), state_(std::move(state))
+    {
+    }
+
+    bool Skip(size_t bytes) override
+    {
+        auto start = steady_clock::now();
+        bool ok = input_->Skip(bytes);
+        add_read_time(start);
+        if (!ok) {
+            return false;
+        }
+        state_->bytes_received += bytes;
+        return true;
+    }
+
+  protected:
+    size_t DoRead(void *buf, size_t len) override
+    {
+        auto start = steady_clock::now();
+        size_t n = input_->Read(buf, len);
+        add_read_time(start);
+        state_->bytes_received += n;
+        return n;
+    }
+
+  private:
+    void add_read_time(steady_clock::time_point start)
+    {
+        auto waited = std::chrono::duration_cast<std::chrono::nanoseconds>(steady_clock::now() -
+                                                                           start);
+        state_->read_ns += static_cast<uint64_t>(waited.count());
+    }
+
+    std::unique_ptr<InputStream> input_;
+    std::shared_ptr<php_clickhouse_connect_state> state_;
+};
+
+class counting_output : public OutputStream
+{
+  public:
+    counting_output(std::unique_ptr<OutputStream> output,
+                    std::shared_ptr<php_clickhouse_connect_state> state)
+        : output_(std::move(output)), state_(std::move(state))
+    {
+    }
+
+  protected:
+    size_t DoWrite(const void *data, size_t len) override
+    {
+        size_t n = output_->Write(data, len);
+        state_->bytes_sent += n;
+        return n;
+    }
+
+    void DoFlush() override
+    {
+        output_->Flush();
+    }
+
+  private:
+    std::unique_ptr<OutputStream> output_;
+    std::shared_ptr<php_clickhouse_connect_state> state_;
+};
+
+/* Publishes the descriptor of the socket it wraps in the connect state for as
+ * long as the socket is alive */
+class tracked_socket : public SocketBase
+{
+  public:
+    tracked_socket(std::unique_ptr<SocketBase> socket, int fd,
+                   std::shared_ptr<php_clickhouse_connect_state> state)
+        : socket_(std::move(socket)), fd_(fd), state_(std::move(state))
+    {
+        std::lock_guard<std::mutex> guard(state_->lock);
+        state_->fd = fd_;
+        state_->aborted = false;
+    }
+
+    ~tracked_socket() override
+    {
+        {
+            std::lock_guard<std::mutex> guard(state_->lock);
+            if (state_->fd == fd_) {
+                state_->fd = -1;
+            }
+        }
+        socket_.reset();
+    }
+
+    std::unique_ptr<InputStream> makeInputStream() const override
+    {
+        return std::make_unique<counting_input>(socket_->makeInputStream(), state_);
+    }
+
+    std::unique_ptr<OutputStream> makeOutputStream() const override
+    {
+        return std::make_unique<counting_output>(socket_->makeOutputStream(), state_);
+    }
+
+  private:
+    std::unique_ptr<SocketBase> socket_;
+    int fd_;
+    std::shared_ptr<php_clickhouse_connect_state> state_;
+};
+
+void php_clickhouse_connect_abort(php_clickhouse_connect_state &state)
+{
+    std::lock_guard<std::mutex> guard(state.lock);
+    if (state.fd != -1) {
+        ::shutdown(state.fd, SHUT_RDWR);
+    }
+    state.aborted = true;
+}
+
+php_clickhouse_socket_factory::php_clickhouse_socket_factory(
+    const php_clickhouse_connect_options &options,
+    std::shared_ptr<php_clickhouse_connect_state> state)
+    : options_(options), state_(std::move(state))
+{
+    options_.parallelism = std::max(1u, options_.parallelism);
+}
+
+std::unique_ptr<SocketBase> php_clickhouse_socket_factory::connect(const ClientOptions &opts,
+                                                                   const Endpoint &endpoint)
+{
+    /* The requested endpoint goes first; the remaining failover endpoints
+     * follow so a black-holed primary does not cost the whole timeout. */
+    std::vector<Endpoint> endpoints{endpoint};
+    for (const auto &ep : opts.endpoints) {
+        if (ep.host != endpoint.host || ep.port != endpoint.port) {
+            endpoints.push_back(ep);
+        }
+    }
+
+    std::vector<connect_candidate> candidates;
+    int resolve_error = 0;
+    for (size_t i = 0; i < endpoints.size(); ++i) {
+        int rc = resolve_endpoint(endpoints[i], i, options_.dns, candidates);
+        if (rc != 0 && i == 0) {
+            resolve_error = rc;
+        }
+    }
+    if (candidates.empty()) {
+        throw std::system_error(ECONNREFUSED, std::system_category(),
+                                std::string("fail to resolve ") + endpoint.host + ": " +
+                                    (resolve_error ? gai_strerror(resolve_error) : "no address"));
+    }
+
+    /* Like clickhouse-cpp's sequential connect, every address gets the full
+     * connect timeout of its own, so one black-holed address cannot use up
+     * the time of the ones after it */
+    const auto timeout = opts.connection_connect_timeout;
+    auto next_start = steady_clock::now();
+
+    std::vector<connect_attempt> attempts;
+    size_t next_candidate = 0;
+    int last_error = ETIMEDOUT;
+    int winner_fd = -1;
+    size_t winner_candidate = 0;
+
+    auto abandon_all = [&attempts]() {
+        for (const auto &a : attempts) {
+            close_fd(a.fd);
+        }
+        attempts.clear();
+    };
+
+    while (winner_fd == -1) {
+        auto now = steady_clock::now();
+
+        /* An attempt past its timeout frees its slot for the next candidate */
+        for (size_t i = attempts.size(); i-- > 0;) {
+            if (now >= attempts[i].deadline) {
+                close_fd(attempts[i].fd);
+                attempts.erase(attempts.begin() + static_cast<std::ptrdiff_t>(i));
+                last_error = ETIMEDOUT;
+                next_start = now;
+            }
+        }
+
+        /* Launch the next candidate when a slot is free and its turn has come
+         * (immediately when nothing is in flight) */
+        while (next_candidate < candidates.size() && attempts.size() < options_.parallelism &&
+               (attempts.empty() || now >= next_start)) {
+            bool connected = false;
+            size_t idx = next_candidate++;
+            int fd = start_connect(candidates[idx], &connected);
+            if (fd == -1) {
+                last_error = errno;
+                continue;
+            }
+            if (connected) {
+                winner_fd = fd;
+                winner_candidate = idx;
+                break;
+            }
+            attempts.push_back({fd, idx, deadline_after(now, timeout)});
+            next_start = now + options_.stagger;
+        }
+        if (winner_fd != -1) {
+            break;
+        }
+
+        if (attempts.empty()) {
+            break; /* every candidate failed or timed out */
+        }
+
+        /* Sleep until something completes, the next stagger slot opens or
+         * an attempt times out */
+        auto wake = steady_clock::time_point::max();
+        if (next_candidate < candidates.size() && attempts.size() < options_.parallelism) {
+            wake = next_start;
+        }
+        for (const auto &a : attempts) {
+            wake = std::min(wake, a.deadline);
+        }
+        int wait_ms = -1;
+        if (wake != steady_clock::time_point::max()) {
+            auto remaining =
+                std::chrono::duration_cast<std::chrono::milliseconds>(wake - now).count();
+            wait_ms = static_cast<int>(std::max<long long>(0, remaining));
+        }
+
+        std::vector<pollfd> pfds(attempts.size());
+        for (size_t i = 0; i < attempts.size(); ++i) {
+            pfds[i].fd = attempts[i].fd;
+            pfds[i].events = POLLOUT;
+        }
+        int rc = ::poll(pfds.data(), pfds.size(), wait_ms);
+        if (rc < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            last_error = errno;
+            break;
+        }
+
+        for (size_t i = pfds.size(); i-- > 0;) {
+            if (pfds[i].revents == 0) {
+                continue;
+            }
+            int err = 0;
+            socklen_t len = sizeof(err);
+            if (::getsockopt(pfds[i].fd, SOL_SOCKET, SO_ERROR, &err, &len) == -1) {
+                err = errno;
+            }
+            if (err == 0 && winner_fd == -1) {
+                winner_fd = attempts[i].fd;
+                winner_candidate = attempts[i].candidate;
+            } else {
+                if (err != 0) {
+                    last_error = err;
+                }
+                close_fd(attempts[i].fd);
+                /* A failed attempt frees its slot right away (RFC 8305 5.) */
+                next_start = steady_clock::now();
+            }
+            attempts.erase(attempts.begin() + static_cast<std::ptrdiff_t>(i));
+        }
+    }
+
+    abandon_all();
+
+    if (winner_fd == -1) {
+        /* Nothing answered: re-resolve on the next failover attempt in case
+         * the records moved */
+        for (const auto &ep : endpoints) {
+            php_clickhouse_dns_invalidate(ep.host, ep.port);
+        }
+        throw std::system_error(last_error, std::system_category(),
+                                "fail to connect to " + endpoint.host + ":" +
+                                    std::to_string(endpoint.port));
+    }
+
+    apply_socket_options(winner_fd, opts);
+
+    const Endpoint &winner = endpoints[candidates[winner_candidate].endpoint_index];
+    std::unique_ptr<SocketBase> socket;
+    if (options_.tls) {
+        socket = php_clickhouse_tls_connect(winner_fd, winner, *options_.tls);
+    } else if (options_.io_uring) {
+        socket = php_clickhouse_uring_connect(winner_fd, opts);
+    }
+    if (!socket) {
+        /* Gather writes hold on to the caller's memory until the flush,
+         * which only uncompressed packets allow (see gather_output.h) */
+        size_t zero_copy_threshold = opts.compression_method == CompressionMethod::None
+                                         ? options_.zero_copy_threshold
+                                         : 0;
+        socket = std::make_unique<php_clickhouse_socket>(winner_fd, zero_copy_threshold,
+                                                         opts.connection_send_timeout);
+    }
+
+    if (!state_) {
+        return socket;
+    }
+    {
+        std::lock_guard<std::mutex> guard(state_->lock);
+        state_->endpoint = winner;
+    }
+    return std::make_unique<tracked_socket>(std::move(socket), winner_fd, state_);
+}
@@ -0,0 +1,99 @@
+#ifndef PHP_CLICKHOUSE_SOCKET_FACTORY_H
+#define PHP_CLICKHOUSE_SOCKET_FACTORY_H
+
+#include "clickhouse/base/socket.h"
+#include "clickhouse/client.h"
+#include "src/dns_cache.h"
+#include "src/tls.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+struct php_clickhouse_connect_options
+{
+    /* Number of connect attempts raced at once (1 = one address at a time) */
+    unsigned int parallelism = 1;
+    /* Delay before the next candidate address is tried while earlier ones are pending */
+    std::chrono::milliseconds stagger{250};
+    php_clickhouse_dns_policy dns;
+    /* Handshake on the winning socket with shared, cached TLS state */
+    std::optional<php_clickhouse_tls_options> tls;
+    /* Plain TCP connections use the io_uring transport when the kernel allows */
+    bool io_uring = false;
+    /* zeroCopyThreshold: gather writes on uncompressed plain TCP connections,
+     * MSG_ZEROCOPY from this many bytes; zero disables both */
+    size_t zero_copy_threshold = 0;
+};
+
+/* Connection bookkeeping shared between the factory (owned by clickhouse::Client)
+ * and the PHP Client object: the endpoint that actually won the last connect
+ * race, and the live descriptor so another thread can abort a blocked read. */
+struct php_clickhouse_connect_state
+{
+    std::mutex lock;
+    std::optional<clickhouse::Endpoint> endpoint;
+    int fd = -1;
+    /* Set by php_clickhouse_connect_abort(); cleared by the next connect */
+    bool aborted = false;
+    /* Bytes moved over the wire, summed across reconnects */
+    std::atomic<uint64_t> bytes_received{0};
+    std::atomic<uint64_t> bytes_sent{0};
+    /* Nanoseconds spent waiting in socket reads, for the bandwidth estimate
+     * of CompressionMethod::Adaptive */
+    std::atomic<uint64_t> read_ns{0};
+};
+
+/* Shut the current socket down so a thread blocked on it fails immediately.
+ * The owning clickhouse::Client must be reset before it is used again. */
+void php_clickhouse_connect_abort(php_clickhouse_connect_state &state);
+
+/* Plain TCP socket around an already connected descriptor. With a
+ * `zero_copy_threshold` it writes through a gather-write output stream. */
+class php_clickhouse_socket : public clickhouse::SocketBase
+{
+  public:
+    explicit php_clickhouse_socket(int fd, size_t zero_copy_threshold = 0,
+                                   std::chrono::milliseconds send_timeout = {});
+    ~php_clickhouse_socket() override;
+
+    php_clickhouse_socket(const php_clickhouse_socket &) = delete;
+    php_clickhouse_socket &operator=(const php_clickhouse_socket &) = delete;
+
+    std::unique_ptr<clickhouse::InputStream> makeInputStream() const override;
+    std::unique_ptr<clickhouse::OutputStream> makeOutputStream() const override;
+
+  private:
+    int fd_;
+    size_t zero_copy_threshold_;
+    bool zero_copy_ = false;
+    std::chrono::milliseconds send_timeout_;
+};
+
+/**
+ * Happy-eyeballs style connector (RFC 8305): resolves every configured
+ * endpoint through the DNS cache, interleaves IPv6/IPv4 candidates and starts
+ * non-blocking connects to up to `parallelism` of them, `stagger` apart. The
+ * first socket that completes the TCP handshake wins; every other attempt is
+ * closed. An attempt that has not connected within connection_connect_timeout
+ * is given up and the next candidate takes its slot. With TLS configured the
+ * winner is then wrapped by php_clickhouse_tls_connect().
+ */
+class php_clickhouse_socket_factory : public clickhouse::SocketFactory
+{
+  public:
+    php_clickhouse_socket_factory(const php_clickhouse_connect_options &options,
+                                  std::shared_ptr<php_clickhouse_connect_state> state);
+
+    std::unique_ptr<clickhouse::SocketBase> connect(const clickhouse::ClientOptions &opts,
+                                                    const clickhouse::Endpoint &endpoint) override;
+
+  private:
+    php_clickhouse_connect_options options_;
+    std::shared_ptr<php_clickhouse_connect_state> state_;
+};
+
+#endif
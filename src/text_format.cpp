@@ -0,0 +1,710 @@
+#include "src/text_format.h"
+#include "src/column_convert.h"
+
+#include "clickhouse/columns/array.h"
+#include "clickhouse/columns/date.h"
+#include "clickhouse/columns/enum.h"
+#include "clickhouse/columns/geo.h"
+#include "clickhouse/columns/lowcardinality.h"
+#include "clickhouse/columns/map.h"
+#include "clickhouse/columns/nullable.h"
+#include "clickhouse/columns/tuple.h"
+#include "clickhouse/exceptions.h"
+#include "clickhouse/types/types.h"
+
+#include "absl/numeric/int128.h"
+
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <type_traits>
+#include <arpa/inet.h> /* inet_ntop */
+
+using namespace clickhouse;
+
+namespace
+{
+
+/* Where a value is written: a top-level field of each format, or inside a
+ * ClickHouse literal such as [1,'a'] that CSV and TSV use for composites */
+enum class value_style
+{
+    csv,
+    tsv,
+    json,
+    literal,
+};
+
+enum class scalar_kind
+{
+    null,
+    number,
+    boolean,
+    string,
+};
+
+template <typename T> void append_integer(std::string &out, T value)
+{
+    char buf[32];
+    int len;
+    if (std::is_signed<T>::value) {
+        len = snprintf(buf, sizeof(buf), "%" PRId64, static_cast<int64_t>(value));
+    } else {
+        len = snprintf(buf, sizeof(buf), "%" PRIu64, static_cast<uint64_t>(value));
+    }
+    out.append(buf, static_cast<size_t>(len));
+}
+
+/* Shortest of 15 or 17 significant digits that reads back the same value */
+void append_double(std::string &out, double value, bool single)
+{
+    if (std::isnan(value)) {
+        out += "nan";
+        return;
+    }
+    if (std::isinf(value)) {
+        out += value < 0 ? "-inf" : "inf";
+        return;
+    }
+    char buf[32];
+    int digits = single ? 7 : 15;
+    int len = snprintf(buf, sizeof(buf), "%.*g", digits, value);
+    bool exact = single ? std::strtof(buf, nullptr) == static_cast<float>(value)
+                        : std::strtod(buf, nullptr) == value;
+    if (!exact) {
+        len = snprintf(buf, sizeof(buf), "%.*g", single ? 9 : 17, value);
+    }
+    out.append(buf, static_cast<size_t>(len));
+}
+
+template <typename T> void append_streamed(std::string &out, const T &value)
+{
+    std::ostringstream oss;
+    oss << value;
+    out += oss.str();
+}
+
+/* Text of a scalar ItemView of `type`, unquoted */
+scalar_kind scalar_text(const ItemView &item, const TypeRef &type, std::string &out)
+{
+    if (item.type == Type::Void) {
+        return scalar_kind::null;
+    }
+    char buf[PHP_CLICKHOUSE_VALUE_TEXT_MAX];
+
+    switch (type->GetCode()) {
+    case Type::Int8:
+        append_integer(out, item.get<int8_t>());
+        return scalar_kind::number;
+    case Type::Int16:
+        append_integer(out, item.get<int16_t>());
+        return scalar_kind::number;
+    case Type::Int32:
+    case Type::Time:
+        append_integer(out, item.get<int32_t>());
+        return scalar_kind::number;
+    case Type::Int64:
+    case Type::Time64:
+        append_integer(out, item.get<int64_t>());
+        return scalar_kind::number;
+    case Type::UInt8:
+        append_integer(out, item.get<uint8_t>());
+        return scalar_kind::number;
+    case Type::UInt16:
+        append_integer(out, item.get<uint16_t>());
+        return scalar_kind::number;
+    case Type::UInt32:
+    case Type::DateTime:
+        append_integer(out, item.get<uint32_t>());
+        return scalar_kind::number;
+    case Type::UInt64:
+        append_integer(out, item.get<uint64_t>());
+        return scalar_kind::number;
+    case Type::Int128:
+        append_streamed(out, item.get<Int128>());
+        return scalar_kind::number;
+    case Type::UInt128:
+        append_streamed(out, item.get<UInt128>());
+        return scalar_kind::number;
+    case Type::Float32:
+        append_double(out, item.get<float>(), true);
+        return scalar_kind::number;
+    case Type::Float64:
+        append_double(out, item.get<double>(), false);
+        return scalar_kind::number;
+    case Type::Bool:
+        out += item.get<uint8_t>() ? "true" : "false";
+        return scalar_kind::boolean;
+
+    case Type::Decimal:
+    case Type::Decimal32:
+    case Type::Decimal64:
+    case Type::Decimal128:
+        /* Strings in select(), numbers here: every format reads them back exactly */
+        out += php_clickhouse_decimal_text(php_clickhouse_decimal_item(item),
+                                           type->As<DecimalType>()->GetScale());
+        return scalar_kind::number;
+
+    case Type::Date:
+    case Type::Date32:
+        out.append(buf, php_clickhouse_date_text(php_clickhouse_date_item(item), buf));
+        return scalar_kind::string;
+    case Type::DateTime64:
+        out.append(buf, php_clickhouse_datetime64_text(
+                            item.get<int64_t>(), type->As<DateTime64Type>()->GetPrecision(), buf));
+        return scalar_kind::string;
+
+    case Type::Enum8:
+        out += type->As<EnumType>()->GetEnumName(item.get<int8_t>());
+        return scalar_kind::string;
+    case Type::Enum16:
+        out += type->As<EnumType>()->GetEnumName(item.get<int16_t>());
+        return scalar_kind::string;
+
+    case Type::UUID: {
+        auto data = item.AsBinaryData();
+        if (data.size() != sizeof(uint64_t) * 2) {
+            return scalar_kind::null;
+        }
+        uint64_t hi = 0;
+        uint64_t lo = 0;
+        memcpy(&hi, data.data(), sizeof(hi));
+        memcpy(&lo, data.data() + sizeof(hi), sizeof(lo));
+        out.append(buf, php_clickhouse_uuid_text(hi, lo, buf));
+        return scalar_kind::string;
+    }
+    case Type::IPv4: {
+        uint32_t ip = item.get<uint32_t>();
+        int len = snprintf(buf, sizeof(buf), "%u.%u.%u.%u", (ip >> 24) & 0xFF, (ip >> 16) & 0xFF,
+                           (ip >> 8) & 0xFF, ip & 0xFF);
+        out.append(buf, static_cast<size_t>(len));
+        return scalar_kind::string;
+    }
+    case Type::IPv6: {
+        auto data = item.AsBinaryData();
+        if (data.size() != 16 || !inet_ntop(AF_INET6, data.data(), buf, sizeof(buf))) {
+            return scalar_kind::null;
+        }
+        out += buf;
+        return scalar_kind::string;
+    }
+
+    default:
+        /* String, FixedString, JSON and anything else with a text form */
+        try {
+            out += item.get<std::string_view>();
+        } catch (...) {
+            return scalar_kind::null;
+        }
+        return scalar_kind::string;
+    }
+}
+
+/* ClickHouse's escaping of quoted literals and TSV fields */
+void append_escaped(std::string &out, std::string_view text, char quote)
+{
+    for (char c : text) {
+        switch (c) {
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\b':
+            out += "\\b";
+            break;
+        case '\f':
+            out += "\\f";
+            break;
+        case '\0':
+            out += "\\0";
+            break;
+        default:
+            if (c == quote) {
+                out += '\\';
+            }
+            out += c;
+        }
+    }
+}
+
+void append_csv_string(std::string &out, std::string_view text)
+{
+    out += '"';
+    for (char c : text) {
+        if (c == '"') {
+            out += '"';
+        }
+        out += c;
+    }
+    out += '"';
+}
+
+/* Length of the UTF-8 sequence starting at text[i], or 0 when it is invalid:
+ * truncated, overlong, a surrogate or above U+10FFFF */
+size_t utf8_sequence(std::string_view text, size_t i)
+{
+    auto byte = [&](size_t k) { return static_cast<unsigned char>(text[i + k]); };
+    auto continuation = [&](size_t k) { return (byte(k) & 0xC0) == 0x80; };
+    unsigned char lead = byte(0);
+    size_t left = text.size() - i;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        return left >= 2 && continuation(1) ? 2 : 0;
+    }
+    if (lead >= 0xE0 && lead <= 0xEF) {
+        if (left < 3 || !continuation(1) || !continuation(2)) {
+            return 0;
+        }
+        if ((lead == 0xE0 && byte(1) < 0xA0) || (lead == 0xED && byte(1) >= 0xA0)) {
+            return 0;
+        }
+        return 3;
+    }
+    if (lead >= 0xF0 && lead <= 0xF4) {
+        if (left < 4 || !continuation(1) || !continuation(2) || !continuation(3)) {
+            return 0;
+        }
+        if ((lead == 0xF0 && byte(1) < 0x90) || (lead == 0xF4 && byte(1) >= 0x90)) {
+            return 0;
+        }
+        return 4;
+    }
+    return 0;
+}
+
+/* JSON strings must be UTF-8; ClickHouse strings are any bytes */
+void append_json_string(std::string &out, std::string_view text)
+{
+    out += '"';
+    for (size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        switch (c) {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        case '\b':
+            out += "\\b";
+            break;
+        case '\f':
+            out += "\\f";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(c));
+                out += buf;
+            } else if (static_cast<unsigned char>(c) < 0x80) {
+                out += c;
+            } else {
+                size_t len = utf8_sequence(text, i);
+                if (len == 0) {
+                    throw ValidationError("Invalid UTF-8 at byte " + std::to_string(i) +
+                                          " of a string written as JSON");
+                }
+                out.append(text.data() + i, len);
+                i += len - 1;
+            }
+        }
+    }
+    out += '"';
+}
+
+/* True for an integer a JSON parser reading doubles cannot hold exactly,
+ * one beyond +-2^53 */
+bool beyond_double_precision(std::string_view number)
+{
+    if (!number.empty() && number[0] == '-') {
+        number.remove_prefix(1);
+    }
+    if (number.empty() || number.find_first_not_of("0123456789") != std::string_view::npos) {
+        return false;
+    }
+    static const std::string_view limit = "9007199254740992";
+    return number.size() > limit.size() || (number.size() == limit.size() && number > limit);
+}
+
+/* A string field or element, quoted and escaped for `style` */
+void append_string(std::string &out, std::string_view text, value_style style)
+{
+    switch (style) {
+    case value_style::csv:
+        append_csv_string(out, text);
+        break;
+    case value_style::tsv:
+        append_escaped(out, text, '\0');
+        break;
+    case value_style::json:
+        append_json_string(out, text);
+        break;
+    case value_style::literal:
+        out += '\'';
+        append_escaped(out, text, '\'');
+        out += '\'';
+        break;
+    }
+}
+
+void append_null(std::string &out, value_style style)
+{
+    switch (style) {
+    case value_style::json:
+        out += "null";
+        break;
+    case value_style::literal:
+        out += "NULL";
+        break;
+    default:
+        out += "\\N";
+        break;
+    }
+}
+
+/* ItemView and value type of a scalar column, looking through LowCardinality */
+scalar_kind scalar_column_text(const ColumnRef &col, size_t index, std::string &out)
+{
+    TypeRef type = col->Type();
+    if (type->GetCode() == Type::LowCardinality) {
+        /* Items of Nullable dictionaries are Void for NULL, as in column_convert */
+        type = type->As<LowCardinalityType>()->GetNestedType();
+        if (type->GetCode() == Type::Nullable) {
+            type = type->As<NullableType>()->GetNestedType();
+        }
+    }
+    return scalar_text(col->GetItem(index), type, out);
+}
+
+void append_scalar(std::string &out, const ColumnRef &col, size_t index, value_style style)
+{
+    size_t start = out.size();
+    scalar_kind kind = scalar_column_text(col, index, out);
+    switch (kind) {
+    case scalar_kind::null:
+        out.resize(start);
+        append_null(out, style);
+        break;
+    case scalar_kind::number:
+        if (style != value_style::json) {
+            break;
+        }
+        if (out.compare(start, std::string::npos, "nan") == 0 ||
+            out.compare(start, std::string::npos, "inf") == 0 ||
+            out.compare(start, std::string::npos, "-inf") == 0) {
+            out.resize(start);
+            out += "null";
+        } else if (beyond_double_precision(std::string_view(out).substr(start))) {
+            /* Quoted, as ClickHouse's own JSON formats quote 64-bit integers */
+            std::string text = out.substr(start);
+            out.resize(start);
+            append_json_string(out, text);
+        }
+        break;
+    case scalar_kind::boolean:
+        break;
+    case scalar_kind::string: {
+        /* Quoting needs the text moved out of the way first */
+        std::string text = out.substr(start);
+        out.resize(start);
+        append_string(out, text, style);
+        break;
+    }
+    }
+}
+
+void append_value(std::string &out, const ColumnRef &col, size_t index, value_style style);
+
+/* Array-like values: JSON arrays, or [a,b] and (a,b) literals */
+template <typename Each>
+void append_sequence(std::string &out, size_t n, bool tuple, value_style style, Each &&each)
+{
+    bool json = style == value_style::json;
+    out += json || !tuple ? '[' : '(';
+    for (size_t i = 0; i < n; ++i) {
+        if (i) {
+            out += ',';
+        }
+        each(i, json ? value_style::json : value_style::literal);
+    }
+    out += json || !tuple ? ']' : ')';
+}
+
+void append_point(std::string &out, const std::tuple<double, double> &pt, value_style style)
+{
+    append_sequence(out, 2, true, style, [&](size_t i, value_style) {
+        append_double(out, i == 0 ? std::get<0>(pt) : std::get<1>(pt), false);
+    });
+}
+
+template <typename View> void append_ring(std::string &out, const View &ring, value_style style)
+{
+    append_sequence(out, ring.size(), false, style,
+                    [&](size_t i, value_style inner) { append_point(out, ring[i], inner); });
+}
+
+template <typename View> void append_polygon(std::string &out, const View &poly, value_style style)
+{
+    append_sequence(out, poly.size(), false, style,
+                    [&](size_t i, value_style inner) { append_ring(out, poly[i], inner); });
+}
+
+/* Composite values as JSON, or as a literal for CSV and TSV to quote as a string */
+void append_composite(std::string &out, const ColumnRef &col, size_t index, value_style style)
+{
+    if (style == value_style::csv || style == value_style::tsv) {
+        std::string literal;
+        append_composite(literal, col, index, value_style::literal);
+        append_string(out, literal, style);
+        return;
+    }
+
+    switch (col->Type()->GetCode()) {
+    case Type::Array: {
+        auto slice = col->As<ColumnArray>()->GetAsColumn(index);
+        append_sequence(out, slice->Size(), false, style, [&](size_t i, value_style inner) {
+            append_value(out, slice, i, inner);
+        });
+        break;
+    }
+    case Type::Tuple: {
+        auto tuple = col->As<ColumnTuple>();
+        append_sequence(out, tuple->TupleSize(), true, style, [&](size_t i, value_style inner) {
+            append_value(out, (*tuple)[i], index, inner);
+        });
+        break;
+    }
+    case Type::Map: {
+        auto pairs = col->As<ColumnMap>()->GetAsColumn(index)->As<ColumnTuple>();
+        size_t n = pairs && pairs->TupleSize() >= 2 ? pairs->Size() : 0;
+        out += '{';
+        for (size_t i = 0; i < n; ++i) {
+            if (i) {
+                out += ',';
+            }
+            if (style == value_style::json) {
+                /* Object keys must be strings whatever the key type */
+                std::string key;
+                scalar_column_text((*pairs)[0], i, key);
+                append_json_string(out, key);
+            } else {
+                append_value(out, (*pairs)[0], i, style);
+            }
+            out += ':';
+            append_value(out, (*pairs)[1], i, style);
+        }
+        out += '}';
+        break;
+    }
+    case Type::Point:
+        append_point(out, col->As<ColumnPoint>()->At(index), style);
+        break;
+    case Type::Ring:
+        append_ring(out, col->As<ColumnRing>()->At(index), style);
+        break;
+    case Type::Polygon:
+        append_polygon(out, col->As<ColumnPolygon>()->At(index), style);
+        break;
+    case Type::MultiPolygon: {
+        auto view = col->As<ColumnMultiPolygon>()->At(index);
+        append_sequence(out, view.size(), false, style, [&](size_t i, value_style inner) {
+            append_polygon(out, view[i], inner);
+        });
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void append_value(std::string &out, const ColumnRef &col, size_t index, value_style style)
+{
+    switch (col->Type()->GetCode()) {
+    case Type::Nullable: {
+        auto nullable = col->As<ColumnNullable>();
+        if (nullable->IsNull(index)) {
+            append_null(out, style);
+        } else {
+            append_value(out, nullable->Nested(), index, style);
+        }
+        break;
+    }
+    case Type::Array:
+    case Type::Tuple:
+    case Type::Map:
+    case Type::Point:
+    case Type::Ring:
+    case Type::Polygon:
+    case Type::MultiPolygon:
+        append_composite(out, col, index, style);
+        break;
+    default:
+        append_scalar(out, col, index, style);
+        break;
+    }
+}
+
+} // namespace
+
+bool php_clickhouse_text_writer::parse(const char *name, size_t len,
+                                       php_clickhouse_text_format &format, bool &with_names)
+{
+    static const struct
+    {
+        const char *name;
+        php_clickhouse_text_format format;
+        bool with_names;
+    } formats[] = {
+        {"CSV", php_clickhouse_text_format::csv, false},
+        {"CSVWithNames", php_clickhouse_text_format::csv, true},
+        {"TSV", php_clickhouse_text_format::tsv, false},
+        {"TabSeparated", php_clickhouse_text_format::tsv, false},
+        {"TSVWithNames", php_clickhouse_text_format::tsv, true},
+        {"TabSeparatedWithNames", php_clickhouse_text_format::tsv, true},
+        {"JSONEachRow", php_clickhouse_text_format::json_each_row, false},
+        {"JSONLines", php_clickhouse_text_format::json_each_row, false},
+        {"NDJSON", php_clickhouse_text_format::json_each_row, false},
+    };
+    for (const auto &f : formats) {
+        if (strlen(f.name) == len && memcmp(f.name, name, len) == 0) {
+            format = f.format;
+            with_names = f.with_names;
+            return true;
+        }
+    }
+    return false;
+}
+
+void php_clickhouse_text_writer::header(const Block &block, std::string &out) const
+{
+    value_style style = format_ == php_clickhouse_text_format::csv ? value_style::csv
+                                                                   : value_style::tsv;
+    char delimiter = format_ == php_clickhouse_text_format::csv ? ',' : '\t';
+    for (size_t c = 0; c < block.GetColumnCount(); ++c) {
+        if (c) {
+            out += delimiter;
+        }
+        append_string(out, block.GetColumnName(c), style);
+    }
+    out += '\n';
+}
+
+void php_clickhouse_text_writer::row(const Block &block, size_t row, std::string &out) const
+{
+    size_t cols = block.GetColumnCount();
+    if (format_ == php_clickhouse_text_format::json_each_row) {
+        out += '{';
+        for (size_t c = 0; c < cols; ++c) {
+            if (c) {
+                out += ',';
+            }
+            append_json_string(out, block.GetColumnName(c));
+            out += ':';
+            append_value(out, block[c], row, value_style::json);
+        }
+        out += "}\n";
+        return;
+    }
+
+    bool csv = format_ == php_clickhouse_text_format::csv;
+    for (size_t c = 0; c < cols; ++c) {
+        if (c) {
+            out += csv ? ',' : '\t';
+        }
+        append_value(out, block[c], row, csv ? value_style::csv : value_style::tsv);
+    }
+    out += '\n';
+}
+
+void php_clickhouse_json_writer::append(const Block &block)
+{
+    size_t cols = block.GetColumnCount();
+    size_t rows = block.GetRowCount();
+    if (!columnar_) {
+        /* The header block comes first with no rows */
+        if (out_.empty()) {
+            out_ += '[';
+        }
+        for (size_t r = 0; r < rows; ++r) {
+            out_ += rows_ + r ? ",{" : "{";
+            for (size_t c = 0; c < cols; ++c) {
+                if (c) {
+                    out_ += ',';
+                }
+                append_json_string(out_, block.GetColumnName(c));
+                out_ += ':';
+                append_value(out_, block[c], r, value_style::json);
+            }
+            out_ += '}';
+        }
+        rows_ += rows;
+        return;
+    }
+
+    if (names_.empty()) {
+        for (size_t c = 0; c < cols; ++c) {
+            names_.push_back(block.GetColumnName(c));
+        }
+        columns_.resize(cols);
+    }
+    for (size_t c = 0; c < cols && c < columns_.size(); ++c) {
+        std::string &column = columns_[c];
+        for (size_t r = 0; r < rows; ++r) {
+            if (rows_ + r) {
+                column += ',';
+            }
+            append_value(column, block[c], r, value_style::json);
+        }
+    }
+    rows_ += rows;
+}
+
+std::string php_clickhouse_json_writer::finish()
+{
+    if (!columnar_) {
+        if (out_.empty()) {
+            out_ += '[';
+        }
+        out_ += ']';
+        return std::move(out_);
+    }
+
+    size_t size = 2;
+    for (size_t c = 0; c < columns_.size(); ++c) {
+        size += names_[c].size() + columns_[c].size() + 8;
+    }
+    std::string doc;
+    doc.reserve(size);
+    doc += '{';
+    for (size_t c = 0; c < columns_.size(); ++c) {
+        if (c) {
+            doc += ',';
+        }
+        append_json_string(doc, names_[c]);
+        doc += ":[";
+        doc += columns_[c];
+        doc += ']';
+        std::string().swap(columns_[c]);
+    }
+    doc += '}';
+    return doc;
+}
@@ -0,0 +1,76 @@
+#ifndef PHP_CLICKHOUSE_TEXT_FORMAT_H
+#define PHP_CLICKHOUSE_TEXT_FORMAT_H
+
+#include "clickhouse/block.h"
+
+#include <string>
+#include <vector>
+
+/* Output formats of Client::selectToStream() */
+enum class php_clickhouse_text_format
+{
+    csv,
+    tsv,
+    json_each_row,
+};
+
+/**
+ * Formats result blocks as text without going through zvals. Values take
+ * the form select() returns them in (DateTime as a Unix timestamp,
+ * DateTime64 and Date as UTC strings, Enum as its name), quoted and escaped
+ * the way ClickHouse writes the format of the same name: NULL is \N in CSV
+ * and TSV, arrays, tuples and maps become ClickHouse literals there and
+ * JSON arrays and objects in JSONEachRow.
+ */
+class php_clickhouse_text_writer
+{
+  public:
+    /* Accepts CSV, CSVWithNames, TSV, TabSeparated, TSVWithNames,
+     * TabSeparatedWithNames, JSONEachRow, JSONLines and NDJSON */
+    static bool parse(const char *name, size_t len, php_clickhouse_text_format &format,
+                      bool &with_names);
+
+    explicit php_clickhouse_text_writer(php_clickhouse_text_format format)
+        : format_(format)
+    {
+    }
+
+    /* The line of column names of the *WithNames formats */
+    void header(const clickhouse::Block &block, std::string &out) const;
+
+    /* Row `row` of `block`, newline included */
+    void row(const clickhouse::Block &block, size_t row, std::string &out) const;
+
+  private:
+    php_clickhouse_text_format format_;
+};
+
+/**
+ * Builds one JSON document from result blocks, with values in the
+ * JSONEachRow form above: an array of row objects, or with `columnar` an
+ * object of column arrays ({"col": [...]}). Used by Client::selectJson()
+ * and Block::toJson() in place of json_encode() over converted rows.
+ */
+class php_clickhouse_json_writer
+{
+  public:
+    explicit php_clickhouse_json_writer(bool columnar) : columnar_(columnar)
+    {
+    }
+
+    void append(const clickhouse::Block &block);
+
+    /* The finished document; the writer is spent afterwards */
+    std::string finish();
+
+  private:
+    bool columnar_;
+    size_t rows_ = 0;
+    /* Row form: the document so far */
+    std::string out_;
+    /* Columnar form: names from the first block and each column's values */
+    std::vector<std::string> names_;
+    std::vector<std::string> columns_;
+};
+
+#endif
@@ -0,0 +1,453 @@
+#include "src/tls.h"
+
+#include <string>
+
+std::string php_clickhouse_tls_options::context_key() const
+{
+    /* Length-prefixed so no path can be mistaken for a field separator */
+    std::string key;
+    auto add = [&key](const std::string &value) {
+        key += std::to_string(value.size());
+        key += ':';
+        key += value;
+    };
+    key += skip_verification ? '1' : '0';
+    key += use_default_ca ? '1' : '0';
+    add(ca_directory);
+    key += std::to_string(ca_files.size());
+    for (const auto &file : ca_files) {
+        add(file);
+    }
+    add(client_cert);
+    add(client_key);
+    for (int value : {context_options, min_protocol_version, max_protocol_version, host_flags}) {
+        key += std::to_string(value);
+        key += ';';
+    }
+    return key;
+}
+
+#ifdef WITH_OPENSSL
+
+#include "clickhouse/exceptions.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <unordered_map>
+
+#include <arpa/inet.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+using namespace clickhouse;
+
+using session_ptr = std::shared_ptr<SSL_SESSION>;
+using steady_clock = std::chrono::steady_clock;
+
+/* How often a cached context checks whether its files changed */
+#define TLS_FILES_RECHECK std::chrono::seconds(1)
+
+/* One shared SSL_CTX plus the newest session ticket seen per endpoint */
+struct tls_context
+{
+    std::shared_ptr<SSL_CTX> ctx;
+    std::mutex lock;
+    std::unordered_map<std::string, session_ptr> sessions;
+    /* tls_files_stamp() when the context was built, and when last compared */
+    std::string stamp;
+    steady_clock::time_point checked;
+};
+
+static std::mutex tls_lock;
+static std::unordered_map<std::string, std::shared_ptr<tls_context>> tls_contexts;
+
+/* SSL_CTX ex_data -> tls_context, SSL ex_data -> endpoint key of the connection */
+static int tls_ctx_index = -1;
+static int tls_ssl_index = -1;
+
+static void close_fd(int fd)
+{
+    while (::close(fd) == -1 && errno == EINTR) {
+    }
+}
+
+static std::string tls_last_error(const char *what)
+{
+    std::string msg(what);
+    unsigned long code = ERR_get_error();
+    if (code != 0) {
+        char buf[256];
+        ERR_error_string_n(code, buf, sizeof(buf));
+        msg += ": ";
+        msg += buf;
+    }
+    ERR_clear_error();
+    return msg;
+}
+
+static bool is_ip_literal(const std::string &host)
+{
+    unsigned char buf[sizeof(in6_addr)];
+    return inet_pton(AF_INET, host.c_str(), buf) == 1 ||
+           inet_pton(AF_INET6, host.c_str(), buf) == 1;
+}
+
+/* Inode, size and mtime of every file the context reads, so that rotated
+ * certificates and CA bundles are picked up without a restart */
+static std::string tls_files_stamp(const php_clickhouse_tls_options &options)
+{
+    std::string stamp;
+    auto add = [&stamp](const char *path) {
+        struct stat st;
+        if (!path || !*path || ::stat(path, &st) != 0) {
+            stamp += "-;";
+            return;
+        }
+        stamp += std::to_string(st.st_ino) + ':' + std::to_string(st.st_size) + ':' +
+                 std::to_string(st.st_mtime) + ';';
+    };
+    if (options.use_default_ca) {
+        const char *file = std::getenv(X509_get_default_cert_file_env());
+        const char *dir = std::getenv(X509_get_default_cert_dir_env());
+        add(file ? file : X509_get_default_cert_file());
+        add(dir ? dir : X509_get_default_cert_dir());
+    }
+    for (const auto &file : options.ca_files) {
+        add(file.c_str());
+    }
+    add(options.ca_directory.c_str());
+    add(options.client_cert.c_str());
+    add(options.client_key.c_str());
+    return stamp;
+}
+
+/* New-session callback: keep the ticket for the endpoint this connection went
+ * to. With TLS 1.3 tickets arrive after the handshake, on a later SSL_read. */
+static int tls_store_session(SSL *ssl, SSL_SESSION *session)
+{
+    auto *context =
+        static_cast<tls_context *>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), tls_ctx_index));
+    auto *endpoint = static_cast<const std::string *>(SSL_get_ex_data(ssl, tls_ssl_index));
+    if (!context || !endpoint || !SSL_SESSION_is_resumable(session)) {
+        return 0;
+    }
+
+    session_ptr owned(session, SSL_SESSION_free);
+    std::lock_guard<std::mutex> guard(context->lock);
+    context->sessions[*endpoint] = std::move(owned);
+    return 1; /* we took the reference */
+}
+
+static std::shared_ptr<tls_context> tls_build_context(const php_clickhouse_tls_options &options)
+{
+    std::shared_ptr<SSL_CTX> ctx(SSL_CTX_new(TLS_client_method()), SSL_CTX_free);
+    if (!ctx) {
+        throw OpenSSLError(tls_last_error("failed to create SSL context"));
+    }
+
+    if (options.use_default_ca && SSL_CTX_set_default_verify_paths(ctx.get()) != 1) {
+        throw OpenSSLError(tls_last_error("failed to load default CA locations"));
+    }
+    for (const auto &file : options.ca_files) {
+        if (SSL_CTX_load_verify_locations(ctx.get(), file.c_str(), nullptr) != 1) {
+            throw OpenSSLError(tls_last_error(("failed to load CA file " + file).c_str()));
+        }
+    }
+    if (!options.ca_directory.empty() &&
+        SSL_CTX_load_verify_locations(ctx.get(), nullptr, options.ca_directory.c_str()) != 1) {
+        throw OpenSSLError(
+            tls_last_error(("failed to load CA directory " + options.ca_directory).c_str()));
+    }
+    if (!options.client_cert.empty() &&
+        SSL_CTX_use_certificate_chain_file(ctx.get(), options.client_cert.c_str()) != 1) {
+        throw OpenSSLError(tls_last_error("failed to load client certificate"));
+    }
+    if (!options.client_key.empty() &&
+        SSL_CTX_use_PrivateKey_file(ctx.get(), options.client_key.c_str(), SSL_FILETYPE_PEM) !=
+            1) {
+        throw OpenSSLError(tls_last_error("failed to load client key"));
+    }
+
+    if (options.context_options != -1) {
+        SSL_CTX_set_options(ctx.get(), static_cast<unsigned long>(options.context_options));
+    }
+    int min_version = options.min_protocol_version != -1 ? options.min_protocol_version
+                                                         : TLS1_2_VERSION;
+    if (SSL_CTX_set_min_proto_version(ctx.get(), min_version) != 1) {
+        throw OpenSSLError(tls_last_error("failed to set minimum TLS protocol version"));
+    }
+    if (options.max_protocol_version != -1 &&
+        SSL_CTX_set_max_proto_version(ctx.get(), options.max_protocol_version) != 1) {
+        throw OpenSSLError(tls_last_error("failed to set maximum TLS protocol version"));
+    }
+
+    SSL_CTX_set_verify(ctx.get(), options.skip_verification ? SSL_VERIFY_NONE : SSL_VERIFY_PEER,
+                       nullptr);
+    SSL_CTX_set_mode(ctx.get(), SSL_MODE_AUTO_RETRY);
+
+    /* Sessions live in our per-endpoint map, not in OpenSSL's internal cache,
+     * which is keyed by session id and useless for picking one on the client */
+    SSL_CTX_set_session_cache_mode(ctx.get(),
+                                   SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(ctx.get(), tls_store_session);
+
+    auto context = std::make_shared<tls_context>();
+    context->ctx = std::move(ctx);
+    SSL_CTX_set_ex_data(context->ctx.get(), tls_ctx_index, context.get());
+    return context;
+}
+
+static std::shared_ptr<tls_context> tls_get_context(const php_clickhouse_tls_options &options)
+{
+    std::lock_guard<std::mutex> guard(tls_lock);
+    if (tls_ctx_index == -1) {
+        tls_ctx_index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+        tls_ssl_index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    }
+
+    std::string key = options.context_key();
+    auto now = steady_clock::now();
+    auto it = tls_contexts.find(key);
+    std::string stamp;
+    if (it != tls_contexts.end()) {
+        tls_context &cached = *it->second;
+        if (now - cached.checked < TLS_FILES_RECHECK) {
+            return it->second;
+        }
+        cached.checked = now;
+        stamp = tls_files_stamp(options);
+        if (stamp == cached.stamp) {
+            return it->second;
+        }
+        /* Replaced below; open connections keep the old one alive */
+    } else {
+        stamp = tls_files_stamp(options);
+    }
+
+    /* Built under the lock: concurrent first connects share one CA load */
+    auto context = tls_build_context(options);
+    context->stamp = std::move(stamp);
+    context->checked = now;
+    tls_contexts[key] = context;
+    return context;
+}
+
+/* Map a failed SSL_read/SSL_write to the exception clickhouse-cpp would raise.
+ * Socket-level errors (timeouts, resets) stay std::system_error so they reach
+ * PHP as ConnectionException like on plain connections. */
+[[noreturn]] static void tls_io_error(SSL *ssl, int rc, const char *what)
+{
+    int err = SSL_get_error(ssl, rc);
+    if (err == SSL_ERROR_SYSCALL || err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) {
+        int saved = errno != 0 ? errno : ECONNRESET;
+        ERR_clear_error();
+        throw std::system_error(saved, std::system_category(), what);
+    }
+    throw OpenSSLError(tls_last_error(what));
+}
+
+class tls_input : public InputStream
+{
+  public:
+    explicit tls_input(SSL *ssl) : ssl_(ssl)
+    {
+    }
+
+  protected:
+    size_t DoRead(void *buf, size_t len) override
+    {
+        size_t read = 0;
+        errno = 0;
+        int rc = SSL_read_ex(ssl_, buf, len, &read);
+        if (rc == 1) {
+            return read;
+        }
+        if (SSL_get_error(ssl_, rc) == SSL_ERROR_ZERO_RETURN) {
+            return 0;
+        }
+        tls_io_error(ssl_, rc, "fail to read from TLS connection");
+    }
+
+    bool Skip(size_t bytes) override
+    {
+        char buf[4096];
+        while (bytes > 0) {
+            size_t n = DoRead(buf, bytes < sizeof(buf) ? bytes : sizeof(buf));
+            if (n == 0) {
+                return false;
+            }
+            bytes -= n;
+        }
+        return true;
+    }
+
+  private:
+    SSL *ssl_;
+};
+
+class tls_output : public OutputStream
+{
+  public:
+    explicit tls_output(SSL *ssl) : ssl_(ssl)
+    {
+    }
+
+  protected:
+    size_t DoWrite(const void *data, size_t len) override
+    {
+        size_t written = 0;
+        errno = 0;
+        int rc = SSL_write_ex(ssl_, data, len, &written);
+        if (rc != 1) {
+            tls_io_error(ssl_, rc, "fail to write to TLS connection");
+        }
+        return written;
+    }
+
+  private:
+    SSL *ssl_;
+};
+
+class tls_socket : public SocketBase
+{
+  public:
+    tls_socket(int fd, std::shared_ptr<tls_context> context, std::string endpoint)
+        : fd_(fd), context_(std::move(context)), endpoint_(std::move(endpoint))
+    {
+    }
+
+    ~tls_socket() override
+    {
+        if (ssl_) {
+            if (established_) {
+                SSL_shutdown(ssl_); /* best effort close_notify, no wait for the peer's */
+            }
+            SSL_free(ssl_);
+        }
+        close_fd(fd_);
+    }
+
+    tls_socket(const tls_socket &) = delete;
+    tls_socket &operator=(const tls_socket &) = delete;
+
+    void handshake(const Endpoint &endpoint, const php_clickhouse_tls_options &options)
+    {
+        ssl_ = SSL_new(context_->ctx.get());
+        if (!ssl_ || SSL_set_fd(ssl_, fd_) != 1) {
+            throw OpenSSLError(tls_last_error("failed to create SSL connection"));
+        }
+        /* endpoint_ outlives ssl_, the session callback may fire on any read */
+        SSL_set_ex_data(ssl_, tls_ssl_index, &endpoint_);
+
+        bool ip_literal = is_ip_literal(endpoint.host);
+        if (options.use_sni && !ip_literal) {
+            SSL_set_tlsext_host_name(ssl_, endpoint.host.c_str());
+        }
+        if (!options.skip_verification) {
+            X509_VERIFY_PARAM *param = SSL_get0_param(ssl_);
+            if (options.host_flags != -1) {
+                X509_VERIFY_PARAM_set_hostflags(param,
+                                                static_cast<unsigned int>(options.host_flags));
+            }
+            int rc = ip_literal ? X509_VERIFY_PARAM_set1_ip_asc(param, endpoint.host.c_str())
+                                : X509_VERIFY_PARAM_set1_host(param, endpoint.host.c_str(), 0);
+            if (rc != 1) {
+                throw OpenSSLError(tls_last_error("failed to set expected host name"));
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(context_->lock);
+            auto it = context_->sessions.find(endpoint_);
+            if (it != context_->sessions.end()) {
+                SSL_set_session(ssl_, it->second.get());
+            }
+        }
+
+        errno = 0;
+        int rc = SSL_connect(ssl_);
+        if (rc != 1) {
+            /* A rejected ticket must not be offered again */
+            std::lock_guard<std::mutex> guard(context_->lock);
+            context_->sessions.erase(endpoint_);
+            if (SSL_get_error(ssl_, rc) == SSL_ERROR_SYSCALL) {
+                tls_io_error(ssl_, rc, "TLS handshake failed");
+            }
+            long verify = SSL_get_verify_result(ssl_);
+            if (verify != X509_V_OK) {
+                ERR_clear_error();
+                throw OpenSSLError(std::string("TLS certificate verification failed: ") +
+                                   X509_verify_cert_error_string(verify));
+            }
+            throw OpenSSLError(tls_last_error("TLS handshake failed"));
+        }
+        established_ = true;
+    }
+
+    std::unique_ptr<InputStream> makeInputStream() const override
+    {
+        return std::make_unique<tls_input>(ssl_);
+    }
+
+    std::unique_ptr<OutputStream> makeOutputStream() const override
+    {
+        return std::make_unique<tls_output>(ssl_);
+    }
+
+  private:
+    int fd_;
+    std::shared_ptr<tls_context> context_;
+    std::string endpoint_;
+    SSL *ssl_ = nullptr;
+    bool established_ = false;
+};
+
+std::unique_ptr<SocketBase> php_clickhouse_tls_connect(int fd, const Endpoint &endpoint,
+                                                       const php_clickhouse_tls_options &options)
+{
+    std::shared_ptr<tls_context> context;
+    try {
+        context = tls_get_context(options);
+    } catch (...) {
+        close_fd(fd);
+        throw;
+    }
+
+    auto socket = std::make_unique<tls_socket>(fd, std::move(context),
+                                               endpoint.host + ':' + std::to_string(endpoint.port));
+    socket->handshake(endpoint, options);
+    return socket;
+}
+
+void php_clickhouse_tls_shutdown()
+{
+    std::lock_guard<std::mutex> guard(tls_lock);
+    tls_contexts.clear();
+}
+
+#else
+
+#include "clickhouse/exceptions.h"
+
+#include <unistd.h>
+
+std::unique_ptr<clickhouse::SocketBase>
+php_clickhouse_tls_connect(int fd, const clickhouse::Endpoint &, const php_clickhouse_tls_options &)
+{
+    ::close(fd);
+    throw clickhouse::OpenSSLError("Library was built with no SSL support");
+}
+
+void php_clickhouse_tls_shutdown()
+{
+}
+
+#endif
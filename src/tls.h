@@ -0,0 +1,47 @@
+#ifndef PHP_CLICKHOUSE_TLS_H
+#define PHP_CLICKHOUSE_TLS_H
+
+#include "clickhouse/base/socket.h"
+#include "clickhouse/client.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/* TLS settings as parsed from the ClientOptions `ssl` array */
+struct php_clickhouse_tls_options
+{
+    bool skip_verification = false;
+    bool use_default_ca = true;
+    bool use_sni = true;
+    std::string ca_directory;
+    std::vector<std::string> ca_files;
+    std::string client_cert;
+    std::string client_key;
+    /* Carried over from clickhouse-cpp's SSLOptions; -1 leaves OpenSSL's
+     * value, except that the minimum protocol defaults to TLS 1.2 */
+    int context_options = -1;
+    int min_protocol_version = -1;
+    int max_protocol_version = -1;
+    int host_flags = -1;
+
+    /* Identity of the SSL_CTX these options produce */
+    std::string context_key() const;
+};
+
+/**
+ * Run the TLS handshake on an already connected descriptor and wrap it.
+ * SSL contexts are built once per distinct option set and shared process-wide
+ * (CA bundles are read once), and the last session ticket of every endpoint is
+ * offered again so reconnects and new clients get an abbreviated handshake.
+ * A context is rebuilt when one of its CA, certificate or key files changes.
+ * Takes ownership of `fd`, also on failure.
+ */
+std::unique_ptr<clickhouse::SocketBase>
+php_clickhouse_tls_connect(int fd, const clickhouse::Endpoint &endpoint,
+                           const php_clickhouse_tls_options &options);
+
+/* Release every cached context and session (MSHUTDOWN) */
+void php_clickhouse_tls_shutdown();
+
+#endif
@@ -0,0 +1,473 @@
+#include "src/uring_socket.h"
+
+#ifdef HAVE_LIBURING
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <liburing.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace clickhouse;
+
+/* Receive buffers handed to the kernel; the multishot receive fills them in turn */
+#define URING_RECV_BUFFERS 16
+#define URING_RECV_BUFFER_SIZE (64 * 1024)
+#define URING_BUFFER_GROUP 0
+/* Writes smaller than this are copied and sent with the next batch */
+#define URING_SEND_STAGE_SIZE (256 * 1024)
+#define URING_ENTRIES 32
+
+/* user_data of the receive and cancel requests; sends use their batch index */
+static const uint64_t uring_recv_tag = UINT64_MAX;
+static const uint64_t uring_cancel_tag = UINT64_MAX - 1;
+
+/* Set once io_uring turned out to be missing or forbidden in this process */
+static std::atomic<bool> uring_unavailable{false};
+
+static void close_fd(int fd)
+{
+    while (::close(fd) == -1 && errno == EINTR) {
+    }
+}
+
+static __kernel_timespec *uring_timeout(__kernel_timespec &ts, std::chrono::milliseconds timeout)
+{
+    if (timeout.count() <= 0) {
+        return nullptr;
+    }
+    ts.tv_sec = static_cast<long long>(timeout.count() / 1000);
+    ts.tv_nsec = static_cast<long long>((timeout.count() % 1000) * 1000000);
+    return &ts;
+}
+
+/* One connection's ring, shared by its input and output stream. Like the
+ * socket it replaces, it is only used by one thread at a time. */
+class uring_connection
+{
+  public:
+    uring_connection(int fd, const ClientOptions &opts)
+        : fd_(fd), recv_timeout_(opts.connection_recv_timeout),
+          send_timeout_(opts.connection_send_timeout)
+    {
+    }
+
+    ~uring_connection()
+    {
+        if (ring_ready_) {
+            stop_receive();
+            if (buf_ring_) {
+                io_uring_free_buf_ring(&ring_, buf_ring_, URING_RECV_BUFFERS, URING_BUFFER_GROUP);
+            }
+            io_uring_queue_exit(&ring_);
+        }
+        if (owns_fd_) {
+            close_fd(fd_);
+        }
+    }
+
+    uring_connection(const uring_connection &) = delete;
+    uring_connection &operator=(const uring_connection &) = delete;
+
+    /* Returns 0 or the negative errno of the step that failed */
+    int init()
+    {
+        int rc = io_uring_queue_init(URING_ENTRIES, &ring_, IORING_SETUP_COOP_TASKRUN);
+        if (rc == -EINVAL) {
+            rc = io_uring_queue_init(URING_ENTRIES, &ring_, 0);
+        }
+        if (rc < 0) {
+            return rc;
+        }
+        ring_ready_ = true;
+
+        buf_ring_ = io_uring_setup_buf_ring(&ring_, URING_RECV_BUFFERS, URING_BUFFER_GROUP, 0, &rc);
+        if (!buf_ring_) {
+            return rc < 0 ? rc : -ENOMEM;
+        }
+        recv_memory_.reset(new char[URING_RECV_BUFFERS * URING_RECV_BUFFER_SIZE]);
+        for (unsigned i = 0; i < URING_RECV_BUFFERS; ++i) {
+            io_uring_buf_ring_add(buf_ring_, buffer(i), URING_RECV_BUFFER_SIZE, i,
+                                  io_uring_buf_ring_mask(URING_RECV_BUFFERS), i);
+        }
+        io_uring_buf_ring_advance(buf_ring_, URING_RECV_BUFFERS);
+
+        stage_.reset(new char[URING_SEND_STAGE_SIZE]);
+        owns_fd_ = true;
+        return 0;
+    }
+
+    size_t receive(void *buf, size_t len)
+    {
+        while (received_.empty()) {
+            if (recv_error_) {
+                throw std::system_error(recv_error_, std::system_category(),
+                                        "can't receive string data");
+            }
+            if (eof_) {
+                throw std::system_error(ECONNRESET, std::system_category(), "closed");
+            }
+            if (!armed_) {
+                arm_receive();
+            }
+            if (!wait(recv_timeout_)) {
+                throw std::system_error(ETIMEDOUT, std::system_category(),
+                                        "can't receive string data");
+            }
+        }
+
+        chunk &c = received_.front();
+        size_t n = std::min(len, c.len - c.offset);
+        std::memcpy(buf, buffer(c.bid) + c.offset, n);
+        c.offset += n;
+        if (c.offset == c.len) {
+            recycle(c.bid);
+            received_.pop_front();
+        }
+        return n;
+    }
+
+    size_t write(const void *data, size_t len)
+    {
+        if (staged_ + len <= URING_SEND_STAGE_SIZE) {
+            std::memcpy(stage_.get() + staged_, data, len);
+            staged_ += len;
+            return len;
+        }
+        /* Too big to stage: send it from the caller's memory behind what is staged */
+        std::vector<segment> batch;
+        if (staged_) {
+            batch.push_back({stage_.get(), staged_});
+        }
+        batch.push_back({static_cast<const char *>(data), len});
+        send(batch);
+        staged_ = 0;
+        return len;
+    }
+
+    void flush()
+    {
+        if (!staged_) {
+            return;
+        }
+        std::vector<segment> batch{{stage_.get(), staged_}};
+        staged_ = 0;
+        send(batch);
+    }
+
+  private:
+    struct chunk
+    {
+        unsigned bid;
+        size_t len;
+        size_t offset;
+    };
+
+    struct segment
+    {
+        const char *data;
+        size_t len;
+    };
+
+    char *buffer(unsigned bid)
+    {
+        return recv_memory_.get() + static_cast<size_t>(bid) * URING_RECV_BUFFER_SIZE;
+    }
+
+    void recycle(unsigned bid)
+    {
+        io_uring_buf_ring_add(buf_ring_, buffer(bid), URING_RECV_BUFFER_SIZE, bid,
+                              io_uring_buf_ring_mask(URING_RECV_BUFFERS), 0);
+        io_uring_buf_ring_advance(buf_ring_, 1);
+    }
+
+    io_uring_sqe *next_sqe()
+    {
+        io_uring_sqe *sqe = io_uring_get_sqe(&ring_);
+        if (!sqe) {
+            io_uring_submit(&ring_);
+            sqe = io_uring_get_sqe(&ring_);
+        }
+        if (!sqe) {
+            throw std::system_error(EBUSY, std::system_category(), "io_uring queue is full");
+        }
+        return sqe;
+    }
+
+    /* One multishot receive stays armed across packets and queries. Kernels
+     * without it (before 6.0) get a single-shot receive per wakeup. */
+    void arm_receive()
+    {
+        io_uring_sqe *sqe = next_sqe();
+        if (multishot_) {
+            io_uring_prep_recv_multishot(sqe, fd_, nullptr, 0, 0);
+        } else {
+            io_uring_prep_recv(sqe, fd_, nullptr, URING_RECV_BUFFER_SIZE, 0);
+        }
+        sqe->flags |= IOSQE_BUFFER_SELECT;
+        sqe->buf_group = URING_BUFFER_GROUP;
+        io_uring_sqe_set_data64(sqe, uring_recv_tag);
+        armed_ = true;
+    }
+
+    void complete(const io_uring_cqe *cqe)
+    {
+        uint64_t tag = io_uring_cqe_get_data64(cqe);
+        if (tag == uring_cancel_tag) {
+            return;
+        }
+        if (tag != uring_recv_tag) {
+            if (tag < send_results_.size()) {
+                send_results_[tag] = cqe->res;
+                --sends_pending_;
+            }
+            return;
+        }
+
+        if (!(cqe->flags & IORING_CQE_F_MORE)) {
+            armed_ = false;
+        }
+        if (cqe->res > 0) {
+            received_.push_back({cqe->flags >> IORING_CQE_BUFFER_SHIFT,
+                                 static_cast<size_t>(cqe->res), 0});
+            received_any_ = true;
+        } else if (cqe->res == 0) {
+            eof_ = true;
+        } else if (cqe->res == -EINVAL && multishot_ && !received_any_) {
+            multishot_ = false;
+        } else if (cqe->res != -ENOBUFS && cqe->res != -ECANCELED) {
+            /* Out of buffers only needs a re-arm once the queue is drained */
+            recv_error_ = -cqe->res;
+        }
+    }
+
+    /* Submit what is queued, wait for at least one completion and process
+     * every completion that is ready. Returns false on timeout. */
+    bool wait(std::chrono::milliseconds timeout)
+    {
+        __kernel_timespec ts{};
+        __kernel_timespec *limit = uring_timeout(ts, timeout);
+        io_uring_cqe *cqe = nullptr;
+        int rc;
+        do {
+            rc = io_uring_submit_and_wait_timeout(&ring_, &cqe, 1, limit, nullptr);
+        } while (rc == -EINTR);
+        if (rc < 0 && rc != -ETIME) {
+            throw std::system_error(-rc, std::system_category(), "io_uring wait failed");
+        }
+
+        unsigned head;
+        unsigned seen = 0;
+        io_uring_for_each_cqe(&ring_, head, cqe)
+        {
+            complete(cqe);
+            ++seen;
+        }
+        io_uring_cq_advance(&ring_, seen);
+        return seen > 0;
+    }
+
+    /* Send the segments as one chain of linked sends, submitted together.
+     * A short send breaks the chain; what is left is sent again. */
+    void send(std::vector<segment> &batch)
+    {
+        size_t total = 0;
+        for (const auto &s : batch) {
+            total += s.len;
+        }
+
+        while (!batch.empty()) {
+            send_results_.assign(batch.size(), 0);
+            sends_pending_ = batch.size();
+            for (size_t i = 0; i < batch.size(); ++i) {
+                io_uring_sqe *sqe = next_sqe();
+                io_uring_prep_send(sqe, fd_, batch[i].data, batch[i].len,
+                                   MSG_NOSIGNAL | MSG_WAITALL);
+                if (i + 1 < batch.size()) {
+                    sqe->flags |= IOSQE_IO_LINK;
+                }
+                io_uring_sqe_set_data64(sqe, i);
+            }
+
+            while (sends_pending_ > 0) {
+                if (!wait(send_timeout_)) {
+                    /* The sends may still read the caller's memory: fail them
+                     * and collect them before giving up */
+                    ::shutdown(fd_, SHUT_RDWR);
+                    while (sends_pending_ > 0) {
+                        wait(std::chrono::milliseconds(0));
+                    }
+                    throw std::system_error(ETIMEDOUT, std::system_category(),
+                                            "fail to send " + std::to_string(total) +
+                                                " bytes of data");
+                }
+            }
+
+            std::vector<segment> rest;
+            for (size_t i = 0; i < batch.size(); ++i) {
+                int res = send_results_[i];
+                if (res == -ECANCELED) {
+                    rest.push_back(batch[i]);
+                } else if (res <= 0) {
+                    throw std::system_error(res ? -res : EPIPE, std::system_category(),
+                                            "fail to send " + std::to_string(total) +
+                                                " bytes of data");
+                } else if (static_cast<size_t>(res) < batch[i].len) {
+                    rest.push_back({batch[i].data + res, batch[i].len - res});
+                }
+            }
+            batch.swap(rest);
+        }
+        send_results_.clear();
+    }
+
+    /* The armed receive writes into recv_memory_: cancel it and wait for its
+     * last completion before the buffers go away */
+    void stop_receive()
+    {
+        if (!armed_) {
+            return;
+        }
+        try {
+            io_uring_sqe *sqe = next_sqe();
+            io_uring_prep_cancel64(sqe, uring_recv_tag, 0);
+            io_uring_sqe_set_data64(sqe, uring_cancel_tag);
+            while (armed_ && wait(std::chrono::milliseconds(1000))) {
+            }
+        } catch (...) {
+        }
+    }
+
+    int fd_;
+    bool owns_fd_ = false;
+    std::chrono::milliseconds recv_timeout_;
+    std::chrono::milliseconds send_timeout_;
+
+    io_uring ring_{};
+    bool ring_ready_ = false;
+    io_uring_buf_ring *buf_ring_ = nullptr;
+    std::unique_ptr<char[]> recv_memory_;
+
+    std::deque<chunk> received_;
+    bool armed_ = false;
+    bool multishot_ = true;
+    bool received_any_ = false;
+    bool eof_ = false;
+    int recv_error_ = 0;
+
+    std::unique_ptr<char[]> stage_;
+    size_t staged_ = 0;
+    std::vector<int> send_results_;
+    size_t sends_pending_ = 0;
+};
+
+class uring_input : public InputStream
+{
+  public:
+    explicit uring_input(std::shared_ptr<uring_connection> conn) : conn_(std::move(conn))
+    {
+    }
+
+    bool Skip(size_t) override
+    {
+        return false;
+    }
+
+  protected:
+    size_t DoRead(void *buf, size_t len) override
+    {
+        return conn_->receive(buf, len);
+    }
+
+  private:
+    std::shared_ptr<uring_connection> conn_;
+};
+
+class uring_output : public OutputStream
+{
+  public:
+    explicit uring_output(std::shared_ptr<uring_connection> conn) : conn_(std::move(conn))
+    {
+    }
+
+  protected:
+    size_t DoWrite(const void *data, size_t len) override
+    {
+        return conn_->write(data, len);
+    }
+
+    void DoFlush() override
+    {
+        conn_->flush();
+    }
+
+  private:
+    std::shared_ptr<uring_connection> conn_;
+};
+
+class uring_socket : public SocketBase
+{
+  public:
+    explicit uring_socket(std::shared_ptr<uring_connection> conn) : conn_(std::move(conn))
+    {
+    }
+
+    std::unique_ptr<InputStream> makeInputStream() const override
+    {
+        return std::make_unique<uring_input>(conn_);
+    }
+
+    std::unique_ptr<OutputStream> makeOutputStream() const override
+    {
+        return std::make_unique<uring_output>(conn_);
+    }
+
+  private:
+    std::shared_ptr<uring_connection> conn_;
+};
+
+bool php_clickhouse_uring_compiled()
+{
+    return true;
+}
+
+std::unique_ptr<SocketBase> php_clickhouse_uring_connect(int fd, const ClientOptions &opts)
+{
+    if (uring_unavailable.load(std::memory_order_relaxed)) {
+        return nullptr;
+    }
+
+    auto conn = std::make_shared<uring_connection>(fd, opts);
+    int rc = conn->init();
+    if (rc != 0) {
+        /* Missing syscall or seccomp: stop trying; anything else (memlock
+         * limits, too old for buffer rings) is retried per connection */
+        if (rc == -ENOSYS || rc == -EPERM || rc == -EINVAL) {
+            uring_unavailable.store(true, std::memory_order_relaxed);
+        }
+        return nullptr;
+    }
+    return std::make_unique<uring_socket>(std::move(conn));
+}
+
+#else
+
+bool php_clickhouse_uring_compiled()
+{
+    return false;
+}
+
+std::unique_ptr<clickhouse::SocketBase>
+php_clickhouse_uring_connect(int, const clickhouse::ClientOptions &)
+{
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef PHP_CLICKHOUSE_URING_SOCKET_H
+#define PHP_CLICKHOUSE_URING_SOCKET_H
+
+#include "clickhouse/base/socket.h"
+#include "clickhouse/client.h"
+
+#include <memory>
+
+/* The extension was built against liburing */
+bool php_clickhouse_uring_compiled();
+
+/**
+ * Wrap a connected plain TCP descriptor in an io_uring transport: received
+ * data lands in a ring of kernel-provided buffers filled by one multishot
+ * receive, and everything written between two flushes is sent as one batch
+ * of linked sends. Returns null, leaving `fd` untouched, when io_uring is not
+ * available (not compiled in, kernel too old, or blocked by seccomp); the
+ * caller then uses a plain socket. Takes ownership of `fd` on success.
+ */
+std::unique_ptr<clickhouse::SocketBase>
+php_clickhouse_uring_connect(int fd, const clickhouse::ClientOptions &opts);
+
+#endif
@@ -91,8 +91,8 @@ echo "OK\n";
 --EXPECT--
 bool(true)
 bool(true)
-Constructor parameters: 20
-Extended parameters: endpoints, tcpKeepAliveIdleSeconds, tcpKeepAliveIntervalSeconds, tcpKeepAliveCount, maxCompressionChunkSize
+Constructor parameters: 31
+Extended parameters: endpoints, tcpKeepAliveIdleSeconds, tcpKeepAliveIntervalSeconds, tcpKeepAliveCount, maxCompressionChunkSize, connectParallelism, connectStaggerMs, dnsCacheTtlSeconds, dnsNegativeTtlSeconds, lazyConnect, hedgeDelayMs, readAheadBlocks, ioUring, zeroCopyThreshold, blockMemoryBudget, memoryLimitFraction
 bool(true)
 bool(true)
 OK
@@ -13,6 +13,7 @@ use ClickHouse\Driver\Type;
 var_dump(clickhouse_case_value(CompressionMethod::None));
 var_dump(clickhouse_case_value(CompressionMethod::LZ4));
 var_dump(clickhouse_case_value(CompressionMethod::ZSTD));
+var_dump(clickhouse_case_value(CompressionMethod::Adaptive));
 
 // Type enum — spot check key values
 var_dump(clickhouse_case_value(Type::Int8));
@@ -35,6 +36,7 @@ var_dump(clickhouse_enum_like_from(CompressionMethod::class, 1) === CompressionM
 int(-1)
 int(1)
 int(2)
+int(3)
 int(1)
 int(8)
 int(11)
@@ -9,6 +9,8 @@ use ClickHouse\Driver\Exception\ConnectionException;
 use ClickHouse\Driver\Exception\ServerException;
 use ClickHouse\Driver\Exception\ProtocolException;
 use ClickHouse\Driver\Exception\ValidationException;
+use ClickHouse\Driver\Exception\QueryTimeoutException;
+use ClickHouse\Driver\Exception\MemoryLimitException;
 
 // ClickHouseException extends Exception
 $e = new ClickHouseException('test');
@@ -29,6 +31,14 @@ var_dump(method_exists($e, 'getClickHouseCode'));
 $e = new ProtocolException('proto');
 var_dump($e instanceof ClickHouseException);
 
+// QueryTimeoutException extends ClickHouseException
+$e = new QueryTimeoutException('timeout');
+var_dump($e instanceof ClickHouseException);
+
+// MemoryLimitException extends ClickHouseException
+$e = new MemoryLimitException('memory');
+var_dump($e instanceof ClickHouseException);
+
 // ValidationException extends InvalidArgumentException
 $e = new ValidationException('val');
 var_dump($e instanceof \InvalidArgumentException);
@@ -44,3 +54,5 @@ bool(true)
 bool(true)
 bool(true)
 bool(true)
+bool(true)
+bool(true)
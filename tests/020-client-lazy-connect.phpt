@@ -0,0 +1,44 @@
+--TEST--
+ClientOptions lazyConnect defers the connection to the first call
+--EXTENSIONS--
+clickhouse
+--FILE--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+
+use ClickHouse\Driver\Client;
+use ClickHouse\Driver\Exception\ConnectionException;
+
+$opts = clickhouse_test_options([
+    'host' => '192.0.2.1',  // RFC 5737 TEST-NET, guaranteed unreachable
+    'port' => 19000,
+    'sendRetries' => 0,
+    'retryTimeoutSeconds' => 0,
+    'connectTimeoutMs' => 300,
+    'lazyConnect' => true,
+]);
+
+$client = new Client($opts);
+echo "Constructed without connecting\n";
+var_dump($client->getCurrentEndpoint());
+
+// A reset before first use keeps the client lazy.
+$client->resetConnection();
+
+for ($i = 0; $i < 2; $i++) {
+    try {
+        $client->ping();
+        echo "FAIL: should have thrown\n";
+    } catch (ConnectionException $e) {
+        echo "Connect attempt $i failed on first use\n";
+    }
+}
+
+echo "OK\n";
+?>
+--EXPECT--
+Constructed without connecting
+NULL
+Connect attempt 0 failed on first use
+Connect attempt 1 failed on first use
+OK
@@ -0,0 +1,74 @@
+--TEST--
+Column::toBinary() and Column::fromBinary() with packed fixed-width values
+--EXTENSIONS--
+clickhouse
+--FILE--
+<?php
+use ClickHouse\Driver\Column;
+
+$col = Column::fromBinary('Float64', pack('e*', 1.5, -2.25, 1e10));
+var_dump($col->size(), $col->toArray());
+var_dump($col->toBinary() === pack('e*', 1.5, -2.25, 1e10));
+
+var_dump(Column::create('Int32', [1, -1, 2147483647])->toBinary() === pack('V*', 1, 0xFFFFFFFF, 0x7FFFFFFF));
+var_dump(Column::create('UInt16', [0, 65535])->toBinary() === pack('v*', 0, 65535));
+var_dump(Column::fromBinary('DateTime', pack('V', 1704067200))->at(0));
+var_dump(Column::fromBinary('FixedString(3)', 'abcdef')->toArray());
+
+/* Wider types keep their Native width */
+var_dump(strlen(Column::create('Decimal(18,4)', ['1.5', '2', '-3'])->toBinary()));
+var_dump(strlen(Column::create('UUID', ['00000000-0000-0000-0000-000000000001'])->toBinary()));
+$ticks = Column::create('DateTime64(3)', ['2024-01-01 00:00:00.000', '2024-01-01 00:00:01.500']);
+var_dump(strlen($ticks->toBinary()));
+
+$copy = Column::fromBinary('Decimal(18,4)', Column::create('Decimal(18,4)', ['1.5', '-3'])->toBinary());
+var_dump($copy->toArray() === Column::create('Decimal(18,4)', ['1.5', '-3'])->toArray());
+
+var_dump(Column::fromBinary('UInt64', '')->size());
+var_dump(Column::create('Int8', [])->toBinary());
+
+foreach ([['String', 'abc'], ['Int32', 'abc'], ['NoSuchType', '']] as [$type, $bytes]) {
+    try {
+        Column::fromBinary($type, $bytes);
+    } catch (ClickHouse\Driver\Exception\ValidationException $e) {
+        echo $e->getMessage(), "\n";
+    }
+}
+try {
+    Column::create('Nullable(Int32)', [1, null])->toBinary();
+} catch (ClickHouse\Driver\Exception\ValidationException $e) {
+    echo $e->getMessage(), "\n";
+}
+echo "OK\n";
+?>
+--EXPECT--
+int(3)
+array(3) {
+  [0]=>
+  float(1.5)
+  [1]=>
+  float(-2.25)
+  [2]=>
+  float(10000000000)
+}
+bool(true)
+bool(true)
+bool(true)
+int(1704067200)
+array(2) {
+  [0]=>
+  string(3) "abc"
+  [1]=>
+  string(3) "def"
+}
+int(24)
+int(16)
+int(16)
+bool(true)
+int(0)
+string(0) ""
+Column of type String has no packed binary form
+Binary data of 3 bytes is not a multiple of the 4-byte Int32
+Unknown ClickHouse type: NoSuchType
+Column of type Nullable(Int32) has no packed binary form
+OK
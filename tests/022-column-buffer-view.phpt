@@ -0,0 +1,67 @@
+--TEST--
+Column::bufferView() and Column::nullMapView() expose column memory to FFI
+--EXTENSIONS--
+clickhouse
+ffi
+--INI--
+ffi.enable=1
+--FILE--
+<?php
+use ClickHouse\Driver\Column;
+
+$ffi = FFI::cdef();
+
+$col = Column::create('Float64', [1.5, -2.25, 3.0]);
+$view = $col->bufferView();
+var_dump($view->getCType(), $view->getCount(), $view->getByteLength());
+$ptr = $ffi->cast($view->getCType() . ' *', $view->getAddress());
+var_dump($ptr[0], $ptr[1], $ptr[2]);
+
+/* The view keeps the column alive */
+$view = Column::create('Int32', [7, -8])->bufferView();
+$ptr = $ffi->cast('int32_t *', $view->getAddress());
+var_dump($view->getCType(), $ptr[0], $ptr[1]);
+
+$nullable = Column::create('Nullable(UInt16)', [1, null, 3]);
+$values = $nullable->bufferView();
+$nulls = $nullable->nullMapView();
+$v = $ffi->cast('uint16_t *', $values->getAddress());
+$n = $ffi->cast('uint8_t *', $nulls->getAddress());
+var_dump($values->getCType(), $nulls->getCType(), $nulls->getByteLength());
+echo $v[0], ' ', $v[2], ' ', $n[0], $n[1], $n[2], "\n";
+
+var_dump(Column::create('UInt64', [])->bufferView()->getCount());
+
+foreach ([Column::create('String', ['a']), Column::create('Date', ['2024-01-01'])] as $c) {
+    try {
+        $c->bufferView();
+    } catch (ClickHouse\Driver\Exception\ValidationException $e) {
+        echo $e->getMessage(), "\n";
+    }
+}
+try {
+    $col->nullMapView();
+} catch (ClickHouse\Driver\Exception\ValidationException $e) {
+    echo $e->getMessage(), "\n";
+}
+echo "OK\n";
+?>
+--EXPECT--
+string(6) "double"
+int(3)
+int(24)
+float(1.5)
+float(-2.25)
+float(3)
+string(7) "int32_t"
+int(7)
+int(-8)
+string(8) "uint16_t"
+string(7) "uint8_t"
+int(3)
+1 3 010
+int(0)
+Column of type String has no numeric buffer
+Column of type Date has no numeric buffer
+Column of type Float64 is not Nullable
+OK
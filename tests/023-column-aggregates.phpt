@@ -0,0 +1,111 @@
+--TEST--
+Column::sum(), min(), max(), mean(), countNonNull() and quantiles()
+--EXTENSIONS--
+clickhouse
+--FILE--
+<?php
+use ClickHouse\Driver\Column;
+
+$col = Column::create('Int32', [5, -3, 7, 10]);
+var_dump($col->sum(), $col->min(), $col->max(), $col->mean(), $col->countNonNull());
+var_dump($col->quantiles([0, 0.5, 1]));
+
+$col = Column::create('Nullable(Float64)', [1.5, null, -2.5, 4.0]);
+var_dump($col->sum(), $col->min(), $col->max(), $col->mean(), $col->countNonNull());
+
+/* Sums past PHP_INT_MAX come back as numeric strings */
+var_dump(Column::create('Int64', [PHP_INT_MAX, PHP_INT_MAX])->sum());
+var_dump(Column::create('UInt64', ['18446744073709551615', 1])->sum());
+
+$col = Column::create('Decimal(10,2)', ['1.25', '2.50', '-0.75']);
+var_dump($col->sum(), $col->min(), $col->max(), $col->mean());
+
+/* min() and max() skip NaN, and are NaN when nothing else is left */
+$col = Column::create('Nullable(Float64)', [NAN, null, 2.0, NAN]);
+var_dump($col->min(), $col->max());
+$col = Column::create('Float32', [NAN, NAN]);
+var_dump(is_nan($col->min()), is_nan($col->max()), is_nan($col->sum()));
+
+/* 128-bit integers come back as strings, as at() returns them */
+$col = Column::create('Nullable(Int128)', ['170141183460469231731687303715884105000', null, -5]);
+var_dump($col->sum(), $col->min(), $col->max(), $col->quantiles([0, 1]));
+$col = Column::create('UInt128', ['340282366920938463463374607431768211000', 7, 8]);
+var_dump($col->sum(), $col->min(), $col->mean());
+try {
+    Column::create('UInt128', ['340282366920938463463374607431768211455', 1])->sum();
+} catch (ClickHouse\Driver\Exception\ValidationException $e) {
+    echo $e->getMessage(), "\n";
+}
+
+$col = Column::create('Nullable(UInt8)', [null, null]);
+var_dump($col->sum(), $col->min(), $col->mean(), $col->countNonNull(), $col->quantiles([0.5]));
+
+$col = Column::create('Nullable(String)', ['a', null, 'b']);
+var_dump($col->countNonNull());
+try {
+    $col->sum();
+} catch (ClickHouse\Driver\Exception\ValidationException $e) {
+    echo $e->getMessage(), "\n";
+}
+try {
+    Column::create('Int32', [1])->quantiles([1.5]);
+} catch (ClickHouse\Driver\Exception\ValidationException $e) {
+    echo $e->getMessage(), "\n";
+}
+echo "OK\n";
+?>
+--EXPECT--
+int(19)
+int(-3)
+int(10)
+float(4.75)
+int(4)
+array(3) {
+  [0]=>
+  int(-3)
+  [1]=>
+  int(7)
+  [2]=>
+  int(10)
+}
+float(3)
+float(-2.5)
+float(4)
+float(1)
+int(3)
+string(20) "18446744073709551614"
+string(20) "18446744073709551616"
+string(4) "3.00"
+string(5) "-0.75"
+string(4) "2.50"
+float(1)
+float(2)
+float(2)
+bool(true)
+bool(true)
+bool(true)
+string(39) "170141183460469231731687303715884104995"
+string(2) "-5"
+string(39) "170141183460469231731687303715884105000"
+array(2) {
+  [0]=>
+  string(2) "-5"
+  [1]=>
+  string(39) "170141183460469231731687303715884105000"
+}
+string(39) "340282366920938463463374607431768211015"
+string(1) "7"
+float(1.1342745564031281E+38)
+Sum of column UInt128 overflows UInt128
+int(0)
+NULL
+NULL
+int(0)
+array(1) {
+  [0]=>
+  NULL
+}
+int(2)
+Column of type Nullable(String) cannot be aggregated
+Quantile levels must be numbers from 0 to 1
+OK
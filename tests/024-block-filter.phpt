@@ -0,0 +1,199 @@
+--TEST--
+Column::slice(), compare() and Block::slice(), take(), filter()
+--EXTENSIONS--
+clickhouse
+--FILE--
+<?php
+use ClickHouse\Driver\Block;
+use ClickHouse\Driver\Column;
+
+var_dump(Column::create('Int32', [1, 2, 3, 4, 5])->slice(1, 3)->toArray());
+var_dump(Column::create('String', ['a', 'b', 'c'])->slice(2)->toArray());
+var_dump(Column::create('Int32', [1, 2])->slice(2)->size());
+
+var_dump(Column::create('Int32', [5, -3, 7, 10])->compare('>', 4)->toArray());
+var_dump(Column::create('UInt8', [0, 255])->compare('<', -1)->toArray());
+var_dump(Column::create('Nullable(Float64)', [1.5, null, 2.5])->compare('!=', 2)->toArray());
+var_dump(Column::create('String', ['x', 'y', 'x'])->compare('=', 'x')->toArray());
+var_dump(Column::create('FixedString(3)', ['ab', 'abc'])->compare('=', 'ab')->toArray());
+
+$block = new Block();
+$block->appendColumn('id', Column::create('UInt64', [1, 2, 3, 4]));
+$block->appendColumn('name', Column::create('Nullable(String)', ['a', null, 'c', 'd']));
+$block->appendColumn('tags', Column::create('Array(String)', [['x'], [], ['y', 'z'], ['w']]));
+
+var_dump($block->take([3, 0, 0])->toArray());
+var_dump($block->filter($block->getColumn(0)->compare('>=', 3))->toArray());
+var_dump($block->slice(1, 2)->toArray());
+var_dump($block->take([])->getRowCount());
+
+foreach ([
+    fn() => $block->slice(5),
+    fn() => $block->slice(0, -1),
+    fn() => $block->take([4]),
+    fn() => $block->filter(Column::create('Int32', [1, 1, 1, 1])),
+    fn() => $block->filter(Column::create('UInt8', [1])),
+    fn() => $block->getColumn(0)->compare('~', 1),
+    fn() => $block->getColumn(1)->compare('=', 1),
+] as $call) {
+    try {
+        $call();
+    } catch (ClickHouse\Driver\Exception\ValidationException $e) {
+        echo $e->getMessage(), "\n";
+    }
+}
+echo "OK\n";
+?>
+--EXPECT--
+array(3) {
+  [0]=>
+  int(2)
+  [1]=>
+  int(3)
+  [2]=>
+  int(4)
+}
+array(1) {
+  [0]=>
+  string(1) "c"
+}
+int(0)
+array(4) {
+  [0]=>
+  int(1)
+  [1]=>
+  int(0)
+  [2]=>
+  int(1)
+  [3]=>
+  int(1)
+}
+array(2) {
+  [0]=>
+  int(0)
+  [1]=>
+  int(0)
+}
+array(3) {
+  [0]=>
+  int(1)
+  [1]=>
+  int(0)
+  [2]=>
+  int(1)
+}
+array(3) {
+  [0]=>
+  int(1)
+  [1]=>
+  int(0)
+  [2]=>
+  int(1)
+}
+array(2) {
+  [0]=>
+  int(1)
+  [1]=>
+  int(0)
+}
+array(3) {
+  [0]=>
+  array(3) {
+    ["id"]=>
+    int(4)
+    ["name"]=>
+    string(1) "d"
+    ["tags"]=>
+    array(1) {
+      [0]=>
+      string(1) "w"
+    }
+  }
+  [1]=>
+  array(3) {
+    ["id"]=>
+    int(1)
+    ["name"]=>
+    string(1) "a"
+    ["tags"]=>
+    array(1) {
+      [0]=>
+      string(1) "x"
+    }
+  }
+  [2]=>
+  array(3) {
+    ["id"]=>
+    int(1)
+    ["name"]=>
+    string(1) "a"
+    ["tags"]=>
+    array(1) {
+      [0]=>
+      string(1) "x"
+    }
+  }
+}
+array(2) {
+  [0]=>
+  array(3) {
+    ["id"]=>
+    int(3)
+    ["name"]=>
+    string(1) "c"
+    ["tags"]=>
+    array(2) {
+      [0]=>
+      string(1) "y"
+      [1]=>
+      string(1) "z"
+    }
+  }
+  [1]=>
+  array(3) {
+    ["id"]=>
+    int(4)
+    ["name"]=>
+    string(1) "d"
+    ["tags"]=>
+    array(1) {
+      [0]=>
+      string(1) "w"
+    }
+  }
+}
+array(2) {
+  [0]=>
+  array(3) {
+    ["id"]=>
+    int(2)
+    ["name"]=>
+    NULL
+    ["tags"]=>
+    array(0) {
+    }
+  }
+  [1]=>
+  array(3) {
+    ["id"]=>
+    int(3)
+    ["name"]=>
+    string(1) "c"
+    ["tags"]=>
+    array(2) {
+      [0]=>
+      string(1) "y"
+      [1]=>
+      string(1) "z"
+    }
+  }
+}
+int(0)
+Slice out of range
+Slice out of range
+Row index out of range
+Filter mask must be a UInt8 column of 4 rows
+Filter mask must be a UInt8 column of 4 rows
+Unknown comparison operator: ~
+Column of type Nullable(String) cannot be compared with int
+OK
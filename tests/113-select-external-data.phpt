@@ -10,7 +10,8 @@ clickhouse_test_skip();
 --FILE--
 <?php
 require __DIR__ . '/clickhouse_test.inc';
-use ClickHouse\Driver\{Block, Column};
+use ClickHouse\Driver\{Block, Client, Column};
+use ClickHouse\Driver\Exception\QueryTimeoutException;
 
 $client = clickhouse_test_client();
 
@@ -84,6 +85,27 @@ $rows = $client->selectWithExternalData(
 );
 echo "Non-string name: count=" . count($rows) . "\n";
 
+// timeoutMs and readAheadBlocks apply as they do to select()
+$tables = [['name' => '_ext_ids', 'data' => $block]];
+try {
+    $client->selectWithExternalData(
+        'SELECT sleepEachRow(0.05) AS s FROM system.numbers WHERE number NOT IN _ext_ids LIMIT 200',
+        $tables,
+        null,
+        ['max_block_size' => 1],
+        null,
+        300
+    );
+    echo "FAIL: select finished\n";
+} catch (QueryTimeoutException $e) {
+    echo "Timed out\n";
+}
+echo count($client->selectWithExternalData('SELECT id FROM _ext_ids', $tables)), "\n";
+
+$ahead = new Client(clickhouse_test_options(['readAheadBlocks' => 2]));
+$rows = $ahead->selectWithExternalData('SELECT id FROM _ext_ids ORDER BY id', $tables);
+echo implode(',', array_column($rows, 'id')), "\n";
+
 echo "Done\n";
 ?>
 --EXPECT--
@@ -109,4 +131,7 @@ Integer data: count=1
 Non-array entry: count=1
 Missing name key: count=1
 Non-string name: count=1
+Timed out
+4
+1,3,5,7
 Done
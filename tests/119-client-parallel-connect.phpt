@@ -0,0 +1,82 @@
+--TEST--
+ClientOptions connectParallelism races endpoints and skips black-holed addresses
+--EXTENSIONS--
+clickhouse
+--SKIPIF--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+clickhouse_test_skip();
+?>
+--FILE--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+
+use ClickHouse\Driver\Client;
+use ClickHouse\Driver\Exception\ValidationException;
+
+$host = getenv('CLICKHOUSE_HOST') ?: 'localhost';
+$port = (int)(getenv('CLICKHOUSE_PORT') ?: 9000);
+
+foreach ([0, 17] as $bad) {
+    try {
+        clickhouse_test_options(['connectParallelism' => $bad]);
+        echo "FAIL: accepted connectParallelism=$bad\n";
+    } catch (ValidationException $e) {
+        echo "Rejected connectParallelism=$bad\n";
+    }
+}
+try {
+    clickhouse_test_options(['connectStaggerMs' => 60001]);
+    echo "FAIL: accepted connectStaggerMs=60001\n";
+} catch (ValidationException $e) {
+    echo "Rejected connectStaggerMs=60001\n";
+}
+
+// 192.0.2.1 (RFC 5737 TEST-NET) never answers; the live server is raced after 50ms.
+$start = microtime(true);
+$client = new Client(clickhouse_test_options([
+    'host' => '192.0.2.1',
+    'port' => 19000,
+    'connectTimeoutMs' => 3000,
+    'endpoints' => [['host' => $host, 'port' => $port]],
+    'connectParallelism' => 2,
+    'connectStaggerMs' => 50,
+]));
+$client->ping();
+$elapsed = microtime(true) - $start;
+
+echo "Connected before connect timeout: " . ($elapsed < 2.5 ? 'yes' : 'no') . "\n";
+$ep = $client->getCurrentEndpoint();
+echo "Endpoint reports winner: " . ($ep['host'] === $host && $ep['port'] === $port ? 'yes' : 'no') . "\n";
+
+$rows = $client->select('SELECT 1 AS x');
+var_dump($rows[0]['x']);
+
+// One attempt at a time: the black-holed address times out on its own and
+// the next candidate is still tried within the same connect.
+$start = microtime(true);
+$client = new Client(clickhouse_test_options([
+    'host' => '192.0.2.1',
+    'port' => 19000,
+    'sendRetries' => 0,
+    'connectTimeoutMs' => 500,
+    'endpoints' => [['host' => $host, 'port' => $port]],
+]));
+$client->ping();
+$elapsed = microtime(true) - $start;
+echo "Sequential connect waited one timeout: " . ($elapsed >= 0.45 && $elapsed < 2 ? 'yes' : 'no') . "\n";
+$ep = $client->getCurrentEndpoint();
+echo "Sequential winner: " . ($ep['host'] === $host && $ep['port'] === $port ? 'yes' : 'no') . "\n";
+
+echo "OK\n";
+?>
+--EXPECT--
+Rejected connectParallelism=0
+Rejected connectParallelism=17
+Rejected connectStaggerMs=60001
+Connected before connect timeout: yes
+Endpoint reports winner: yes
+int(1)
+Sequential connect waited one timeout: yes
+Sequential winner: yes
+OK
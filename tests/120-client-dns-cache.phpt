@@ -0,0 +1,79 @@
+--TEST--
+ClientOptions dnsCacheTtlSeconds shares resolved endpoints across clients
+--EXTENSIONS--
+clickhouse
+--SKIPIF--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+clickhouse_test_skip();
+?>
+--FILE--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+
+use ClickHouse\Driver\Client;
+use ClickHouse\Driver\Exception\{ConnectionException, ValidationException};
+
+function dns_cached_options($host, $ttl)
+{
+    return clickhouse_test_options([
+        'host' => $host,
+        'sendRetries' => 0,
+        'retryTimeoutSeconds' => 0,
+        'connectTimeoutMs' => 2000,
+        'dnsCacheTtlSeconds' => $ttl,
+        'dnsNegativeTtlSeconds' => 5,
+    ]);
+}
+
+/* [lookups, hits] from the "DNS Cache" line of phpinfo() */
+function dns_cache_counters()
+{
+    ob_start();
+    phpinfo(INFO_MODULES);
+    preg_match('/DNS Cache\s*=>\s*\d+ entries, (\d+) lookups, (\d+) hits/', ob_get_clean(), $m);
+    return [(int)$m[1], (int)$m[2]];
+}
+
+$host = getenv('CLICKHOUSE_HOST') ?: 'localhost';
+
+try {
+    dns_cached_options($host, -1);
+    echo "FAIL: accepted negative TTL\n";
+} catch (ValidationException $e) {
+    echo "Rejected negative dnsCacheTtlSeconds\n";
+}
+
+// Several clients reuse the same cached answer: one lookup, then hits.
+[$lookups, $hits] = dns_cache_counters();
+for ($i = 0; $i < 3; $i++) {
+    $client = new Client(dns_cached_options($host, 60));
+    $rows = $client->select('SELECT 1 AS x');
+    echo "Client $i: " . $rows[0]['x'] . "\n";
+}
+[$lookupsAfter, $hitsAfter] = dns_cache_counters();
+echo "Lookups: ", $lookupsAfter - $lookups, ", hits: ", $hitsAfter - $hits, "\n";
+
+// Failed lookups are negatively cached and still surface as connection errors.
+for ($i = 0; $i < 2; $i++) {
+    try {
+        new Client(dns_cached_options('clickhouse-dns-cache-test.invalid', 60));
+        echo "FAIL: connected to .invalid host\n";
+    } catch (ConnectionException $e) {
+        echo "Unresolvable host $i: ConnectionException\n";
+    }
+}
+echo "Negative lookups: ", dns_cache_counters()[0] - $lookupsAfter, "\n";
+
+echo "OK\n";
+?>
+--EXPECT--
+Rejected negative dnsCacheTtlSeconds
+Client 0: 1
+Client 1: 1
+Client 2: 1
+Lookups: 1, hits: 2
+Unresolvable host 0: ConnectionException
+Unresolvable host 1: ConnectionException
+Negative lookups: 1
+OK
@@ -0,0 +1,55 @@
+--TEST--
+TLS clients share the SSL context and survive reconnects with session resumption
+--EXTENSIONS--
+clickhouse
+--SKIPIF--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+if (!getenv('CLICKHOUSE_TLS_PORT')) {
+    die('skip CLICKHOUSE_TLS_PORT not set');
+}
+clickhouse_test_skip();
+?>
+--FILE--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+
+use ClickHouse\Driver\Client;
+use ClickHouse\Driver\Exception\ClickHouseException;
+
+function tls_options(array $ssl)
+{
+    return clickhouse_test_options(['port' => (int)getenv('CLICKHOUSE_TLS_PORT'), 'ssl' => $ssl]);
+}
+
+$ssl = ['skip_verification' => true];
+
+// Several clients with identical options reuse one context; the second and
+// later handshakes offer the ticket stored by the first.
+for ($i = 0; $i < 3; $i++) {
+    $client = new Client(tls_options($ssl));
+    $rows = $client->select('SELECT ' . $i . ' AS x');
+    var_dump($rows[0]['x']);
+}
+
+$client->resetConnection();
+$rows = $client->select('SELECT 42 AS x');
+var_dump($rows[0]['x']);
+
+// A different option set builds its own context and reports load errors.
+try {
+    new Client(tls_options(['ca_file' => '/nonexistent/ca.pem']));
+    echo "FAIL: connected with missing CA file\n";
+} catch (ClickHouseException $e) {
+    echo "Missing CA file rejected\n";
+}
+
+echo "OK\n";
+?>
+--EXPECT--
+int(0)
+int(1)
+int(2)
+int(42)
+Missing CA file rejected
+OK
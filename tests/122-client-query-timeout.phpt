@@ -0,0 +1,91 @@
+--TEST--
+timeoutMs cancels a running query, throws QueryTimeoutException and keeps the connection usable
+--EXTENSIONS--
+clickhouse
+--SKIPIF--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+clickhouse_test_skip();
+?>
+--FILE--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+
+use ClickHouse\Driver\Exception\{QueryTimeoutException, ValidationException};
+
+$client = clickhouse_test_client();
+$slow = 'SELECT sleepEachRow(0.05) AS s FROM system.numbers LIMIT 200';
+
+try {
+    $client->select('SELECT 1', null, null, null, 0);
+    echo "FAIL: accepted timeoutMs=0\n";
+} catch (ValidationException $e) {
+    echo "Rejected timeoutMs=0\n";
+}
+
+// Server-side limit injected as max_execution_time
+$start = microtime(true);
+try {
+    $client->select($slow, null, ['max_block_size' => 1], null, 300);
+    echo "FAIL: select finished\n";
+} catch (QueryTimeoutException $e) {
+    echo "select timed out\n";
+}
+echo "Stopped early: " . (microtime(true) - $start < 5 ? 'yes' : 'no') . "\n";
+var_dump($client->select('SELECT 1 AS x')[0]['x']);
+
+// A looser caller max_execution_time is tightened to timeoutMs
+$blocks = 0;
+try {
+    $client->selectByBlock(
+        $slow,
+        function ($block) use (&$blocks) { $blocks++; },
+        null,
+        ['max_block_size' => 1, 'max_execution_time' => 60],
+        null, null, null,
+        300
+    );
+    echo "FAIL: selectByBlock finished\n";
+} catch (QueryTimeoutException $e) {
+    echo "selectByBlock timed out\n";
+}
+echo "Saw some blocks: " . ($blocks > 0 && $blocks < 200 ? 'yes' : 'no') . "\n";
+var_dump($client->select('SELECT 2 AS x')[0]['x']);
+
+// A tighter one is kept
+$start = microtime(true);
+try {
+    $tight = ['max_block_size' => 1, 'max_execution_time' => '0.2'];
+    $client->select($slow, null, $tight, null, 5000);
+    echo "FAIL: select finished\n";
+} catch (QueryTimeoutException $e) {
+    echo "select timed out\n";
+}
+echo "Caller limit kept: " . (microtime(true) - $start < 3 ? 'yes' : 'no') . "\n";
+var_dump($client->select('SELECT 4 AS x')[0]['x']);
+
+try {
+    $client->execute($slow, null, ['max_block_size' => 1], null, 300);
+    echo "FAIL: execute finished\n";
+} catch (QueryTimeoutException $e) {
+    echo "execute timed out\n";
+}
+
+// Fast queries are unaffected
+var_dump($client->select('SELECT 3 AS x', null, null, null, 5000)[0]['x']);
+echo "OK\n";
+?>
+--EXPECT--
+Rejected timeoutMs=0
+select timed out
+Stopped early: yes
+int(1)
+selectByBlock timed out
+Saw some blocks: yes
+int(2)
+select timed out
+Caller limit kept: yes
+int(4)
+execute timed out
+int(3)
+OK
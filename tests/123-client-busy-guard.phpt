@@ -0,0 +1,37 @@
+--TEST--
+Client rejects a nested query from a data callback and stays usable
+--EXTENSIONS--
+clickhouse
+--SKIPIF--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+clickhouse_test_skip();
+?>
+--FILE--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+
+use ClickHouse\Driver\Exception\ClickHouseException;
+
+$client = clickhouse_test_client();
+
+$client->selectByBlock(
+    'SELECT number FROM system.numbers LIMIT 3',
+    function ($block) use ($client) {
+        try {
+            $client->select('SELECT 1');
+            echo "FAIL: nested query ran\n";
+        } catch (ClickHouseException $e) {
+            echo $e->getMessage() . "\n";
+        }
+        return false;
+    }
+);
+
+var_dump($client->select('SELECT 7 AS x')[0]['x']);
+echo "OK\n";
+?>
+--EXPECT--
+Client is busy with another query
+int(7)
+OK
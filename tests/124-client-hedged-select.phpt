@@ -0,0 +1,70 @@
+--TEST--
+ClientOptions hedgeDelayMs races a slow select against a second endpoint
+--EXTENSIONS--
+clickhouse
+--SKIPIF--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+clickhouse_test_skip();
+?>
+--FILE--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+
+use ClickHouse\Driver\Client;
+use ClickHouse\Driver\Exception\ValidationException;
+
+$host = getenv('CLICKHOUSE_HOST') ?: 'localhost';
+$port = (int)(getenv('CLICKHOUSE_PORT') ?: 9000);
+// The same server under a second name stands in for a replica
+$alias = gethostbyname($host);
+
+function hedged_options(array $endpoints, $hedgeDelayMs)
+{
+    return clickhouse_test_options([
+        'connectTimeoutMs' => 3000,
+        'endpoints' => $endpoints,
+        'hedgeDelayMs' => $hedgeDelayMs,
+    ]);
+}
+
+foreach ([-1, 600001] as $bad) {
+    try {
+        hedged_options([], $bad);
+        echo "FAIL: accepted hedgeDelayMs=$bad\n";
+    } catch (ValidationException $e) {
+        echo "Rejected hedgeDelayMs=$bad\n";
+    }
+}
+
+$client = new Client(hedged_options([['host' => $alias, 'port' => $port]], 1));
+
+// Every select waits longer than the hedge delay, so both connections race
+$sql = 'SELECT sleep(0.05) AS s, number AS n FROM numbers(20000)';
+for ($i = 0; $i < 3; $i++) {
+    $rows = $client->select($sql, null, ['max_block_size' => 1000]);
+    echo count($rows), ' ', array_sum(array_column($rows, 'n')), "\n";
+}
+
+// Whichever connection won, the client stays usable
+$client->ping();
+var_dump($client->select('SELECT 1 AS x')[0]['x']);
+$client->execute('SELECT 1');
+var_dump(is_array($client->getCurrentEndpoint()));
+
+// A single endpoint has nothing to hedge to
+$single = new Client(hedged_options([], 1));
+var_dump(count($single->select($sql, null, ['max_block_size' => 1000])));
+
+echo "OK\n";
+?>
+--EXPECT--
+Rejected hedgeDelayMs=-1
+Rejected hedgeDelayMs=600001
+20000 199990000
+20000 199990000
+20000 199990000
+int(1)
+bool(true)
+int(20000)
+OK
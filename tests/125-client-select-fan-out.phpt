@@ -0,0 +1,75 @@
+--TEST--
+Client::selectFanOut() queries every shard and concatenates or merges the rows
+--EXTENSIONS--
+clickhouse
+--SKIPIF--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+clickhouse_test_skip();
+?>
+--FILE--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+
+use ClickHouse\Driver\Exception\{ServerException, ValidationException};
+
+$host = getenv('CLICKHOUSE_HOST') ?: 'localhost';
+$port = (int)(getenv('CLICKHOUSE_PORT') ?: 9000);
+// The same server under two names stands in for two shards
+$shards = [['host' => $host, 'port' => $port], ['host' => gethostbyname($host)]];
+
+$client = clickhouse_test_client();
+
+foreach ([[], [$shards[0], $shards[0]], [['port' => $port]]] as $bad) {
+    try {
+        $client->selectFanOut($bad, 'SELECT 1');
+        echo "FAIL: accepted endpoints\n";
+    } catch (ValidationException $e) {
+        echo "Rejected endpoints\n";
+    }
+}
+
+// Concatenated in arrival order
+$rows = $client->selectFanOut($shards, 'SELECT number AS n FROM numbers(1000)');
+echo count($rows), ' ', array_sum(array_column($rows, 'n')), "\n";
+
+// Merged on the ORDER BY of the shard query
+$sql = 'SELECT number % 3 AS k, toString(number) AS s FROM numbers(6) ORDER BY k, s';
+$rows = $client->selectFanOut($shards, $sql, null, ['max_block_size' => 2], ['k', 's']);
+echo implode(',', array_map(fn($r) => $r['k'] . $r['s'], $rows)), "\n";
+
+$sql = 'SELECT number AS n FROM numbers({limit:UInt32}) ORDER BY n DESC';
+$rows = $client->selectFanOut($shards, $sql, ['limit' => 4], null, ['n DESC']);
+echo implode(',', array_column($rows, 'n')), "\n";
+
+try {
+    $client->selectFanOut($shards, 'SELECT 1 AS x', null, null, ['missing']);
+    echo "FAIL: merged on a missing column\n";
+} catch (ValidationException $e) {
+    echo "Rejected orderBy column\n";
+}
+
+try {
+    $client->selectFanOut($shards, 'SELECT * FROM no_such_table_fan_out');
+    echo "FAIL: query succeeded\n";
+} catch (ServerException $e) {
+    echo "Shard error surfaced\n";
+}
+
+// Shard connections are reused, or reopened after a failure
+var_dump(count($client->selectFanOut($shards, 'SELECT 1 AS x')));
+var_dump($client->select('SELECT 2 AS x')[0]['x']);
+echo "OK\n";
+?>
+--EXPECT--
+Rejected endpoints
+Rejected endpoints
+Rejected endpoints
+2000 999000
+00,00,03,03,11,11,14,14,22,22,25,25
+3,3,2,2,1,1,0,0
+Rejected orderBy column
+Shard error surfaced
+int(2)
+int(2)
+OK
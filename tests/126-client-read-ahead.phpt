@@ -0,0 +1,73 @@
+--TEST--
+ClientOptions readAheadBlocks receives blocks on a background thread without changing results
+--EXTENSIONS--
+clickhouse
+--SKIPIF--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+clickhouse_test_skip();
+?>
+--FILE--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+
+use ClickHouse\Driver\{Client, CompressionMethod};
+use ClickHouse\Driver\Exception\ValidationException;
+
+function read_ahead_options($blocks)
+{
+    return clickhouse_test_options([
+        'compression' => CompressionMethod::LZ4,
+        'readAheadBlocks' => $blocks,
+    ]);
+}
+
+foreach ([-1, 1025] as $bad) {
+    try {
+        read_ahead_options($bad);
+        echo "FAIL: accepted readAheadBlocks=$bad\n";
+    } catch (ValidationException $e) {
+        echo "Rejected readAheadBlocks=$bad\n";
+    }
+}
+
+$client = new Client(read_ahead_options(4));
+$sql = 'SELECT number AS n, toString(number) AS s FROM numbers(100000)';
+
+$rows = $client->select($sql, null, ['max_block_size' => 1000]);
+echo count($rows), ' ', array_sum(array_column($rows, 'n')), "\n";
+
+$blocks = 0;
+$progress = 0;
+$client->selectByBlock(
+    $sql,
+    function ($block) use (&$blocks) { $blocks++; },
+    null,
+    ['max_block_size' => 1000],
+    null,
+    function ($p) use (&$progress) { $progress++; }
+);
+echo "Blocks: $blocks\n";
+echo "Progress reported: " . ($progress > 0 ? 'yes' : 'no') . "\n";
+
+// Returning false cancels; the connection is drained and reusable
+$seen = 0;
+$client->selectByBlock(
+    'SELECT number FROM system.numbers',
+    function ($block) use (&$seen) { return ++$seen < 3; },
+    null,
+    ['max_block_size' => 1000]
+);
+echo "Stopped after: $seen\n";
+var_dump($client->select('SELECT 1 AS x')[0]['x']);
+echo "OK\n";
+?>
+--EXPECT--
+Rejected readAheadBlocks=-1
+Rejected readAheadBlocks=1025
+100000 4999950000
+Blocks: 100
+Progress reported: yes
+Stopped after: 3
+int(1)
+OK
@@ -0,0 +1,82 @@
+--TEST--
+CompressionMethod::Adaptive picks a result codec per query and reports compression stats
+--EXTENSIONS--
+clickhouse
+--SKIPIF--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+clickhouse_test_skip();
+?>
+--FILE--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+
+use ClickHouse\Driver\{Block, Client, Column, CompressionMethod};
+
+$client = new Client(clickhouse_test_options(['compression' => CompressionMethod::Adaptive]));
+
+$stats = $client->getCompressionStats();
+var_dump($stats['adaptive'], $stats['last']);
+
+$sql = 'SELECT number AS n, toString(number) AS s FROM numbers(200000)';
+for ($i = 0; $i < 3; $i++) {
+    $rows = $client->select($sql);
+    echo count($rows), ' ', array_sum(array_column($rows, 'n')), "\n";
+}
+
+$stats = $client->getCompressionStats();
+var_dump(in_array($stats['last'], ['LZ4', 'ZSTD'], true));
+var_dump($stats['bytes_received'] > 0, $stats['bytes_sent'] > 0);
+var_dump($stats['bandwidth'] > 0);
+$queries = fn(array $stats) => array_sum(array_column(
+    [$stats['lz4'], $stats['zstd']], 'queries'));
+var_dump($queries($stats) === 3);
+var_dump($stats['lz4']['ratio'] > 1);
+// The first query used LZ4 and the second ZSTD, and both timed decoding
+var_dump($stats['lz4']['queries'] >= 1, $stats['zstd']['queries'] >= 1);
+var_dump($stats['lz4']['decode'] > 0, $stats['zstd']['decode'] > 0);
+var_dump(!isset($stats['none']));
+
+// An explicit codec is left alone
+$rows = $client->select($sql, null, ['network_compression_method' => 'ZSTD']);
+echo count($rows), "\n";
+$after = $client->getCompressionStats();
+var_dump($queries($after) === 3);
+
+// Inserts keep the connection's LZ4
+$client->execute('DROP TABLE IF EXISTS _test_adaptive_compression');
+$client->execute('CREATE TABLE _test_adaptive_compression (n UInt64) ENGINE = Memory');
+$block = new Block();
+$block->appendColumn('n', Column::create('UInt64', range(1, 1000)));
+$client->insert('_test_adaptive_compression', $block);
+var_dump($client->select('SELECT sum(n) AS s FROM _test_adaptive_compression')[0]['s']);
+$client->execute('DROP TABLE _test_adaptive_compression');
+
+$plain = new Client(clickhouse_test_options());
+$stats = $plain->getCompressionStats();
+var_dump($stats['adaptive']);
+echo "OK\n";
+?>
+--EXPECT--
+bool(true)
+NULL
+200000 19999900000
+200000 19999900000
+200000 19999900000
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+200000
+bool(true)
+int(500500)
+bool(false)
+OK
@@ -0,0 +1,51 @@
+--TEST--
+ClientOptions ioUring gives the same results with or without io_uring support
+--EXTENSIONS--
+clickhouse
+--SKIPIF--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+clickhouse_test_skip();
+?>
+--FILE--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+
+use ClickHouse\Driver\{Block, Client, Column, CompressionMethod};
+
+$client = new Client(clickhouse_test_options([
+    'compression' => CompressionMethod::LZ4,
+    'ioUring' => true,
+]));
+
+// Many small round trips
+$sum = 0;
+for ($i = 0; $i < 200; $i++) {
+    $sum += $client->select("SELECT $i AS x")[0]['x'];
+}
+echo "$sum\n";
+
+// A result spanning many receive buffers
+$rows = $client->select('SELECT number AS n, repeat(\'x\', 100) AS s FROM numbers(200000)');
+echo count($rows), ' ', array_sum(array_column($rows, 'n')), "\n";
+
+// An insert larger than the send staging area
+$client->execute('DROP TABLE IF EXISTS _test_io_uring');
+$client->execute('CREATE TABLE _test_io_uring (id UInt64, s String) ENGINE = Memory');
+$n = 100000;
+$block = new Block();
+$block->appendColumn('id', Column::create('UInt64', range(1, $n)));
+$block->appendColumn('s', Column::create('String', array_fill(0, $n, str_repeat('y', 32))));
+$client->insert('_test_io_uring', $block);
+$row = $client->select('SELECT count() AS c, sum(id) AS s FROM _test_io_uring')[0];
+echo $row['c'], ' ', $row['s'], "\n";
+$client->execute('DROP TABLE _test_io_uring');
+
+$client->ping();
+echo "OK\n";
+?>
+--EXPECT--
+19900
+200000 19999900000
+100000 5000050000
+OK
@@ -0,0 +1,63 @@
+--TEST--
+ClientOptions zeroCopyThreshold gathers uncompressed writes without changing inserted data
+--EXTENSIONS--
+clickhouse
+--SKIPIF--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+clickhouse_test_skip();
+?>
+--FILE--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+
+use ClickHouse\Driver\{Block, Client, Column, CompressionMethod};
+use ClickHouse\Driver\Exception\ValidationException;
+
+function zero_copy_options($compression, $threshold)
+{
+    return clickhouse_test_options([
+        'compression' => $compression,
+        'zeroCopyThreshold' => $threshold,
+    ]);
+}
+
+try {
+    zero_copy_options(CompressionMethod::None, -1);
+    echo "FAIL: accepted zeroCopyThreshold=-1\n";
+} catch (ValidationException $e) {
+    echo "Rejected zeroCopyThreshold=-1\n";
+}
+
+foreach ([CompressionMethod::None, CompressionMethod::LZ4] as $compression) {
+    $client = new Client(zero_copy_options($compression, 65536));
+    $client->execute('DROP TABLE IF EXISTS _test_zero_copy');
+    $client->execute(
+        'CREATE TABLE _test_zero_copy (id UInt64, v Float64, tag FixedString(4), s String) ' .
+        'ENGINE = Memory'
+    );
+
+    $n = 200000;
+    $block = new Block();
+    $block->appendColumn('id', Column::create('UInt64', range(1, $n)));
+    $block->appendColumn('v', Column::create('Float64', array_fill(0, $n, 0.5)));
+    $block->appendColumn('tag', Column::create('FixedString(4)', array_fill(0, $n, 'abcd')));
+    $block->appendColumn('s', Column::create('String', array_fill(0, $n, 'x')));
+    for ($i = 0; $i < 2; $i++) {
+        $client->insert('_test_zero_copy', $block);
+    }
+
+    $row = $client->select(
+        'SELECT count() AS c, sum(id) AS s, sum(v) AS v, countIf(tag = \'abcd\') AS t ' .
+        'FROM _test_zero_copy'
+    )[0];
+    echo $row['c'], ' ', $row['s'], ' ', $row['v'], ' ', $row['t'], "\n";
+    $client->execute('DROP TABLE _test_zero_copy');
+}
+echo "OK\n";
+?>
+--EXPECT--
+Rejected zeroCopyThreshold=-1
+400000 40000200000 200000 400000
+400000 40000200000 200000 400000
+OK
@@ -0,0 +1,93 @@
+--TEST--
+ClientOptions blockMemoryBudget sizes result blocks and memoryLimitFraction cancels oversized selects
+--EXTENSIONS--
+clickhouse
+--SKIPIF--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+clickhouse_test_skip();
+?>
+--INI--
+memory_limit=64M
+--FILE--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+
+use ClickHouse\Driver\{Client, CompressionMethod};
+use ClickHouse\Driver\Exception\{MemoryLimitException, ValidationException};
+
+function budget_options($budget, $fraction)
+{
+    return clickhouse_test_options([
+        'compression' => CompressionMethod::LZ4,
+        'blockMemoryBudget' => $budget,
+        'memoryLimitFraction' => $fraction,
+    ]);
+}
+
+foreach ([[-1, 0.0], [0, -0.1], [0, 1.5]] as [$budget, $fraction]) {
+    try {
+        budget_options($budget, $fraction);
+        echo "FAIL: accepted $budget/$fraction\n";
+    } catch (ValidationException $e) {
+        echo "Rejected $budget/$fraction\n";
+    }
+}
+
+/* Two UInt64 columns: a few hundred bytes per row, so 64 KiB holds far
+ * fewer rows than the server's default 65409. The first run learns the row
+ * cost from the result header, which arrives too late to size its blocks;
+ * system.numbers ignores preferred_block_size_bytes. */
+$client = new Client(budget_options(65536, 0.0));
+$query = 'SELECT number AS a, number * 2 AS b FROM system.numbers LIMIT 200000';
+for ($run = 0; $run < 2; $run++) {
+    $largest = 0;
+    $total = 0;
+    $client->selectByBlock($query, function ($block) use (&$largest, &$total) {
+        $largest = max($largest, $block->getRowCount());
+        $total += $block->getRowCount();
+    }, null, ['max_threads' => 1]);
+    echo "run $run: $total rows, small blocks: ", var_export($largest < 65409, true), "\n";
+}
+
+/* The caller's max_block_size wins */
+$largest = 0;
+$client->selectByBlock($query, function ($block) use (&$largest) {
+    $largest = max($largest, $block->getRowCount());
+}, null, ['max_block_size' => 100000, 'max_threads' => 1]);
+var_dump($largest > 65409);
+
+$client = new Client(budget_options(0, 0.5));
+try {
+    $client->select('SELECT number, toString(number) AS s FROM system.numbers LIMIT 5000000');
+    echo "FAIL: no exception\n";
+} catch (MemoryLimitException $e) {
+    echo "MemoryLimitException\n";
+}
+var_dump($client->select('SELECT 1 AS x') === [['x' => 1]]);
+
+/* Small server blocks pass, the block minRows merges them into does not */
+try {
+    $client->selectByBlock('SELECT number AS a, number * 2 AS b FROM numbers(1000000)',
+                           function ($block) {
+                               echo "FAIL: got a block\n";
+                           }, null, ['max_block_size' => 1000], null, null, null, null, 1000000);
+    echo "FAIL: no exception\n";
+} catch (MemoryLimitException $e) {
+    echo "MemoryLimitException from minRows\n";
+}
+var_dump($client->select('SELECT 1 AS x') === [['x' => 1]]);
+echo "OK\n";
+?>
+--EXPECT--
+Rejected -1/0
+Rejected 0/-0.1
+Rejected 0/1.5
+run 0: 200000 rows, small blocks: false
+run 1: 200000 rows, small blocks: true
+bool(true)
+MemoryLimitException
+bool(true)
+MemoryLimitException from minRows
+bool(true)
+OK
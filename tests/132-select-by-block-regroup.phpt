@@ -0,0 +1,71 @@
+--TEST--
+Client::selectByBlock() minRows/maxRows merge small blocks and split large ones
+--EXTENSIONS--
+clickhouse
+--SKIPIF--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+clickhouse_test_skip();
+?>
+--FILE--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+
+use ClickHouse\Driver\Exception\ValidationException;
+
+$client = clickhouse_test_client();
+
+function collect($client, $query, $settings, $minRows, $maxRows)
+{
+    $sizes = [];
+    $sum = 0;
+    $client->selectByBlock($query, function ($block) use (&$sizes, &$sum) {
+        $sizes[] = $block->getRowCount();
+        foreach ($block->toArray() as $row) {
+            $sum += $row['number'];
+        }
+    }, null, $settings, null, null, null, null, $minRows, $maxRows);
+    return [$sizes, $sum];
+}
+
+$query = 'SELECT number FROM system.numbers LIMIT 1000';
+
+/* The server sends 100 blocks of 10 rows; they arrive as 3 x 300 and the rest */
+[$sizes, $sum] = collect($client, $query, ['max_block_size' => 10], 300, 0);
+echo implode(',', $sizes), ' ', $sum, "\n";
+
+/* One 1000-row block cut into slices of 400 */
+[$sizes, $sum] = collect($client, $query, ['max_block_size' => 1000], 0, 400);
+echo implode(',', $sizes), ' ', $sum, "\n";
+
+/* Both: three blocks of 100 make 300 rows, cut to 250 and 50 */
+[$sizes, $sum] = collect($client, $query, ['max_block_size' => 100], 250, 250);
+echo implode(',', $sizes), ' ', $sum, "\n";
+
+/* Returning false stops delivery, including the merged remainder */
+$calls = 0;
+$client->selectByBlock($query, function () use (&$calls) {
+    $calls++;
+    return false;
+}, null, ['max_block_size' => 10], null, null, null, null, 300, 0);
+var_dump($calls);
+
+foreach ([[-1, 0], [0, -1], [100, 50]] as [$min, $max]) {
+    try {
+        collect($client, $query, null, $min, $max);
+        echo "FAIL: accepted $min/$max\n";
+    } catch (ValidationException $e) {
+        echo get_class($e), ': ', $e->getMessage(), "\n";
+    }
+}
+echo "OK\n";
+?>
+--EXPECT--
+300,300,300,100 499500
+400,400,200 499500
+250,50,250,50,250,50,100 499500
+int(1)
+ClickHouse\Driver\Exception\ValidationException: minRows and maxRows must not be negative
+ClickHouse\Driver\Exception\ValidationException: minRows and maxRows must not be negative
+ClickHouse\Driver\Exception\ValidationException: maxRows must be 0 or at least minRows
+OK
@@ -0,0 +1,60 @@
+--TEST--
+Client::selectToStream() formats CSV, TSV and JSONEachRow without building PHP arrays
+--EXTENSIONS--
+clickhouse
+--SKIPIF--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+clickhouse_test_skip();
+?>
+--FILE--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+
+use ClickHouse\Driver\Exception\ValidationException;
+
+$client = clickhouse_test_client();
+
+$query = "SELECT number AS n, toString(number) || 'a\"b\tc' AS s, " .
+    "if(number = 1, NULL, number * 1.5) AS f, [number, 2] AS arr, " .
+    "toDate('2024-01-02') AS d, map('k', number) AS m " .
+    "FROM system.numbers LIMIT 2";
+
+foreach (['CSVWithNames', 'TSV', 'JSONEachRow'] as $format) {
+    $stream = fopen('php://memory', 'w+');
+    $rows = $client->selectToStream($query, $stream, $format);
+    rewind($stream);
+    echo "$format ($rows rows):\n", stream_get_contents($stream);
+    fclose($stream);
+}
+
+/* Large results go out in several chunks */
+$stream = fopen('php://memory', 'w+');
+$rows = $client->selectToStream('SELECT number FROM system.numbers LIMIT 100000', $stream, 'CSV');
+rewind($stream);
+$lines = explode("\n", rtrim(stream_get_contents($stream)));
+var_dump($rows, count($lines), $lines[99999]);
+
+try {
+    $client->selectToStream('SELECT 1', fopen('php://memory', 'w'), 'Parquet');
+} catch (ValidationException $e) {
+    echo get_class($e), "\n";
+}
+echo "OK\n";
+?>
+--EXPECT--
+CSVWithNames (2 rows):
+"n","s","f","arr","d","m"
+0,"0a""b	c",0,"[0,2]","2024-01-02","{'k':0}"
+1,"1a""b	c",\N,"[1,2]","2024-01-02","{'k':1}"
+TSV (2 rows):
+0	0a"b\tc	0	[0,2]	2024-01-02	{'k':0}
+1	1a"b\tc	\N	[1,2]	2024-01-02	{'k':1}
+JSONEachRow (2 rows):
+{"n":0,"s":"0a\"b\tc","f":0,"arr":[0,2],"d":"2024-01-02","m":{"k":0}}
+{"n":1,"s":"1a\"b\tc","f":null,"arr":[1,2],"d":"2024-01-02","m":{"k":1}}
+int(100000)
+int(100000)
+string(5) "99999"
+ClickHouse\Driver\Exception\ValidationException
+OK
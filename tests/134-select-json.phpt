@@ -0,0 +1,70 @@
+--TEST--
+Client::selectJson() and Block::toJson() encode rows and columns natively
+--EXTENSIONS--
+clickhouse
+--SKIPIF--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+clickhouse_test_skip();
+?>
+--FILE--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+
+$client = clickhouse_test_client();
+
+$query = "SELECT number AS id, concat('r/', toString(number), '\"') AS name, " .
+    "if(number = 0, NULL, number / 2) AS half, [toString(number)] AS tags, " .
+    "tuple(number, 'x') AS t FROM system.numbers LIMIT 2";
+
+echo $client->selectJson($query), "\n";
+echo $client->selectJson($query, null, null, null, null, true), "\n";
+echo $client->selectJson('SELECT 1 AS x WHERE 0'), "\n";
+echo $client->selectJson('SELECT 1 AS x WHERE 0', null, null, null, null, true), "\n";
+
+/* Same values as json_encode() over select() for plain types */
+$plain = 'SELECT number AS n, toString(number) AS s FROM system.numbers LIMIT 3';
+var_dump(json_decode($client->selectJson($plain), true) === $client->select($plain));
+
+/* Concatenating blocks gives a single document */
+$json = $client->selectJson('SELECT number FROM system.numbers LIMIT 5', null,
+                            ['max_block_size' => 2], null, null, true);
+echo $json, "\n";
+echo $client->selectJson('SELECT number FROM system.numbers LIMIT 3', null,
+                         ['max_block_size' => 2]), "\n";
+
+/* Integers a double cannot hold exactly are quoted */
+echo $client->selectJson('SELECT toUInt64(9007199254740992) AS a, ' .
+                         'toUInt64(9007199254740993) AS b, toInt64(-9007199254740993) AS c'), "\n";
+
+/* JSON needs UTF-8; the connection stays usable after the rejection */
+echo $client->selectJson("SELECT 'caf\u{e9}' AS s"), "\n";
+try {
+    $client->selectJson("SELECT unhex('C328') AS s");
+    echo "FAIL: no exception\n";
+} catch (ClickHouse\Driver\Exception\ValidationException $e) {
+    echo get_class($e), "\n";
+}
+var_dump($client->select('SELECT 1 AS x') === [['x' => 1]]);
+
+$client->selectByBlock('SELECT number AS n FROM system.numbers LIMIT 3', function ($block) {
+    echo $block->toJson(), ' ', $block->toJson(true), "\n";
+});
+echo (new ClickHouse\Driver\Block())->toJson(), "\n";
+echo "OK\n";
+?>
+--EXPECT--
+[{"id":0,"name":"r/0\"","half":null,"tags":["0"],"t":[0,"x"]},{"id":1,"name":"r/1\"","half":0.5,"tags":["1"],"t":[1,"x"]}]
+{"id":[0,1],"name":["r/0\"","r/1\""],"half":[null,0.5],"tags":[["0"],["1"]],"t":[[0,"x"],[1,"x"]]}
+[]
+{"x":[]}
+bool(true)
+{"number":[0,1,2,3,4]}
+[{"number":0},{"number":1},{"number":2}]
+[{"a":9007199254740992,"b":"9007199254740993","c":"-9007199254740993"}]
+[{"s":"café"}]
+ClickHouse\Driver\Exception\ValidationException
+bool(true)
+[{"n":0},{"n":1},{"n":2}] {"n":[0,1,2]}
+[]
+OK
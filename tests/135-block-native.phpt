@@ -0,0 +1,82 @@
+--TEST--
+Block::toNative(), Block::fromNative() and Client::selectNative() round-trip results
+--EXTENSIONS--
+clickhouse
+--SKIPIF--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+clickhouse_test_skip();
+?>
+--FILE--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+
+use ClickHouse\Driver\Block;
+use ClickHouse\Driver\CompressionMethod;
+
+$client = clickhouse_test_client();
+
+$query = "SELECT number AS id, concat('r', toString(number)) AS name, " .
+    "if(number = 1, NULL, number * 1.5) AS half, [number, number + 1] AS pair, " .
+    "toLowCardinality(toString(number % 2)) AS lc FROM system.numbers LIMIT 5";
+$rows = $client->select($query);
+
+$blocks = [];
+$client->selectByBlock($query, function ($block) use (&$blocks) {
+    if ($block->getRowCount() > 0) {
+        $blocks[] = $block;
+    }
+});
+$block = $blocks[0];
+
+foreach ([null, CompressionMethod::None, CompressionMethod::LZ4, CompressionMethod::ZSTD] as $c) {
+    $copy = Block::fromNative($block->toNative($c));
+    var_dump($copy->toArray() === $block->toArray());
+}
+echo $block->getColumnTypeName(3), ' ', Block::fromNative($block->toNative())->getColumnTypeName(3), "\n";
+
+/* Several blocks concatenate into one */
+$many = $client->selectNative('SELECT number FROM system.numbers LIMIT 10', null,
+                              ['max_block_size' => 3]);
+$all = Block::fromNative($many);
+echo $all->getRowCount(), ' ', implode(',', array_column($all->toArray(), 'number')), "\n";
+
+/* The leading header block holds no data, also for the LowCardinality column */
+foreach ([null, CompressionMethod::LZ4, CompressionMethod::ZSTD] as $c) {
+    $packed = $client->selectNative($query, null, null, null, null, $c);
+    var_dump(Block::fromNative($packed)->toArray() === $rows);
+}
+
+/* Empty results keep their columns */
+$empty = Block::fromNative($client->selectNative('SELECT 1 AS x WHERE 0'));
+echo $empty->getColumnCount(), ' ', $empty->getRowCount(), ' ', $empty->getColumnTypeName(0), "\n";
+
+echo Block::fromNative((new Block())->toNative())->getColumnCount(), "\n";
+
+try {
+    Block::fromNative("\x01\x05\x01x\x06UInt64\x01");
+} catch (ClickHouse\Driver\Exception\ProtocolException $e) {
+    echo get_class($e), "\n";
+}
+try {
+    $block->toNative(CompressionMethod::Adaptive);
+} catch (ClickHouse\Driver\Exception\ValidationException $e) {
+    echo $e->getMessage(), "\n";
+}
+echo "OK\n";
+?>
+--EXPECT--
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+Array(UInt64) Array(UInt64)
+10 0,1,2,3,4,5,6,7,8,9
+bool(true)
+bool(true)
+bool(true)
+1 0 UInt8
+0
+ClickHouse\Driver\Exception\ProtocolException
+Compression must be CompressionMethod::None, LZ4 or ZSTD
+OK
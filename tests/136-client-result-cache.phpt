@@ -0,0 +1,104 @@
+--TEST--
+Client::selectCached() serves repeated queries from the shared result cache
+--EXTENSIONS--
+clickhouse
+--SKIPIF--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+clickhouse_test_skip();
+?>
+--INI--
+clickhouse.result_cache_size=1M
+memory_limit=64M
+--FILE--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+
+$client = clickhouse_test_client();
+
+$query = 'SELECT rand64() AS r, number AS n FROM system.numbers LIMIT 3';
+$first = $client->selectCached($query, 60);
+var_dump(count($first));
+
+/* Same result for the same key, including reformatted text */
+var_dump($client->selectCached($query, 60) === $first);
+var_dump($client->selectCached("SELECT rand64()  AS r,\n  number AS n FROM system.numbers LIMIT 3", 60) === $first);
+
+/* A -- comment ends at its newline, so the text after it still counts */
+$commented = "SELECT 1 AS x -- one\n, rand64() AS r";
+$c = $client->selectCached($commented, 60);
+var_dump(count($c[0]), $client->selectCached("SELECT 1 AS x -- one , rand64() AS r", 60) !== $c);
+var_dump($client->selectCached("SELECT 1 AS x -- one\n  , rand64()  AS r", 60) === $c);
+
+/* Another client of the same server, database and user shares the entry */
+var_dump(clickhouse_test_client()->selectCached($query, 60) === $first);
+
+/* Params and settings are part of the key */
+var_dump($client->selectCached($query, 60, null, ['max_threads' => 1]) === $first);
+
+$param = 'SELECT {v:UInt32} AS v, rand64() AS r';
+$a = $client->selectCached($param, 60, ['v' => 1]);
+$b = $client->selectCached($param, 60, ['v' => 2]);
+var_dump($a[0]['v'], $b[0]['v'], $client->selectCached($param, 60, ['v' => 1]) === $a);
+
+/* Empty results are cached too */
+var_dump($client->selectCached('SELECT 1 AS x WHERE 0', 60));
+
+/* LowCardinality columns are read back from the cache */
+$lc = 'SELECT toLowCardinality(toString(number % 2)) AS lc, rand64() AS r ' .
+    'FROM system.numbers LIMIT 4';
+$l = $client->selectCached($lc, 60);
+echo implode(',', array_column($l, 'lc')), "\n";
+var_dump($client->selectCached($lc, 60) === $l);
+
+/* Entries expire */
+$short = 'SELECT rand64() AS r';
+$once = $client->selectCached($short, 1);
+sleep(2);
+var_dump($client->selectCached($short, 1) !== $once);
+
+/* The largest TTL does not wrap around into the past */
+$forever = 'SELECT rand64() AS r, 1 AS forever';
+$kept = $client->selectCached($forever, PHP_INT_MAX);
+var_dump($client->selectCached($forever, PHP_INT_MAX) === $kept);
+
+/* A hit is checked against memoryLimitFraction like a query */
+$big = 'SELECT number AS n FROM system.numbers LIMIT 25000';
+var_dump(count($client->selectCached($big, 60)));
+$limited = new ClickHouse\Driver\Client(clickhouse_test_options(['memoryLimitFraction' => 0.1]));
+try {
+    $limited->selectCached($big, 60);
+    echo "FAIL: no exception\n";
+} catch (ClickHouse\Driver\Exception\MemoryLimitException $e) {
+    echo "MemoryLimitException\n";
+}
+
+try {
+    $client->selectCached($query, 0);
+} catch (ClickHouse\Driver\Exception\ValidationException $e) {
+    echo $e->getMessage(), "\n";
+}
+echo "OK\n";
+?>
+--EXPECT--
+int(3)
+bool(true)
+bool(true)
+int(2)
+bool(true)
+bool(true)
+bool(true)
+bool(false)
+int(1)
+int(2)
+bool(true)
+array(0) {
+}
+0,1,0,1
+bool(true)
+bool(true)
+bool(true)
+int(25000)
+MemoryLimitException
+ttlSeconds must be positive
+OK
@@ -0,0 +1,72 @@
+--TEST--
+Block::toArrowIpc() and Client::selectArrowIpc() write Arrow IPC streams
+--EXTENSIONS--
+clickhouse
+--SKIPIF--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+clickhouse_test_skip();
+?>
+--FILE--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+
+use ClickHouse\Driver\Block;
+
+$client = clickhouse_test_client();
+
+$query = "SELECT number AS id, concat('r', toString(number)) AS name, " .
+    "if(number = 1, NULL, number * 1.5) AS half, [number, number + 1] AS pair, " .
+    "toDateTime64(number, 3, 'Europe/Berlin') AS at FROM system.numbers LIMIT 5";
+$stream = $client->selectArrowIpc($query);
+
+$eos = "\xff\xff\xff\xff\x00\x00\x00\x00";
+var_dump(substr($stream, 0, 4) === "\xff\xff\xff\xff");
+var_dump(substr($stream, -8) === $eos);
+var_dump(strlen($stream) % 8 === 0);
+foreach (['id', 'name', 'half', 'pair', 'Europe/Berlin'] as $name) {
+    var_dump(strpos($stream, $name) !== false);
+}
+
+/* One block gives the same stream as the query */
+$blocks = [];
+$client->selectByBlock($query, function ($block) use (&$blocks) {
+    if ($block->getRowCount() > 0) {
+        $blocks[] = $block;
+    }
+});
+var_dump($blocks[0]->toArrowIpc() === $stream);
+
+/* Several blocks become several record batches after one schema */
+$many = $client->selectArrowIpc('SELECT number FROM system.numbers LIMIT 10', null,
+                                ['max_block_size' => 3]);
+var_dump(strlen($many) > strlen($client->selectArrowIpc('SELECT number FROM system.numbers LIMIT 1')));
+
+/* An empty result is a schema and the end marker */
+$empty = $client->selectArrowIpc('SELECT 1 AS x WHERE 0');
+var_dump(substr($empty, -8) === $eos, strpos($empty, 'x') !== false);
+var_dump(substr((new Block())->toArrowIpc(), -8) === $eos);
+
+try {
+    $client->selectArrowIpc('SELECT generateUUIDv4() AS u');
+} catch (ClickHouse\Driver\Exception\ValidationException $e) {
+    echo $e->getMessage(), "\n";
+}
+echo "OK\n";
+?>
+--EXPECT--
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+Column u of type UUID cannot be written as Arrow
+OK
@@ -0,0 +1,63 @@
+--TEST--
+A disconnect detected mid-query cancels the query and leaves the client usable
+--EXTENSIONS--
+clickhouse
+ffi
+--SKIPIF--
+<?php
+if (PHP_OS_FAMILY !== 'Linux' || !is_writable('/dev/full')) {
+    die('skip needs /dev/full');
+}
+require __DIR__ . '/clickhouse_test.inc';
+clickhouse_test_skip();
+?>
+--INI--
+ffi.enable=1
+output_buffering=0
+--FILE--
+<?php
+require __DIR__ . '/clickhouse_test.inc';
+
+use ClickHouse\Driver\Exception\ClickHouseException;
+
+$libc = FFI::cdef('int dup(int); int dup2(int, int); int close(int); int open(const char *, int, ...);');
+$client = clickhouse_test_client();
+
+/* Make PHP's next output write fail, which is how it notices a client that
+ * went away: connection_status() becomes CONNECTION_ABORTED. Output is
+ * disabled from then on, so results go to STDOUT directly. */
+ignore_user_abort(true);
+$stdout = $libc->dup(1);
+$full = $libc->open('/dev/full', 1 /* O_WRONLY */);
+$libc->dup2($full, 1);
+echo "lost\n";
+flush();
+$libc->dup2($stdout, 1);
+$libc->close($full);
+$libc->close($stdout);
+ignore_user_abort(false);
+fwrite(STDOUT, 'Aborted: ' . var_export(connection_status() === CONNECTION_ABORTED, true) . "\n");
+
+/* Ten seconds of rows unless the first block cancels it */
+$start = microtime(true);
+try {
+    $client->select('SELECT sleepEachRow(0.01) AS s FROM system.numbers LIMIT 1000', null,
+                    ['max_block_size' => 1]);
+    fwrite(STDOUT, "FAIL: select finished\n");
+} catch (ClickHouseException $e) {
+    fwrite(STDOUT, $e->getMessage() . "\n");
+}
+fwrite(STDOUT, 'Stopped early: ' . (microtime(true) - $start < 5 ? 'yes' : 'no') . "\n");
+
+/* Still aborted, but allowed to continue: the connection was drained */
+ignore_user_abort(true);
+fwrite(STDOUT, 'Reused: ' . $client->select('SELECT 7 AS x')[0]['x'] . "\n");
+$client->ping();
+fwrite(STDOUT, "OK\n");
+?>
+--EXPECT--
+Aborted: true
+Query cancelled: the request was aborted
+Stopped early: yes
+Reused: 7
+OK